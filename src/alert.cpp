@@ -113,7 +113,12 @@ bool CAlert::RelayTo(CNode* pNode) const {
     if (!IsInEffect())
         return false;
     // returns true if wasn't already contained in the set
-    if (pNode->setKnown.insert(GetHash()).second) {
+    bool fNew = false;
+    {
+        LOCK(pNode->cs_inventory);
+        fNew = pNode->setKnown.insert(GetHash()).second;
+    }
+    if (fNew) {
         if (AppliesTo(pNode->nVersion, pNode->strSubVer) ||
             AppliesToMe() ||
             GetAdjustedTime() < nRelayUntil) {
@@ -0,0 +1,253 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockpipeline.h"
+
+#include "main.h"
+#include "net.h"
+#include "sigcache.h"
+
+void CBlockPipeline::Start(int32_t checkThreadCount) {
+    Stop();
+    if (checkThreadCount <= 0)
+        return;
+
+    std::unique_lock<std::mutex> lock(mtx);
+    fStop    = false;
+    fStarted = true;
+    threads.emplace_back(&CBlockPipeline::ThreadConnect, this);
+    for (int32_t i = 0; i < checkThreadCount; ++i) {
+        threads.emplace_back(&CBlockPipeline::ThreadCheck, this);
+    }
+}
+
+void CBlockPipeline::Stop() {
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        fStop    = true;
+        fStarted = false;
+    }
+    cvCheck.notify_all();
+    cvConnect.notify_all();
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+
+    // the blocks left are dropped, they will be downloaded again
+    std::deque<std::shared_ptr<CItem>> itemsLeft;
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        itemsLeft.swap(items);
+        checkQueue.clear();
+    }
+    for (const auto &spItem : itemsLeft) {
+        ReleaseNode(spItem->pFrom);
+    }
+}
+
+bool CBlockPipeline::IsStarted() const {
+    std::unique_lock<std::mutex> lock(mtx);
+    return fStarted;
+}
+
+bool CBlockPipeline::Submit(CNode *pFrom, const std::shared_ptr<CDataStream> &spBlockData) {
+    auto spItem         = std::make_shared<CItem>();
+    spItem->pFrom       = pFrom;
+    spItem->spBlockData = spBlockData;
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (fStop || items.size() >= MAX_PIPELINE_BLOCKS)
+            return false;
+
+        items.push_back(spItem);
+        checkQueue.push_back(spItem);
+    }
+
+    {
+        LOCK(cs_vNodes);
+        pFrom->AddRef();
+    }
+    cvCheck.notify_one();
+    return true;
+}
+
+bool CBlockPipeline::IsFull() const {
+    std::unique_lock<std::mutex> lock(mtx);
+    return items.size() >= MAX_PIPELINE_BLOCKS;
+}
+
+void CBlockPipeline::AddOwnerPubKey(const CUserID &uid, const CPubKey &pubKey) {
+    std::unique_lock<std::mutex> lock(mtxPubKey);
+    string key = uid.ToString();
+    auto it    = ownerPubKeys.find(key);
+    if (it != ownerPubKeys.end()) {
+        ownerPubKeyLru.splice(ownerPubKeyLru.begin(), ownerPubKeyLru, it->second.lruIt);
+        it->second.pubKey = pubKey;
+        return;
+    }
+
+    // evict the least recently used owner pubkey
+    if (ownerPubKeys.size() >= MAX_PIPELINE_OWNER_PUBKEYS) {
+        ownerPubKeys.erase(ownerPubKeyLru.back());
+        ownerPubKeyLru.pop_back();
+    }
+
+    ownerPubKeyLru.push_front(key);
+    ownerPubKeys[key] = {pubKey, ownerPubKeyLru.begin()};
+}
+
+CBlockPipelineStats CBlockPipeline::GetStats() const {
+    std::unique_lock<std::mutex> lock(mtx);
+    CBlockPipelineStats ret = stats;
+    ret.checkQueueDepth     = checkQueue.size();
+    ret.connectQueueDepth   = items.size() - checkQueue.size();
+    return ret;
+}
+
+void CBlockPipeline::ThreadCheck() {
+    RenameThread("coin-blockcheck");
+
+    while (true) {
+        std::shared_ptr<CItem> spItem;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cvCheck.wait(lock, [this] { return fStop || !checkQueue.empty(); });
+            if (fStop)
+                return;
+
+            spItem = checkQueue.front();
+            checkQueue.pop_front();
+        }
+
+        int64_t nStart = GetTimeMicros();
+        CheckBlock(*spItem);
+
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            spItem->fChecked    = true;
+            spItem->checkedTime = GetTimeMicros();
+            stats.checkedBlocks++;
+            stats.checkTime += spItem->checkedTime - nStart;
+        }
+        cvConnect.notify_one();
+    }
+}
+
+void CBlockPipeline::ThreadConnect() {
+    RenameThread("coin-blockconnect");
+
+    while (true) {
+        std::shared_ptr<CItem> spItem;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cvConnect.wait(lock, [this] { return fStop || (!items.empty() && items.front()->fChecked); });
+            if (fStop)
+                return;
+
+            spItem = items.front();
+            stats.connectWaitTime += GetTimeMicros() - spItem->checkedTime;
+        }
+
+        int64_t nStart = GetTimeMicros();
+        if (spItem->spBlock != nullptr) {
+            try {
+                ProcessReceivedBlock(spItem->pFrom, *spItem->spBlock);
+            } catch (std::exception &e) {
+                PrintExceptionContinue(&e, "CBlockPipeline::ThreadConnect()");
+            } catch (...) {
+                PrintExceptionContinue(nullptr, "CBlockPipeline::ThreadConnect()");
+            }
+        } else {
+            spItem->pFrom->PushMessage(NetMsgType::REJECT, string(NetMsgType::BLOCK), REJECT_MALFORMED,
+                                       string("error parsing message"));
+        }
+
+        bool fWasFull;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            fWasFull = items.size() >= MAX_PIPELINE_BLOCKS;
+            items.pop_front();
+            stats.connectedBlocks++;
+            stats.connectTime += GetTimeMicros() - nStart;
+        }
+        // the blocks waiting in the queues of the peers can be submitted now
+        if (fWasFull)
+            WakeMessageHandler(true, true);
+        ReleaseNode(spItem->pFrom);
+    }
+}
+
+void CBlockPipeline::CheckBlock(CItem &item) {
+    uint32_t blockSize = item.spBlockData->size();
+    auto spBlock       = std::make_shared<CBlock>();
+    try {
+        *item.spBlockData >> *spBlock;
+    } catch (std::exception &e) {
+        LogPrint(BCLog::INFO, "CBlockPipeline::CheckBlock() : decode the block from peer %s failed: %s\n",
+                 item.pFrom->addrName, e.what());
+        return;
+    }
+    item.spBlockData = nullptr;
+    item.spBlock     = spBlock;
+
+    const CBlock &block = *spBlock;
+    if (block.vptx.empty() || blockSize > MAX_BLOCK_SIZE)
+        return;
+
+    // compute the tx hashes and the merkle tree, they are kept in memory for the connect stage
+    if (block.BuildMerkleTree() != block.GetMerkleRootHash())
+        return;
+
+    // the signatures below the -assumevalid block are not verified when connecting, it is only a hint
+    // without cs_main, a block on another fork is verified when connecting as usual
+    if ((int32_t)block.GetHeight() <= nAssumeValidHeight.load())
+        return;
+
+    vector<CSignatureItem> sigItems;
+    sigItems.reserve(block.vptx.size());
+    for (const auto &pTx : block.vptx) {
+        if (pTx->IsBlockRewardTx() || pTx->IsPriceMedianTx() || pTx->signature.empty())
+            continue;
+
+        CSignatureItem sigItem;
+        if (pTx->txUid.is<CPubKey>()) {
+            sigItem.pubKey = pTx->txUid.get<CPubKey>();
+        } else if (!GetOwnerPubKey(pTx->txUid, sigItem.pubKey)) {
+            continue;
+        }
+
+        sigItem.sigHash   = pTx->GetHash();
+        sigItem.signature = pTx->signature;
+        if (!signatureCache.Get(sigItem.sigHash, sigItem.signature, sigItem.pubKey))
+            sigItems.push_back(std::move(sigItem));
+    }
+
+    vector<bool> results;
+    VerifySignatureBatch(sigItems, results);
+    for (size_t i = 0; i < sigItems.size(); ++i) {
+        if (results[i])
+            signatureCache.Set(sigItems[i].sigHash, sigItems[i].signature, sigItems[i].pubKey);
+    }
+
+    std::unique_lock<std::mutex> lock(mtx);
+    stats.checkedSignatures += sigItems.size();
+}
+
+bool CBlockPipeline::GetOwnerPubKey(const CUserID &uid, CPubKey &pubKey) {
+    std::unique_lock<std::mutex> lock(mtxPubKey);
+    auto it = ownerPubKeys.find(uid.ToString());
+    if (it == ownerPubKeys.end())
+        return false;
+
+    ownerPubKeyLru.splice(ownerPubKeyLru.begin(), ownerPubKeyLru, it->second.lruIt);
+    pubKey = it->second.pubKey;
+    return true;
+}
+
+void CBlockPipeline::ReleaseNode(CNode *pNode) {
+    LOCK(cs_vNodes);
+    pNode->Release();
+}
@@ -0,0 +1,109 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef CHAIN_BLOCK_PIPELINE_H
+#define CHAIN_BLOCK_PIPELINE_H
+
+#include "commons/serialize.h"
+#include "entities/id.h"
+#include "entities/key.h"
+#include "persistence/block.h"
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class CNode;
+
+/** Maximum number of the block check threads */
+static const int32_t MAX_BLOCK_CHECK_THREADS = 8;
+/** -blockcheckthreads default (number of the threads to decode and check the received blocks, 0 = disabled) */
+static const int32_t DEFAULT_BLOCK_CHECK_THREADS = 2;
+/** Maximum number of the received blocks in the pipeline, the next block of a peer waits in its queue when full */
+static const uint32_t MAX_PIPELINE_BLOCKS = 16;
+/** Maximum number of the owner pubkeys kept to check the signatures before connecting */
+static const uint32_t MAX_PIPELINE_OWNER_PUBKEYS = 200000;
+
+struct CBlockPipelineStats {
+    uint32_t checkQueueDepth   = 0;  // the blocks waiting to be checked
+    uint32_t connectQueueDepth = 0;  // the blocks checked or being checked, waiting to be connected
+    uint64_t checkedBlocks     = 0;
+    uint64_t checkedSignatures = 0;
+    int64_t checkTime          = 0;  // in micros, decoding and checking
+    uint64_t connectedBlocks   = 0;
+    int64_t connectWaitTime    = 0;  // in micros, from checked to being connected
+    int64_t connectTime        = 0;  // in micros, processing the block with cs_main
+};
+
+/**
+ * The staged processing of the blocks received from peers. The check stage decodes the blocks and
+ * checks their stateless validity on worker threads: the size, the merkle root and the signatures of
+ * the txs whose owner pubkeys are known. The connect stage processes the checked blocks one by one in
+ * the receiving order on its own thread. So the blocks N+1..N+k are decoded and their signatures are
+ * verified into the signature cache while block N is executed.
+ *
+ * The check stage never rejects a block, the connect stage does the full validation as before.
+ */
+class CBlockPipeline {
+public:
+    CBlockPipeline() {}
+    ~CBlockPipeline() { Stop(); }
+
+    // start the connect thread and the check threads, nothing is started when checkThreadCount <= 0
+    void Start(int32_t checkThreadCount);
+    void Stop();
+    bool IsStarted() const;
+
+    // queue the block received from the peer, the block header has been decoded by the caller. Return false
+    // without waiting if the pipeline is full or stopped
+    bool Submit(CNode *pFrom, const std::shared_ptr<CDataStream> &spBlockData);
+    bool IsFull() const;
+
+    // the owner pubkey is immutable, so it is safe to check the signatures with it before connecting
+    void AddOwnerPubKey(const CUserID &uid, const CPubKey &pubKey);
+    bool GetOwnerPubKey(const CUserID &uid, CPubKey &pubKey);
+
+    CBlockPipelineStats GetStats() const;
+
+private:
+    struct CItem {
+        CNode *pFrom;
+        std::shared_ptr<CDataStream> spBlockData;
+        std::shared_ptr<CBlock> spBlock;  // nullptr if failed to decode
+        bool fChecked       = false;
+        int64_t checkedTime = 0;
+    };
+
+    void ThreadCheck();
+    void ThreadConnect();
+    void CheckBlock(CItem &item);
+    void ReleaseNode(CNode *pNode);
+
+    mutable std::mutex mtx;
+    std::condition_variable cvCheck;    // a block is submitted
+    std::condition_variable cvConnect;  // a block is checked
+    std::vector<std::thread> threads;
+    bool fStarted = false;
+    bool fStop    = false;
+
+    std::deque<std::shared_ptr<CItem>> checkQueue;  // the blocks to be checked
+    std::deque<std::shared_ptr<CItem>> items;       // all blocks in the pipeline in receiving order
+    CBlockPipelineStats stats;
+
+    struct CPubKeyItem {
+        CPubKey pubKey;
+        std::list<std::string>::iterator lruIt;
+    };
+
+    std::mutex mtxPubKey;
+    std::unordered_map<std::string, CPubKeyItem> ownerPubKeys;  // uid -> owner pubkey
+    std::list<std::string> ownerPubKeyLru;                      // the most recently used uid at the front
+};
+
+#endif  // CHAIN_BLOCK_PIPELINE_H
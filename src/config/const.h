@@ -113,6 +113,15 @@ static const uint32_t MAX_ORPHAN_BLOCKS = 750;
 static const int32_t MAX_BLOCKS_IN_TRANSIT_PER_PEER = 128;
 /** Timeout in seconds before considering a block download peer unresponsive. */
 static const uint32_t BLOCK_DOWNLOAD_TIMEOUT  = 60;
+/** Number of blocks beyond the tip that can be requested from all peers during headers-first sync,
+ *  the blocks arriving out of order are kept as orphans so it must stay below MAX_ORPHAN_BLOCKS. */
+static const int32_t BLOCK_DOWNLOAD_WINDOW = 512;
+/** Number of headers sent in one headers message. */
+static const int32_t MAX_HEADERS_RESULTS = 2000;
+/** Number of sync headers beyond the tip kept in memory, getheaders pauses until the tip catches up. */
+static const int32_t MAX_SYNC_HEADERS_AHEAD = 20000;
+/** Default for -headersfirstsync */
+static const bool DEFAULT_HEADERS_FIRST_SYNC = true;
 
 /** Minimum disk space required */
 static const uint64_t MIN_DISK_SPACE = 52428800;
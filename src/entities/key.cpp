@@ -209,6 +209,37 @@ bool CPubKey::Verify(const uint256 &hash, const vector<uint8_t> &vchSig) const {
     return secp256k1_ecdsa_verify(secp256k1_context_verify, &sig, hash.begin(), &pubkey);
 }
 
+bool VerifySignatureBatch(const vector<CSignatureItem> &items, vector<bool> &results) {
+    results.assign(items.size(), false);
+
+    // parsed public keys of the batch, the first of the pair is whether the key is parsed ok
+    map<CPubKey, pair<bool, secp256k1_pubkey>> parsedKeys;
+    bool allValid = true;
+    for (size_t i = 0; i < items.size(); i++) {
+        const CSignatureItem &item = items[i];
+        auto keyIt = parsedKeys.find(item.pubKey);
+        if (keyIt == parsedKeys.end()) {
+            pair<bool, secp256k1_pubkey> parsed;
+            parsed.first = item.pubKey.IsValid() &&
+                           secp256k1_ec_pubkey_parse(secp256k1_context_verify, &parsed.second,
+                                                     item.pubKey.begin(), item.pubKey.size());
+            keyIt = parsedKeys.emplace(item.pubKey, parsed).first;
+        }
+
+        secp256k1_ecdsa_signature sig;
+        if (keyIt->second.first &&
+            ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sig, item.signature.data(),
+                                          item.signature.size())) {
+            // the same lower-S normalization as CPubKey::Verify()
+            secp256k1_ecdsa_signature_normalize(secp256k1_context_verify, &sig, &sig);
+            results[i] = secp256k1_ecdsa_verify(secp256k1_context_verify, &sig, item.sigHash.begin(),
+                                                &keyIt->second.second);
+        }
+        allValid = allValid && results[i];
+    }
+    return allValid;
+}
+
 bool CPubKey::RecoverCompact(const uint256 &hash, const vector<uint8_t> &vchSig) {
     if (vchSig.size() != COMPACT_SIGNATURE_SIZE) return false;
 
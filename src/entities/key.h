@@ -412,6 +412,20 @@ public:
     IMPLEMENT_SERIALIZE(READWRITE(VARINT(nRequired)); READWRITE(pubKeys);)
 };
 
+/** A DER signature (~72 bytes) of sigHash to be verified with pubKey */
+struct CSignatureItem {
+    uint256 sigHash;
+    vector<uint8_t> signature;
+    CPubKey pubKey;
+};
+
+/**
+ * Verify a batch of signatures with the shared verify context. Each distinct public key of the
+ * batch is parsed only once, which pays off when one account signs many txs of a block.
+ * results[i] is set to the result of items[i], and returns true only if all the items are valid.
+ */
+bool VerifySignatureBatch(const vector<CSignatureItem> &items, vector<bool> &results);
+
 /** Users of this module must hold an ECCVerifyHandle. The constructor and
  *  destructor of these are not allowed to run in parallel, though. */
 class ECCVerifyHandle {
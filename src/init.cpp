@@ -15,6 +15,7 @@
 
 #include "rpc/core/rpcserver.h"
 #include "vm/luavm/lua/lua.h"
+#include "vm/wasm/wasm_code_cache.hpp"
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
 #include "main.h"
@@ -24,6 +25,7 @@
 #include "persistence/accountdb.h"
 #include "persistence/txdb.h"
 #include "persistence/contractdb.h"
+#include "persistence/snapshot.h"
 #include "tx/tx.h"
 #include "commons/util/util.h"
 #include "commons/util/time.h"
@@ -135,8 +137,12 @@ void Shutdown() {
     StartCommonGeneration(0, 0);
     StartContractGeneration("", 0, 0);
 
+    blockPipeline.Stop();
+    txAdmission.Stop();
     StopNode();
     UnregisterNodeSignals(GetNodeSignals());
+    sigCheckPool.Stop();
+    wasm::save_code_cache();
 
     {
         LOCK(cs_main);
@@ -199,6 +205,7 @@ string HelpMessage() {
     string strUsage = _("Options:") + "\n";
     strUsage += "  -?                     " + _("This help message") + "\n";
     strUsage += "  -alertnotify=<cmd>     " + _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)") + "\n";
+    strUsage += "  -assumevalid=<hex>     " + _("Skip the signature verification of the blocks that are ancestors of the block (still execute their txs, default: none)") + "\n";
     strUsage += "  -blocknotify=<cmd>     " + _("Execute command when the best block changes (%s in cmd is replaced by block hash)") + "\n";
     strUsage += "  -checkblocks=<n>       " + _("How many blocks to check at startup (default: 288, 0 = all)") + "\n";
     strUsage += "  -checklevel=<n>        " + _("How thorough the block verification of -checkblocks is (0-4, default: 3)") + "\n";
@@ -208,6 +215,18 @@ string HelpMessage() {
 #endif
     strUsage += "  -datadir=<dir>         " + _("Specify data directory") + "\n";
     strUsage += "  -dbcache=<n>           " + strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), MIN_DB_CACHE, MAX_DB_CACHE, DEFAULT_DB_CACHE) + "\n";
+    strUsage += "  -dbkeyfilter=<prefix>  " + _("Keep an in-memory key filter of the db prefix to skip the db reads of missing keys, such as idac, cdat, dato (can be specified multiple times)") + "\n";
+    strUsage += "  -blockcheckthreads=<n> " + strprintf(_("Set the number of threads to decode and check the received blocks ahead of connecting them (up to %d, 0 = check them when connecting, default: %d)"), MAX_BLOCK_CHECK_THREADS, DEFAULT_BLOCK_CHECK_THREADS) + "\n";
+    strUsage += "  -txcheckthreads=<n>    " + strprintf(_("Set the number of threads to decode and check the received txs, which are then accepted to the mempool in batches (up to %d, 0 = accept them one by one when received, default: %d)"), MAX_TX_CHECK_THREADS, DEFAULT_TX_CHECK_THREADS) + "\n";
+    strUsage += "  -par=<n>               " + strprintf(_("Set the number of signature verification threads (up to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), MAX_SIGCHECK_THREADS, DEFAULT_SIGCHECK_THREADS) + "\n";
+    strUsage += "  -recentblockcache=<n>  " + strprintf(_("Keep the recently connected blocks in memory up to <n> megabytes (default: %u)"), DEFAULT_RECENT_BLOCK_CACHE_SIZE >> 20) + "\n";
+    strUsage += "  -headersfirstsync      " + strprintf(_("Download the headers from the sync peer first and then the blocks from all peers (default: %u)"), DEFAULT_HEADERS_FIRST_SYNC) + "\n";
+    strUsage += "  -compactblocks         " + strprintf(_("Relay the new blocks as compact blocks rebuilt from the mempool by the peers, the delegates get them pushed (default: %u)"), DEFAULT_COMPACT_BLOCKS) + "\n";
+    strUsage += "  -wasmprecompile        " + strprintf(_("Instantiate the wasm modules saved in wasmcache.dat before the node starts, instead of in the background (default: %u)"), wasm::default_wasm_precompile) + "\n";
+    strUsage += "  -serializedblockcache=<n> " + strprintf(_("Keep the serialized blocks recently served to peers in memory up to <n> megabytes (default: %u)"), DEFAULT_SERIALIZED_BLOCK_CACHE_SIZE >> 20) + "\n";
+    strUsage += "  -maxmempool=<n>        " + strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %d)"), DEFAULT_MAX_MEMPOOL_SIZE) + "\n";
+    strUsage += "  -mempoolexpiry=<n>     " + strprintf(_("Do not keep transactions in the mempool longer than <n> hours (default: %d)"), DEFAULT_MEMPOOL_EXPIRY) + "\n";
+    strUsage += "  -loadsnapshot=<file>   " + _("Load the state snapshot dumped by dumpsnapshot from a trusted node into an empty data directory on startup (implies -txindex=0)") + "\n";
     strUsage += "  -loadblock=<file>      " + _("Imports blocks from external blk000??.dat file") + " " + _("on startup") + "\n";
     strUsage += "  -pid=<file>            " + _("Specify pid file (default: coin.pid)") + "\n";
     strUsage += "  -reindex               " + _("Rebuild block chain index from current blk000??.dat files") + " " + _("on startup") + "\n";
@@ -228,6 +247,7 @@ string HelpMessage() {
     strUsage += "  -externalip=<ip>       " + _("Specify your own public address") + "\n";
     strUsage += "  -listen                " + _("Accept connections from outside (default: 1 if no -proxy or -connect)") + "\n";
     strUsage += "  -maxconnections=<n>    " + _("Maintain at most <n> connections to peers (default: 125)") + "\n";
+    strUsage += "  -msghandlerthreads=<n> " + strprintf(_("Set the number of threads to process the messages of the peers in parallel, the block and pbft messages are processed by another thread ahead of them (1 to %d, default: %d)"), MAX_MESSAGE_HANDLER_THREADS, DEFAULT_MESSAGE_HANDLER_THREADS) + "\n";
     strUsage += "  -maxreceivebuffer=<n>  " + _("Maximum per-connection receive buffer, <n>*1000 bytes (default: 5000)") + "\n";
     strUsage += "  -maxsendbuffer=<n>     " + _("Maximum per-connection send buffer, <n>*1000 bytes (default: 1000)") + "\n";
     strUsage += "  -onion=<ip:port>       " + _("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: -proxy)") + "\n";
@@ -279,7 +299,8 @@ string HelpMessage() {
     strUsage += "  -logtimestamps         " + _("Prepend debug output with timestamp (default: 1)") + "\n";
     if (SysCfg().GetBoolArg("-help-debug", false)) {
         strUsage += "  -limitfreerelay=<n>    " + _("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default:15)") + "\n";
-        strUsage += "  -maxsigcachesize=<n>   " + _("Limit size of signature cache to <n> entries (default: 50000)") + "\n";
+        strUsage += "  -maxsigcachesize=<n>   " + strprintf(_("Limit size of signature cache to <n> megabytes (default: %d, max: %d)"), DEFAULT_MAX_SIG_CACHE_SIZE, MAX_MAX_SIG_CACHE_SIZE) + "\n";
+        strUsage += "  -sigcacheeraseonconnect " + strprintf(_("Erase the signature cache entries of a block when it is connected (default: %u)"), DEFAULT_SIG_CACHE_ERASE_ON_CONNECT) + "\n";
     }
     strUsage += "  -logprinttoconsole     " + _("Send trace/debug info to console instead of debug.log file") + "\n";
     if (SysCfg().GetBoolArg("-help-debug", false)) {
@@ -443,6 +464,44 @@ bool AppInit(boost::thread_group &threadGroup) {
 #endif
 #endif
 
+    // -par=0 means autodetect, and nSigCheckThreads==1 means verifying in the caller thread only
+    int32_t nSigCheckThreads = SysCfg().GetArg("-par", DEFAULT_SIGCHECK_THREADS);
+    if (nSigCheckThreads <= 0)
+        nSigCheckThreads += std::thread::hardware_concurrency();
+    nSigCheckThreads = std::max(1, std::min(nSigCheckThreads, MAX_SIGCHECK_THREADS));
+    LogPrint(BCLog::INFO, "Using %d threads for signature verification\n", nSigCheckThreads);
+    sigCheckPool.Start(nSigCheckThreads);
+
+    string strAssumeValid = SysCfg().GetArg("-assumevalid", "");
+    if (!strAssumeValid.empty() && strAssumeValid != "0") {
+        if (strAssumeValid.size() != 64 || !IsHex(strAssumeValid))
+            return InitError(strprintf(_("Invalid -assumevalid block hash: '%s'"), strAssumeValid));
+
+        hashAssumeValid = uint256S(strAssumeValid);
+        LogPrint(BCLog::INFO, "Assuming the ancestors of block %s have valid signatures\n", hashAssumeValid.GetHex());
+    }
+
+    int32_t nBlockCheckThreads = SysCfg().GetArg("-blockcheckthreads", DEFAULT_BLOCK_CHECK_THREADS);
+    nBlockCheckThreads = std::max(0, std::min(nBlockCheckThreads, MAX_BLOCK_CHECK_THREADS));
+    LogPrint(BCLog::INFO, "Using %d threads to check the received blocks\n", nBlockCheckThreads);
+    blockPipeline.Start(nBlockCheckThreads);
+
+    int32_t nTxCheckThreads = SysCfg().GetArg("-txcheckthreads", DEFAULT_TX_CHECK_THREADS);
+    nTxCheckThreads = std::max(0, std::min(nTxCheckThreads, MAX_TX_CHECK_THREADS));
+    LogPrint(BCLog::INFO, "Using %d threads to check the received txs\n", nTxCheckThreads);
+    txAdmission.Start(nTxCheckThreads);
+
+    fCompactBlocks = SysCfg().GetBoolArg("-compactblocks", DEFAULT_COMPACT_BLOCKS);
+
+    int64_t nMaxSigCacheSize = SysCfg().GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE);
+    if (nMaxSigCacheSize > MAX_MAX_SIG_CACHE_SIZE) {
+        LogPrint(BCLog::INFO, "Warning: -maxsigcachesize=%d is in megabytes, it is reduced to %d\n", nMaxSigCacheSize,
+                 MAX_MAX_SIG_CACHE_SIZE);
+        nMaxSigCacheSize = MAX_MAX_SIG_CACHE_SIZE;
+    }
+    signatureCache.Setup(std::max<int64_t>(nMaxSigCacheSize, 0) << 20);
+    LogPrint(BCLog::INFO, "Using %u bytes for signature cache\n", signatureCache.GetMemorySize());
+
     if (SysCfg().IsArgCount("-bind")) {
         // when specifying an explicit binding address, you want to listen on it
         // even when -connect or -proxy is specified
@@ -459,6 +518,12 @@ bool AppInit(boost::thread_group &threadGroup) {
             LogPrint(BCLog::INFO, "AppInit : parameter interaction: -connect set -> setting -listen=0\n");
     }
 
+    if (SysCfg().IsArgCount("-loadsnapshot")) {
+        // the snapshot carries no transaction index of the blocks below its tip
+        if (SysCfg().SoftSetBoolArg("-txindex", false))
+            LogPrint(BCLog::INFO, "AppInit : parameter interaction: -loadsnapshot set -> setting -txindex=0\n");
+    }
+
     if (SysCfg().IsArgCount("-proxy")) {
         // to protect privacy, do not listen by default if a default proxy server is specified
         if (SysCfg().SoftSetBoolArg("-listen", false))
@@ -487,9 +552,14 @@ bool AppInit(boost::thread_group &threadGroup) {
     }
 
     // Make sure enough file descriptors are available
-    int32_t nBind   = max((int32_t)SysCfg().IsArgCount("-bind"), 1);
     nMaxConnections = SysCfg().GetArg("-maxconnections", 125);
+#ifdef HAVE_SYS_EPOLL_H
+    // the sockets are waited with epoll, which is not limited by FD_SETSIZE
+    nMaxConnections = max(nMaxConnections, 0);
+#else
+    int32_t nBind   = max((int32_t)SysCfg().IsArgCount("-bind"), 1);
     nMaxConnections = max(min(nMaxConnections, (int32_t)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+#endif
     int32_t nFD     = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -499,6 +569,9 @@ bool AppInit(boost::thread_group &threadGroup) {
 
     SysCfg().SetBenchMark(SysCfg().GetBoolArg("-benchmark", false));
     mempool.SetSanityCheck(SysCfg().GetBoolArg("-checkmempool", RegTest()));
+    int64_t nMaxMempool     = SysCfg().GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE);
+    int64_t nMempoolExpiry  = SysCfg().GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY);
+    mempool.SetLimits(std::max<int64_t>(nMaxMempool, 0) << 20, std::max<int64_t>(nMempoolExpiry, 0) * 60 * 60);
 
     setvbuf(stdout, nullptr, _IOLBF, 0);
 
@@ -676,6 +749,20 @@ bool AppInit(boost::thread_group &threadGroup) {
         std::cout << "load wallet failed: " << e.what() << std::endl;
     }
 
+    // cache size calculations
+    int64_t nTotalCache = SysCfg().GetArg("-dbcache", DEFAULT_DB_CACHE);
+    nTotalCache = std::max(nTotalCache, MIN_DB_CACHE);
+    nTotalCache = std::min(nTotalCache, MAX_DB_CACHE);
+    nTotalCache <<= 20;  // MiB to bytes
+
+    // the recent blocks cover the windows of mature reward, tx memory cache and price point memory cache
+    int64_t nRecentBlockCache = SysCfg().GetArg("-recentblockcache", DEFAULT_RECENT_BLOCK_CACHE_SIZE >> 20);
+    recentBlockCache.SetLimit(std::max<int32_t>(SysCfg().GetTxCacheHeight(), BLOCK_REWARD_MATURITY) + 2,
+                              std::max<int64_t>(nRecentBlockCache, 0) << 20);
+
+    int64_t nSerializedBlockCache = SysCfg().GetArg("-serializedblockcache", DEFAULT_SERIALIZED_BLOCK_CACHE_SIZE >> 20);
+    serializedBlockCache.SetLimit(std::max<int64_t>(nSerializedBlockCache, 0) << 20);
+
     int64_t nStart = GetTimeMillis();
     bool fLoaded   = false;
     while (!fLoaded) {
@@ -689,6 +776,21 @@ bool AppInit(boost::thread_group &threadGroup) {
 
                 bool fReIndex = SysCfg().IsReindex();
                 pCdMan = new CCacheDBManager(fReIndex, false);
+                pCdMan->SetReadCacheSize(nTotalCache);
+                if (SysCfg().IsArgCount("-loadsnapshot") && pCdMan->pBlockCache->GetBestBlockHash().IsNull()) {
+                    if (fReIndex)
+                        return InitError(_("-loadsnapshot can't be used with -reindex"));
+                    if (SysCfg().GetBoolArg("-txindex", true))
+                        return InitError(_("-loadsnapshot can't be used with -txindex"));
+
+                    CSnapshotInfo snapshotInfo;
+                    if (!LoadStateSnapshot(SysCfg().GetArg("-loadsnapshot", ""), snapshotInfo))
+                        return InitError(_("Failed to load the state snapshot, see debug.log for details"));
+                }
+                for (const auto &prefixName : SysCfg().GetMultiArgs("-dbkeyfilter")) {
+                    if (!pCdMan->EnableKeyFilter(prefixName))
+                        return InitError(strprintf(_("Invalid -dbkeyfilter prefix: '%s'"), prefixName));
+                }
                 if (fReIndex)
                     pCdMan->pBlockCache->WriteReindexing(true);
 
@@ -788,7 +890,7 @@ bool AppInit(boost::thread_group &threadGroup) {
     int32_t nCount           = 0;
     CBlock block;
     while (pBlockIndex && nCacheHeight-- > 0) {
-        if (!ReadBlockFromDisk(pBlockIndex, block))
+        if (!recentBlockCache.ReadBlock(pBlockIndex, block))
             return InitError("Failed to read block from disk");
 
         if (!pCdMan->pTxCache->AddBlockTx(block))
@@ -806,13 +908,13 @@ bool AppInit(boost::thread_group &threadGroup) {
 
 
     if (pBlockIndex) {
-        if (!ReadBlockFromDisk(pBlockIndex, block))
+        if (!recentBlockCache.ReadBlock(pBlockIndex, block))
             return InitError("Failed to read block from disk");
         pCdMan->pPpCache->SetLatestBlockMedianPricePoints(block.GetBlockMedianPrice());
     }
 
     while (pBlockIndex && nCacheHeight-- > 0) {
-        if (!ReadBlockFromDisk(pBlockIndex, block))
+        if (!recentBlockCache.ReadBlock(pBlockIndex, block))
             return InitError("Failed to read block from disk");
 
         if (!pCdMan->pPpCache->AddBlockToCache(block))
@@ -822,6 +924,8 @@ bool AppInit(boost::thread_group &threadGroup) {
         ++nCount;
     }
     LogPrint(BCLog::INFO, "Added the latest %d blocks to price point memory cache (%dms)\n", nCount, GetTimeMillis() - nStart);
+    LogPrint(BCLog::INFO, "Kept the latest %u blocks in memory, size=%llu\n", recentBlockCache.GetCount(),
+             recentBlockCache.GetSize());
 
     vector<boost::filesystem::path> vImportFiles;
     if (SysCfg().IsArgCount("-loadblock")) {
@@ -833,6 +937,12 @@ bool AppInit(boost::thread_group &threadGroup) {
     }
     threadGroup.create_thread(boost::bind(&ThreadImport, vImportFiles));
 
+    if (SysCfg().GetBoolArg("-wasmprecompile", wasm::default_wasm_precompile)) {
+        wasm::load_code_cache();
+    } else {
+        threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "wasmcache", &wasm::load_code_cache));
+    }
+
 
     nStart = GetTimeMillis();
     {
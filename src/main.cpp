@@ -55,9 +55,17 @@ CCriticalSection cs_main;
 CTxMemPool mempool;
 map<uint256, CBlockIndex *> mapBlockIndex;
 int32_t nSyncTipHeight = 0;
+uint256 hashAssumeValid;
+std::atomic<int32_t> nAssumeValidHeight(-1);
+bool fCompactBlocks = DEFAULT_COMPACT_BLOCKS;
 string externalIp;
 map<uint256/* blockhash */, std::shared_ptr<CCacheWrapper>> mapForkCache;
 CSignatureCache signatureCache;
+CSignatureCheckPool sigCheckPool;
+CRecentBlockCache recentBlockCache;
+CSerializedBlockCache serializedBlockCache;
+CBlockPipeline blockPipeline;
+CTxAdmissionQueue txAdmission;
 CChain chainActive;
 CChain chainMostWork;
 bool mining;        // could change from time to time due to vote change
@@ -206,6 +214,7 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
 void RegisterNodeSignals(CNodeSignals &nodeSignals) {
     nodeSignals.GetHeight.connect(&GetHeight);
     nodeSignals.ProcessMessages.connect(&ProcessMessages);
+    nodeSignals.ProcessPriorityMessages.connect(&ProcessPriorityMessages);
     nodeSignals.SendMessages.connect(&SendMessages);
     nodeSignals.InitializeNode.connect(&InitializeNode);
     nodeSignals.FinalizeNode.connect(&FinalizeNode);
@@ -214,6 +223,7 @@ void RegisterNodeSignals(CNodeSignals &nodeSignals) {
 void UnregisterNodeSignals(CNodeSignals &nodeSignals) {
     nodeSignals.GetHeight.disconnect(&GetHeight);
     nodeSignals.ProcessMessages.disconnect(&ProcessMessages);
+    nodeSignals.ProcessPriorityMessages.disconnect(&ProcessPriorityMessages);
     nodeSignals.SendMessages.disconnect(&SendMessages);
     nodeSignals.InitializeNode.disconnect(&InitializeNode);
     nodeSignals.FinalizeNode.disconnect(&FinalizeNode);
@@ -716,7 +726,7 @@ bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CVal
         }
 
         CBlock reLoadblock;
-        if (!ReadBlockFromDisk(pReLoadBlockIndex, reLoadblock)) {
+        if (!recentBlockCache.ReadBlock(pReLoadBlockIndex, reLoadblock)) {
             return state.Abort(_("DisconnectBlock() : failed to read block"));
         }
 
@@ -740,7 +750,7 @@ bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CVal
         }
 
         CBlock reLoadblock;
-        if (!ReadBlockFromDisk(pReLoadBlockIndex, reLoadblock)) {
+        if (!recentBlockCache.ReadBlock(pReLoadBlockIndex, reLoadblock)) {
             return state.Abort(_("DisconnectBlock() : failed to read block"));
         }
 
@@ -1204,7 +1214,7 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
 
         if (nullptr != pMatureIndex) {
             CBlock matureBlock;
-            if (!ReadBlockFromDisk(pMatureIndex, matureBlock)) {
+            if (!recentBlockCache.ReadBlock(pMatureIndex, matureBlock)) {
                 return state.Abort(_("ConnectBlock() : read mature block error"));
             }
 
@@ -1260,7 +1270,7 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
         }
 
         CBlock deleteBlock;
-        if (!ReadBlockFromDisk(pDeleteBlockIndex, deleteBlock)) {
+        if (!recentBlockCache.ReadBlock(pDeleteBlockIndex, deleteBlock)) {
             return state.Abort(_("ConnectBlock() : failed to read block"));
         }
 
@@ -1281,7 +1291,7 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
         }
 
         CBlock deleteBlock;
-        if (!ReadBlockFromDisk(pDeleteBlockIndex, deleteBlock)) {
+        if (!recentBlockCache.ReadBlock(pDeleteBlockIndex, deleteBlock)) {
             return state.Abort(_("ConnectBlock() : failed to read block"));
         }
 
@@ -1325,16 +1335,66 @@ bool static WriteChainState(CValidationState &state) {
         FlushBlockFile();
         // pCdMan->pBlockCache->Sync();
         pCdMan->Flush();
-        mapForkCache.clear();
+        LogPrint(BCLog::CDB, "flushed chain state, dirty size=%u, read cache usage=%lld\n", cacheSize,
+                 pCdMan->GetReadCacheUsage());
         nLastWrite = GetTimeMicros();
     }
     return true;
 }
 
+// The fork caches are overlays of the global caches, which have undone the active chain to the fork point
+// and connected the fork chain. A fork cache is kept valid when the tip changes by the other blocks: the
+// disconnected block has been undone in it, the connected block is undone beneath its data. It is dropped
+// when the changed block is on its fork chain or its fork point is too deep.
+void static UpdateForkCaches(CBlockIndex *pIndexChanged, bool fConnected) {
+    if (mapForkCache.empty())
+        return;
+
+    CBlockUndo blockUndo;
+    if (fConnected) {
+        CDiskBlockPos pos = pIndexChanged->GetUndoPos();
+        if (pos.IsNull() || !blockUndo.ReadFromDisk(pos, pIndexChanged->pprev->GetBlockHash())) {
+            LogPrint(BCLog::INFO, "UpdateForkCaches() : failed to read undo data of block [%d]: %s\n",
+                     pIndexChanged->height, pIndexChanged->GetBlockHash().GetHex());
+            mapForkCache.clear();
+            return;
+        }
+    }
+
+    int32_t maxForkHeight = SysCfg().GetMaxForkHeight(chainActive.Height());
+    for (auto it = mapForkCache.begin(); it != mapForkCache.end();) {
+        auto mi = mapBlockIndex.find(it->first);
+        const CBlockIndex *pIndex = mi != mapBlockIndex.end() ? mi->second : nullptr;
+        if (pIndex == nullptr || pIndex->GetAncestor(pIndexChanged->height) == pIndexChanged) {
+            it = mapForkCache.erase(it);
+            continue;
+        }
+
+        const CBlockIndex *pFork = pIndex->GetAncestor(std::min(pIndex->height, chainActive.Height()));
+        while (pFork != nullptr && !chainActive.Contains(pFork))
+            pFork = pFork->pprev;
+
+        if (pFork == nullptr || chainActive.Height() - pFork->height > maxForkHeight) {
+            it = mapForkCache.erase(it);
+            continue;
+        }
+
+        if (fConnected && !CBlockUndoExecutor(*it->second, blockUndo, true).Execute()) {
+            it = mapForkCache.erase(it);
+            continue;
+        }
+        ++it;
+    }
+}
+
 // Update chainActive and related internal data structures.
 void static UpdateTip(CBlockIndex *pIndexNew, const CBlock &block) {
+    CBlockIndex *pOldTip = chainActive.Tip();
     chainActive.SetTip(pIndexNew);
 
+    bool fConnected = pIndexNew->pprev == pOldTip;
+    UpdateForkCaches(fConnected ? pIndexNew : pOldTip, fConnected);
+
     SyncTransaction(uint256(), nullptr, &block);
 
     // Update best block in wallet (so we can detect restored wallets)
@@ -1372,7 +1432,7 @@ bool static DisconnectTip(CValidationState &state) {
     assert(pIndexDelete);
     // Read block from disk.
     CBlock block;
-    if (!ReadBlockFromDisk(pIndexDelete, block))
+    if (!recentBlockCache.ReadBlock(pIndexDelete, block))
         return state.Abort(_("Failed to read blocks from disk."));
     // Apply the block atomically to the chain state.
     int64_t nStart = GetTimeMicros();
@@ -1382,14 +1442,19 @@ bool static DisconnectTip(CValidationState &state) {
         if (!DisconnectBlock(block, *spCW, pIndexDelete, state))
             return ERRORMSG("DisconnectTip() : DisconnectBlock %s failed", pIndexDelete->GetBlockHash().ToString());
 
-        // Need to re-sync all to global cache layer.
+        // Need to re-sync all to global cache layer, the changed keys decide which mempool txs to re-execute.
+        CDBOpLogMap flushLog;
+        flushLog.SetAccessTracking(true);
+        spCW->SetDbOpLogMap(&flushLog);
         spCW->Flush();
+        spCW->SetDbOpLogMap(nullptr);
+        mempool.AddChangedKeys(flushLog);
 
         // Attention: need to reset the lastest block price median
         CBlockIndex *pPreBlockIndex = pIndexDelete->pprev;
         CBlock preBlock;
         if (pPreBlockIndex) {
-            if (!ReadBlockFromDisk(pPreBlockIndex, preBlock))
+            if (!recentBlockCache.ReadBlock(pPreBlockIndex, preBlock))
                 return ERRORMSG("DisconnectTip() : failed to read block [%d]: %s", pPreBlockIndex->height,
                                 pPreBlockIndex->GetBlockHash().ToString());
 
@@ -1420,11 +1485,13 @@ bool static DisconnectTip(CValidationState &state) {
 }
 
 // Connect a new block to chainActive.
+static void EraseBlockSignatures(const CBlock &block, CCacheWrapper &cw);
+
 bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
     assert(pIndexNew->pprev == chainActive.Tip());
     // Read block from disk.
     CBlock block;
-    if (!ReadBlockFromDisk(pIndexNew, block))
+    if (!recentBlockCache.ReadBlock(pIndexNew, block))
         return state.Abort(strprintf("Failed to read block hash: %s", pIndexNew->GetBlockHash().GetHex()));
 
     // Apply the block automatically to the chain state.
@@ -1445,8 +1512,18 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
             mapBlockSource.erase(inv.hash);
         }
 
-        // Need to re-sync all to global cache layer.
+        // Need to re-sync all to global cache layer, the changed keys decide which mempool txs to re-execute.
+        CDBOpLogMap flushLog;
+        flushLog.SetAccessTracking(true);
+        spCW->SetDbOpLogMap(&flushLog);
         spCW->Flush();
+        spCW->SetDbOpLogMap(nullptr);
+        mempool.AddChangedKeys(flushLog);
+
+        static bool fSigCacheEraseOnConnect =
+            SysCfg().GetBoolArg("-sigcacheeraseonconnect", DEFAULT_SIG_CACHE_ERASE_ON_CONNECT);
+        if (fSigCacheEraseOnConnect)
+            EraseBlockSignatures(block, *spCW);
     }
 
     if (SysCfg().IsBenchmark())
@@ -1460,7 +1537,7 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
     UpdateTip(pIndexNew, block);
 
     for (auto &pTxItem : block.vptx) {
-        mempool.memPoolTxs.erase(pTxItem->GetHash());
+        mempool.RemoveConfirmed(pTxItem->GetHash());
     }
     return true;
 }
@@ -1691,7 +1768,7 @@ bool AddToBlockIndex(CBlock &block, CValidationState &state, const CDiskBlockPos
 }
 
 bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, uint32_t nAddSize, uint32_t height, uint64_t nTime,
-                  bool fKnown = false) {
+                  bool fKnown) {
     bool fUpdatedLast = false;
 
     LOCK(cs_LastBlockFile);
@@ -1760,7 +1837,7 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
                          pPreBlockIndex->height, forkChainTipBlockHash.GetHex());
             } else {
                 CBlock block;
-                if (!ReadBlockFromDisk(pPreBlockIndex, block))
+                if (!recentBlockCache.ReadBlock(pPreBlockIndex, block))
                     return state.Abort(_("Failed to read block"));
 
                 // Reserve the forked chain's blocks.
@@ -1795,7 +1872,7 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
         LogPrint(BCLog::INFO, "ProcessForkedChain() : found [%d]: %s in cache\n",
             pPreBlockIndex->height, forkChainTipBlockHash.GetHex());
     } else {
-        spCW                     = CCacheWrapper::NewCopyFrom(pCdMan);
+        spCW                     = CCacheWrapper::NewOverlayFrom(pCdMan);
         int64_t beginTime        = GetTimeMillis();
         CBlockIndex *pBlockIndex = chainActive.Tip();
 
@@ -1804,7 +1881,7 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
                      pBlockIndex->GetBlockHash().GetHex());
 
             CBlock block;
-            if (!ReadBlockFromDisk(pBlockIndex, block))
+            if (!recentBlockCache.ReadBlock(pBlockIndex, block))
                 return state.Abort(_("Failed to read block"));
 
             bool bfClean = true;
@@ -1838,7 +1915,7 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
         CBlockIndex *pBlockIndex = mapBlockIndex[forkChainBestBlockHash];
         CBlock block;
         if (pBlockIndex) {
-            if (!ReadBlockFromDisk(pBlockIndex, block))
+            if (!recentBlockCache.ReadBlock(pBlockIndex, block))
                 return ERRORMSG("ProcessForkedChain() : failed to read block [%d]: %s", pBlockIndex->height,
                                 pBlockIndex->GetBlockHash().ToString());
 
@@ -1848,7 +1925,7 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
         // TODO: parameterize 11
         int32_t cacheHeight = 11;
         while (pBlockIndex && cacheHeight-- > 0) {
-            if (!ReadBlockFromDisk(pBlockIndex, block))
+            if (!recentBlockCache.ReadBlock(pBlockIndex, block))
                 return ERRORMSG("ProcessForkedChain() : failed to read block [%d]: %s", pBlockIndex->height,
                                 pBlockIndex->GetBlockHash().ToString());
 
@@ -1895,6 +1972,93 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
     return true;
 }
 
+bool IsBlockAssumedValid(const uint256 &blockHash, int32_t height) {
+    AssertLockHeld(cs_main);
+    if (hashAssumeValid.IsNull())
+        return false;
+
+    // the assume-valid block has been received, its ancestors are in the best chain with it
+    auto it = mapBlockIndex.find(hashAssumeValid);
+    if (it != mapBlockIndex.end()) {
+        CBlockIndex *pAssumeValidIndex = it->second;
+        nAssumeValidHeight             = pAssumeValidIndex->height;
+        if (height > pAssumeValidIndex->height || !chainMostWork.Contains(pAssumeValidIndex))
+            return false;
+
+        CBlockIndex *pIndex = chainMostWork[height];
+        return pIndex != nullptr && pIndex->GetBlockHash() == blockHash;
+    }
+
+    // otherwise the sync headers are a continuous chain, the block is an ancestor of the assume-valid
+    // block if both of them are in it
+    int32_t assumeValidHeight = nAssumeValidHeight;
+    return height <= assumeValidHeight && IsSyncHeader(hashAssumeValid, assumeValidHeight) &&
+           IsSyncHeader(blockHash, height);
+}
+
+// Get the signature item of the tx signed by the owner of txUid, the other txs are skipped and
+// their signatures will be checked by CheckTx() as usual.
+static bool GetTxSignatureItem(CBaseTx &tx, CCacheWrapper &cw, CSignatureItem &item) {
+    if (tx.IsBlockRewardTx() || tx.IsPriceMedianTx() || tx.signature.empty())
+        return false;
+
+    if (tx.txUid.is<CPubKey>()) {
+        item.pubKey = tx.txUid.get<CPubKey>();
+    } else {
+        CAccount account;
+        if (!cw.accountCache.GetAccount(tx.txUid, account))
+            return false;
+
+        item.pubKey = account.owner_pubkey;
+        blockPipeline.AddOwnerPubKey(tx.txUid, item.pubKey);
+    }
+
+    if (!item.pubKey.IsFullyValid())
+        return false;
+
+    item.sigHash   = tx.GetHash();
+    item.signature = tx.signature;
+    return true;
+}
+
+// Verify the tx signatures of block in parallel before checking txs one by one
+static void PreVerifyBlockSignatures(const CBlock &block, CCacheWrapper &cw) {
+    int64_t nStart = GetTimeMicros();
+
+    vector<CSignatureItem> sigItems;
+    sigItems.reserve(block.vptx.size());
+    for (const auto &pTx : block.vptx) {
+        CSignatureItem item;
+        if (GetTxSignatureItem(*pTx, cw, item))
+            sigItems.push_back(std::move(item));
+    }
+
+    uint32_t validCount = sigCheckPool.Verify(sigItems, signatureCache);
+    if (SysCfg().IsBenchmark())
+        LogPrint(BCLog::INFO, "- Verify %u signatures (%u valid) with %d threads: %.2fms\n", sigItems.size(),
+                 validCount, sigCheckPool.GetThreadCount(), 0.001 * (GetTimeMicros() - nStart));
+}
+
+// Erase the signature cache entries of the connected block, which will not be checked again
+// except on a reorg, to leave the room to the signatures of the mempool txs
+static void EraseBlockSignatures(const CBlock &block, CCacheWrapper &cw) {
+    for (const auto &pTx : block.vptx) {
+        CSignatureItem item;
+        if (GetTxSignatureItem(*pTx, cw, item))
+            signatureCache.Erase(item.sigHash, item.signature, item.pubKey);
+    }
+}
+
+bool IsContinuousHeaders(const vector<CBlock> &vHeaders) {
+    for (size_t i = 1; i < vHeaders.size(); i++) {
+        if (vHeaders[i].GetPrevBlockHash() != vHeaders[i - 1].GetHash() ||
+            vHeaders[i].GetHeight() != vHeaders[i - 1].GetHeight() + 1)
+            return false;
+    }
+
+    return true;
+}
+
 bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw, bool fCheckTx, bool fCheckMerkleRoot) {
     if (block.vptx.empty() || block.vptx.size() > MAX_BLOCK_SIZE ||
         ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION) > MAX_BLOCK_SIZE)
@@ -1920,6 +2084,10 @@ bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw,
     // recalculated many times during this block's validation.
     block.BuildMerkleTree();
 
+    bool fSkipSignatureCheck = fCheckTx && IsBlockAssumedValid(block.GetHash(), block.GetHeight());
+    if (fCheckTx && !fSkipSignatureCheck)
+        PreVerifyBlockSignatures(block, cw);
+
     // Check for duplicate txids. This is caught by ConnectInputs(),
     // but catching it earlier avoids a potential DoS attack:
     set<uint256> uniqueTx;
@@ -1929,6 +2097,7 @@ bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw,
 
         uint32_t prevBlockTime = block.GetTime(); // the prev block maybe unkown when checking block
         CTxExecuteContext context(block.GetHeight(), i + 1, block.GetFuelRate(), block.GetTime(), prevBlockTime, &cw, &state);
+        context.skip_signature_check = fSkipSignatureCheck;
         if (fCheckTx && !block.vptx[i]->CheckTx(context))
             return ERRORMSG("CheckBlock() : CheckTx failed, txid: %s", block.vptx[i]->GetHash().GetHex());
 
@@ -2037,6 +2206,9 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp, boo
         if (dbp == nullptr && !WriteBlockToDisk(block, blockPos))
             return state.Abort(_("Failed to write block"));
 
+        // keep the accepted block in memory, it will be connected soon
+        recentBlockCache.Add(block);
+
         if (!AddToBlockIndex(block, state, blockPos))
             return ERRORMSG("AcceptBlock() : AddToBlockIndex failed");
 
@@ -2048,15 +2220,33 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp, boo
     CBlockIndex* pTip = chainActive.Tip() ;
     if (pTip->GetBlockHash() == blockHash) {
         {
+            // the compact block is built once, the peers rebuild the block from their mempools. The
+            // delegates push the new blocks to every peer, the others push them to the peers asking for
+            // the push by sendcmpct and announce them to the rest.
+            std::shared_ptr<CBlockHeaderAndShortTxIds> spCmpctBlock;
+            const CInv blockInv(MSG_BLOCK, blockHash);
             LOCK(cs_vNodes);
             for (auto pNode : vNodes) {
+                bool fRelay = chainActive.Height() > (pNode->nStartingHeight != -1 ? pNode->nStartingHeight - 2000 : 0);
+                if (fCompactBlocks && pNode->fSupportsCompactBlocks && (mining || (fRelay && pNode->fPreferCompactBlocks))) {
+                    {
+                        LOCK(pNode->cs_inventory);
+                        if (!pNode->setInventoryKnown.insert(blockInv).second)
+                            continue;
+                    }
+                    if (spCmpctBlock == nullptr)
+                        spCmpctBlock = std::make_shared<CBlockHeaderAndShortTxIds>(block);
+
+                    pNode->PushMessage(NetMsgType::CMPCTBLOCK, *spCmpctBlock);
+                    continue;
+                }
                 //p2p_xiaoyu_20191116
                 if (mining) {
                     pNode->PushMessage(NetMsgType::BLOCK, block);
                     continue;
                 }
-                if (chainActive.Height() > (pNode->nStartingHeight != -1 ? pNode->nStartingHeight - 2000 : 0))
-                    pNode->PushInventory(CInv(MSG_BLOCK, blockHash));
+                if (fRelay)
+                    pNode->PushInventory(blockInv);
             }
         }
 
@@ -2244,6 +2434,13 @@ bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBl
                 setOrphanBlock.insert(pblock2);
             }
 
+            // The parents of a block in the sync headers are being downloaded already
+            if (IsSyncHeader(blockHash, pBlock->GetHeight())) {
+                LogPrint(BCLog::NET, "receive a block height=%d hash=%s ahead of its parents, %s it\n",
+                         pBlock->GetHeight(), blockHash.GetHex(), success ? "keep" : "abandon");
+                return true;
+            }
+
             // Ask this guy to fill in what we're missing
             LogPrint(BCLog::NET,
                      "receive an orphan block height=%d hash=%s, %s it, leading to getblocks (current block height=%d, "
@@ -2406,6 +2603,10 @@ bool VerifyDB(int32_t nCheckLevel, int32_t nCheckDepth) {
         if (pIndex->height < chainActive.Height() - nCheckDepth)
             break;
 
+        // the blocks below the tip of a loaded state snapshot can't be disconnected
+        if (!(pIndex->nStatus & BLOCK_HAVE_UNDO))
+            break;
+
         CBlock block;
         // check level 0: read from disk
         if (!ReadBlockFromDisk(pIndex, block))
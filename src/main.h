@@ -12,6 +12,7 @@
 
 #include <stdint.h>
 #include <algorithm>
+#include <atomic>
 #include <exception>
 #include <map>
 #include <set>
@@ -25,13 +26,16 @@
 #include "config/chainparams.h"
 #include "config/const.h"
 #include "config/errorcode.h"
+#include "chain/blockpipeline.h"
 #include "chain/chain.h"
 #include "chain/merkletree.h"
 #include "net.h"
+#include "p2p/compactblock.h"
 #include "p2p/node.h"
 #include "persistence/cachewrapper.h"
 #include "sigcache.h"
 #include "tx/tx.h"
+#include "tx/txadmission.h"
 #include "tx/txmempool.h"
 //#include "tx/txserializer.h"
 
@@ -43,6 +47,11 @@ extern CCriticalSection cs_main;
 /** The currently-connected chain of blocks. */
 extern CChain chainActive;
 extern CSignatureCache signatureCache;
+extern CSignatureCheckPool sigCheckPool;
+extern CRecentBlockCache recentBlockCache;
+extern CSerializedBlockCache serializedBlockCache;
+extern CBlockPipeline blockPipeline;
+extern CTxAdmissionQueue txAdmission;
 
 extern CTxMemPool mempool;
 extern map<uint256, CBlockIndex *> mapBlockIndex;
@@ -193,6 +202,12 @@ public:
 extern CChain chainMostWork;
 extern CCacheDBManager *pCdMan;
 extern int32_t nSyncTipHeight;
+/** The block set by -assumevalid, the signatures in its ancestors are not verified (null = disabled) */
+extern uint256 hashAssumeValid;
+/** The height of the -assumevalid block once its header is known, -1 if not known yet */
+extern std::atomic<int32_t> nAssumeValidHeight;
+/** Relay the new blocks as compact blocks to the peers supporting them, set by -compactblocks */
+extern bool fCompactBlocks;
 extern std::tuple<bool, boost::thread *> RunCoin(int32_t argc, char *argv[]);
 extern string externalIp;
 
@@ -222,6 +237,16 @@ bool ConnectBlock   (CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CVal
 // Add this block to the block index, and if necessary, switch the active block chain to this
 bool AddToBlockIndex(CBlock &block, CValidationState &state, const CDiskBlockPos &pos);
 
+// Find the position in the block files to write a block of nAddSize bytes
+bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, uint32_t nAddSize, uint32_t height, uint64_t nTime,
+                  bool fKnown = false);
+
+// Whether the block is an ancestor of the -assumevalid block in the best known chain, requires cs_main
+bool IsBlockAssumedValid(const uint256 &blockHash, int32_t height);
+
+// Whether each header follows the previous one by its prev hash and height
+bool IsContinuousHeaders(const vector<CBlock> &vHeaders);
+
 // Context-independent validity checks
 bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw,
                 bool fCheckTx = true, bool fCheckMerkleRoot = true);
@@ -252,6 +277,8 @@ void PushGetBlocks(CNode *pNode, CBlockIndex *pindexBegin, uint256 hashEnd);
 void PushGetBlocksOnCondition(CNode *pNode, CBlockIndex *pindexBegin, uint256 hashEnd);
 /** Process an incoming block */
 bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBlockPos *dbp = nullptr);
+/** Process a block received from the peer, the block has been marked as received */
+void ProcessReceivedBlock(CNode *pFrom, CBlock &block);
 /** Print the loaded block tree */
 void PrintBlockTree();
 
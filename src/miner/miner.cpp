@@ -82,29 +82,11 @@ uint32_t GetElementForBurn(CBlockIndex *pIndex) {
     return newFuelRate;
 }
 
-// Sort transactions by priority and fee to decide priority orders to process transactions.
-void GetPriorityTx(int32_t height, set<TxPriority> &txPriorities, const int32_t nFuelRate) {
-    static TokenSymbol feeSymbol;
-    static uint64_t fee    = 0;
-    static uint32_t txSize = 0;
-    static double feePerKb = 0;
-    static double priority = 0;
-
-    for (map<uint256, CTxMemPoolEntry>::iterator mi = mempool.memPoolTxs.begin(); mi != mempool.memPoolTxs.end(); ++mi) {
-        CBaseTx *pBaseTx = mi->second.GetTransaction().get();
-        if (!pBaseTx->IsBlockRewardTx() && !pCdMan->pTxCache->HaveTx(pBaseTx->GetHash())) {
-            feeSymbol = std::get<0>(mi->second.GetFees());
-            fee       = std::get<1>(mi->second.GetFees());
-            txSize    = mi->second.GetTxSize();
-            feePerKb  = double(fee - pBaseTx->GetFuel(height, nFuelRate)) / txSize * 1000.0;
-            priority  = mi->second.GetPriority();
-
-            txPriorities.emplace(TxPriority(priority, feePerKb, mi->second.GetTransaction()));
-        }
-    }
+// Whether the tx of mempool should be packed, the txs confirmed in the meantime are skipped
+static bool IsPackableTx(CBaseTx *pBaseTx) {
+    return !pBaseTx->IsBlockRewardTx() && !pCdMan->pTxCache->HaveTx(pBaseTx->GetHash());
 }
 
-
 bool GetCurrentDelegate(const int64_t currentTime, const int32_t currHeight, const VoteDelegateVector &delegates,
                                VoteDelegate &delegate) {
 
@@ -240,7 +222,9 @@ bool VerifyRewardTx(const CBlock *pBlock, CCacheWrapper &cwIn, bool bNeedRunTx,
             return ERRORMSG("VerifyRewardTx() : invalid block signature size, hash=%s", blockHash.ToString());
         }
 
-        if (!VerifySignature(blockHash, blockSignature, account.owner_pubkey))
+        // the block signature of an ancestor of the -assumevalid block is trusted
+        if (!IsBlockAssumedValid(blockHash, pBlock->GetHeight()) &&
+            !VerifySignature(blockHash, blockSignature, account.owner_pubkey))
             if (!VerifySignature(blockHash, blockSignature, account.miner_pubkey))
                 return ERRORMSG("VerifyRewardTx() : verify signature error");
     } else {
@@ -312,16 +296,19 @@ static bool CreateNewBlockPreStableCoinRelease(CCacheWrapper &cwIn, std::unique_
         uint64_t totalFuel      = 0;
         uint64_t reward         = 0;
 
-        // Calculate && sort transactions from memory pool.
-        set<TxPriority> txPriorities;
-        GetPriorityTx(height, txPriorities, fuelRate);
-
+        // The mempool keeps the transactions sorted by priority rules.
         LogPrint(BCLog::MINER, "CreateNewBlockPreStableCoinRelease() : got %lu transaction(s) sorted by priority rules\n",
-                 txPriorities.size());
+                 mempool.txPriorities.size());
+
+        // The overlay of cwIn is reused by all transactions, a packed tx is flushed to cwIn and
+        // the dirty data of a failed tx is discarded before packing the next one.
+        auto spCW = std::make_shared<CCacheWrapper>(&cwIn);
 
         // Collect transactions into the block.
-        for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor) {
+        for (auto itor = mempool.txPriorities.rbegin(); itor != mempool.txPriorities.rend(); ++itor) {
             CBaseTx *pBaseTx = itor->baseTx.get();
+            if (!IsPackableTx(pBaseTx))
+                continue;
 
             uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
             if (totalBlockSize + txSize >= nBlockMaxSize) {
@@ -330,7 +317,7 @@ static bool CreateNewBlockPreStableCoinRelease(CCacheWrapper &cwIn, std::unique_
                 continue;
             }
 
-            auto spCW = std::make_shared<CCacheWrapper>(&cwIn);
+            spCW->Clear();
 
             try {
                 CValidationState state;
@@ -444,18 +431,31 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
         uint64_t totalFuel                 = 0;
         map<TokenSymbol, uint64_t> rewards = {{SYMB::WICC, 0}, {SYMB::WUSD, 0}};
 
-        // Calculate && sort transactions from memory pool.
-        set<TxPriority> txPriorities;
-        GetPriorityTx(height, txPriorities, fuelRate);
-
-        // Push block price median transaction into queue.
-        txPriorities.emplace(TxPriority(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, std::make_shared<CBlockPriceMedianTx>(height)));
+        // The mempool keeps the transactions sorted by priority rules, the block price median
+        // transaction is packed right after the mempool transactions of higher priority class.
+        TxPriority priceMedianTx(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, std::make_shared<CBlockPriceMedianTx>(height));
+        bool priceMedianTxPushed = false;
 
         LogPrint(BCLog::MINER, "CreateNewBlockStableCoinRelease() : got %lu transaction(s) sorted by priority rules\n",
-                 txPriorities.size());
+                 mempool.txPriorities.size() + 1);
+
+        // The overlay of cwIn is reused by all transactions, a packed tx is flushed to cwIn and
+        // the dirty data of a failed tx is discarded before packing the next one.
+        auto spCW = std::make_shared<CCacheWrapper>(&cwIn);
 
         // Collect transactions into the block.
-        for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor) {
+        auto mempoolItor = mempool.txPriorities.rbegin();
+        while (true) {
+            const TxPriority *itor = nullptr;
+            if (!priceMedianTxPushed &&
+                (mempoolItor == mempool.txPriorities.rend() || (*mempoolItor < priceMedianTx))) {
+                itor                = &priceMedianTx;
+                priceMedianTxPushed = true;
+            } else if (mempoolItor != mempool.txPriorities.rend()) {
+                itor = &*(mempoolItor++);
+            } else {
+                break;
+            }
 
             if (!CheckPackBlockTime(startMiningMs, height)) {
                 LogPrint(BCLog::MINER, "%s() : no time left to pack more tx, ignore! height=%d, start_ms=%lld, tx_count=%u\n",
@@ -464,6 +464,8 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
             }
 
             CBaseTx *pBaseTx = itor->baseTx.get();
+            if (!pBaseTx->IsPriceMedianTx() && !IsPackableTx(pBaseTx))
+                continue;
 
             uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
             if (totalBlockSize + txSize >= nBlockMaxSize) {
@@ -472,7 +474,7 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
                 continue;
             }
 
-            auto spCW = std::make_shared<CCacheWrapper>(&cwIn);
+            spCW->Clear();
 
             try {
                 CValidationState state;
@@ -22,6 +22,10 @@
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -33,10 +37,13 @@
 #include <sys/sysinfo.h>
 #include <sys/utsname.h>
 
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <unordered_map>
 
 #include <boost/filesystem.hpp>
 
@@ -478,8 +485,304 @@ CNode* ConnectNode(CAddress addrConnect, const char* pszDest) {
 
 static list<CNode*> vNodesDisconnected;
 
+/** Maximum number of the socket events handled by one epoll_wait() */
+static const int32_t MAX_SOCKET_EVENTS = 256;
+/** Maximum number of the recv() of a node in a round, the nodes left readable are serviced again at once */
+static const int32_t MAX_SOCKET_RECV_ROUNDS = 4;
+/** Milliseconds to wait for the socket events, the frequency to check the disconnected and idle nodes */
+static const int32_t SOCKET_WAIT_MILLIS = 50;
+
+#ifdef HAVE_SYS_EPOLL_H
+static SOCKET hEpollSocket = INVALID_SOCKET;
+#endif
+
+// Signal a message handler when a complete message is queued, instead of waiting for its next poll
+static std::mutex mutexMsgProc;
+static std::condition_variable condMsgProc;
+static std::condition_variable condPriorityMsgProc;
+static bool fMsgProcWake         = false;
+static bool fPriorityMsgProcWake = false;
+
+void WakeMessageHandler(bool fGeneral, bool fPriority) {
+    if (!fGeneral && !fPriority)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutexMsgProc);
+        fMsgProcWake |= fGeneral;
+        fPriorityMsgProcWake |= fPriority;
+    }
+    if (fGeneral)
+        condMsgProc.notify_one();
+    if (fPriority)
+        condPriorityMsgProc.notify_one();
+}
+
+// Accept a connection of the listening socket, return false if there is no connection to accept
+static bool AcceptConnection(SOCKET hListenSocket) {
+    struct sockaddr_storage sockaddr;
+    socklen_t len  = sizeof(sockaddr);
+    SOCKET hSocket = accept(hListenSocket, (struct sockaddr*)&sockaddr, &len);
+    CAddress addr;
+    int32_t nInbound = 0;
+
+    if (hSocket != INVALID_SOCKET)
+        if (!addr.SetSockAddr((const struct sockaddr*)&sockaddr))
+            LogPrint(BCLog::INFO, "Warning: Unknown socket family\n");
+
+    {
+        LOCK(cs_vNodes);
+        for (auto pNode : vNodes)
+            if (pNode->fInbound)
+                nInbound++;
+    }
+
+    if (hSocket == INVALID_SOCKET) {
+        int32_t nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK)
+            LogPrint(BCLog::INFO, "socket[%s] error accept failed: %s\n", addr.ToString(), NetworkErrorString(nErr));
+        return false;
+    } else if (nInbound >= nMaxConnections - MAX_OUTBOUND_CONNECTIONS) {
+        closesocket(hSocket);
+    } else if (CNode::IsBanned(addr)) {
+        LogPrint(BCLog::INFO, "connection from %s dropped (banned)\n", addr.ToString());
+        closesocket(hSocket);
+    } else {
+        LogPrint(BCLog::NET, "accepted connection %s\n", addr.ToString());
+        CNode* pNode = new CNode(hSocket, addr, "", true);
+        pNode->AddRef();
+        {
+            LOCK(cs_vNodes);
+            vNodes.push_back(pNode);
+        }
+    }
+    return true;
+}
+
+// Wait for the sockets with select(), the readiness of the nodes is found again in every round
+static void WaitSocketEventsSelect(const vector<CNode*>& vNodesCopy, vector<SOCKET>& vListenReady) {
+    struct timeval timeout;
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = SOCKET_WAIT_MILLIS * 1000;  // frequency to poll pNode->vSend
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds     = false;
+
+    for (auto hListenSocket : vhListenSocket) {
+        FD_SET(hListenSocket, &fdsetRecv);
+        hSocketMax = max(hSocketMax, hListenSocket);
+        have_fds   = true;
+    }
+
+    for (auto pNode : vNodesCopy) {
+        pNode->fSocketReadable = false;
+        pNode->fSocketWritable = false;
+        if (pNode->hSocket == INVALID_SOCKET || pNode->hSocket >= FD_SETSIZE)
+            continue;
+
+        FD_SET(pNode->hSocket, &fdsetError);
+        hSocketMax = max(hSocketMax, pNode->hSocket);
+        have_fds   = true;
+
+        // Implement the following logic:
+        // * If there is data to send, select() for sending data. As this only
+        //   happens when optimistic write failed, we choose to first drain the
+        //   write buffer in this case before receiving more. This avoids
+        //   needlessly queueing received data, if the remote peer is not themselves
+        //   receiving data. This means properly utilizing TCP flow control signalling.
+        // * Otherwise, if there is no (complete) message in the receive buffer,
+        //   or there is space left in the buffer, select() for receiving data.
+        // * (if neither of the above applies, there is certainly one message
+        //   in the receiver buffer ready to be processed).
+        // Together, that means that at least one of the following is always possible,
+        // so we don't deadlock:
+        // * We send some data.
+        // * We wait for data to be received (and disconnect after timeout).
+        // * We process a message in the buffer (message handler thread).
+        {
+            TRY_LOCK(pNode->cs_vSend, lockSend);
+            if (lockSend && !pNode->vSendMsg.empty()) {
+                FD_SET(pNode->hSocket, &fdsetSend);
+                continue;
+            }
+        }
+        {
+            TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
+            if (lockRecv && pNode->GetProcessQueueSize() <= ReceiveFloodSize())
+                FD_SET(pNode->hSocket, &fdsetRecv);
+        }
+    }
+
+    int32_t nSelect = select(have_fds ? hSocketMax + 1 : 0, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    boost::this_thread::interruption_point();
+
+    if (nSelect == SOCKET_ERROR) {
+        if (have_fds) {
+            int32_t nErr = WSAGetLastError();
+            LogPrint(BCLog::INFO, "socket select error %s\n", NetworkErrorString(nErr));
+            for (uint32_t i = 0; i <= hSocketMax; i++)
+                FD_SET(i, &fdsetRecv);
+        }
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        MilliSleep(timeout.tv_usec / 1000);
+    }
+
+    for (auto hListenSocket : vhListenSocket) {
+        if (hListenSocket != INVALID_SOCKET && FD_ISSET(hListenSocket, &fdsetRecv))
+            vListenReady.push_back(hListenSocket);
+    }
+
+    for (auto pNode : vNodesCopy) {
+        if (pNode->hSocket == INVALID_SOCKET || pNode->hSocket >= FD_SETSIZE)
+            continue;
+
+        pNode->fSocketReadable = FD_ISSET(pNode->hSocket, &fdsetRecv) || FD_ISSET(pNode->hSocket, &fdsetError);
+        pNode->fSocketWritable = FD_ISSET(pNode->hSocket, &fdsetSend);
+    }
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static bool StartSocketEvents() {
+    hEpollSocket = epoll_create1(EPOLL_CLOEXEC);
+    if (hEpollSocket == INVALID_SOCKET) {
+        LogPrint(BCLog::INFO, "epoll_create1 failed: %s, fall back to select()\n", NetworkErrorString(WSAGetLastError()));
+        return false;
+    }
+
+    for (auto hListenSocket : vhListenSocket) {
+        struct epoll_event event;
+        event.events  = EPOLLIN | EPOLLET;
+        event.data.fd = hListenSocket;
+        if (epoll_ctl(hEpollSocket, EPOLL_CTL_ADD, hListenSocket, &event) != 0) {
+            LogPrint(BCLog::INFO, "epoll_ctl of the listening socket failed: %s, fall back to select()\n",
+                     NetworkErrorString(WSAGetLastError()));
+            closesocket(hEpollSocket);
+            hEpollSocket = INVALID_SOCKET;
+            return false;
+        }
+    }
+
+    LogPrint(BCLog::NET, "using epoll for the socket events\n");
+    return true;
+}
+
+// Wait for the edge-triggered socket events, a node stays readable or writable until the socket would block.
+// The closed sockets are removed from the epoll set by the kernel.
+static void WaitSocketEventsEpoll(const vector<CNode*>& vNodesCopy, vector<SOCKET>& vListenReady, bool fPending) {
+    unordered_map<SOCKET, CNode*> mapSocketNode;
+    for (auto pNode : vNodesCopy) {
+        if (pNode->hSocket == INVALID_SOCKET)
+            continue;
+
+        if (!pNode->fSocketEventsAdded) {
+            struct epoll_event event;
+            event.events  = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            event.data.fd = pNode->hSocket;
+            if (epoll_ctl(hEpollSocket, EPOLL_CTL_ADD, pNode->hSocket, &event) != 0) {
+                LogPrint(BCLog::INFO, "socket[%s] epoll_ctl failed: %s\n", pNode->addr.ToString(),
+                         NetworkErrorString(WSAGetLastError()));
+                pNode->CloseSocketDisconnect();
+                continue;
+            }
+            pNode->fSocketEventsAdded = true;
+        }
+        mapSocketNode[pNode->hSocket] = pNode;
+    }
+
+    struct epoll_event events[MAX_SOCKET_EVENTS];
+    int32_t nEvents = epoll_wait(hEpollSocket, events, MAX_SOCKET_EVENTS, fPending ? 0 : SOCKET_WAIT_MILLIS);
+    boost::this_thread::interruption_point();
+
+    if (nEvents == SOCKET_ERROR) {
+        int32_t nErr = WSAGetLastError();
+        if (nErr != WSAEINTR)
+            LogPrint(BCLog::INFO, "socket epoll_wait error %s\n", NetworkErrorString(nErr));
+        return;
+    }
+
+    for (int32_t i = 0; i < nEvents; i++) {
+        SOCKET hSocket = events[i].data.fd;
+        if (find(vhListenSocket.begin(), vhListenSocket.end(), hSocket) != vhListenSocket.end()) {
+            vListenReady.push_back(hSocket);
+            continue;
+        }
+
+        auto it = mapSocketNode.find(hSocket);
+        if (it == mapSocketNode.end())
+            continue;
+
+        if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            it->second->fSocketReadable = true;
+        if (events[i].events & (EPOLLOUT | EPOLLERR))
+            it->second->fSocketWritable = true;
+    }
+}
+#endif
+
+// Receive from the readable socket up to nMaxReads times, return false if the node is left readable since
+// it reaches nMaxReads. The node is not read while its receive buffer is full.
+static bool ReceiveFromSocket(CNode* pNode, int32_t nMaxReads) {
+    TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
+    if (!lockRecv)
+        return true;
+
+    for (int32_t i = 0; i < nMaxReads; i++) {
+        if (pNode->hSocket == INVALID_SOCKET || !pNode->fSocketReadable)
+            return true;
+
+        // the complete messages not processed yet are over the limit
+        if (pNode->GetProcessQueueSize() > ReceiveFloodSize())
+            return true;
+
+        // typical socket buffer is 8K-64K
+        char pchBuf[0x10000];
+        int32_t nBytes = recv(pNode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+        if (nBytes > 0) {
+            if (!pNode->ReceiveMsgBytes(pchBuf, nBytes))
+                pNode->CloseSocketDisconnect();
+            pNode->nLastRecv = GetTime();
+            pNode->nRecvBytes += nBytes;
+            pNode->RecordBytesRecv(nBytes);
+
+            bool fGeneral, fPriority;
+            pNode->QueueCompleteMessages(&fGeneral, &fPriority);
+            WakeMessageHandler(fGeneral, fPriority);
+        } else if (nBytes == 0) {
+            // socket closed gracefully
+            if (!pNode->fDisconnect)
+                LogPrint(BCLog::NET, "socket[%s] closed\n", pNode->addr.ToString());
+            pNode->CloseSocketDisconnect();
+        } else if (nBytes < 0) {
+            // error
+            int32_t nErr = WSAGetLastError();
+            if (nErr == WSAEWOULDBLOCK) {
+                pNode->fSocketReadable = false;
+            } else if (nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS) {
+                if (!pNode->fDisconnect)
+                    LogPrint(BCLog::INFO, "socket[%s] recv error %s\n", pNode->addr.ToString(), NetworkErrorString(nErr));
+                pNode->CloseSocketDisconnect();
+            }
+        }
+    }
+
+    return pNode->hSocket == INVALID_SOCKET || !pNode->fSocketReadable;
+}
+
 void ThreadSocketHandler() {
     uint32_t nPrevNodeCount = 0;
+    bool fEpoll             = false;
+#ifdef HAVE_SYS_EPOLL_H
+    fEpoll = StartSocketEvents();
+#endif
+    bool fPending = false;  // some nodes are left readable in the last round
+
     while (true) {
         //
         // Disconnect nodes
@@ -490,7 +793,8 @@ void ThreadSocketHandler() {
             vector<CNode*> vNodesCopy = vNodes;
             for (auto pNode : vNodesCopy) {
                 if (pNode->fDisconnect || (pNode->GetRefCount() <= 0 && pNode->vRecvMsg.empty() &&
-                                           pNode->nSendSize == 0 && pNode->ssSend.empty())) {
+                                           pNode->GetProcessQueueSize() == 0 && pNode->nSendSize == 0 &&
+                                           pNode->ssSend.empty())) {
                     // remove from vNodes
                     vNodes.erase(remove(vNodes.begin(), vNodes.end(), pNode), vNodes.end());
 
@@ -539,136 +843,42 @@ void ThreadSocketHandler() {
             LogPrint(BCLog::INFO, "Connections number changed, %d -> %d\n", nPrevNodeCount, vNodes.size());
         }
 
-        //
-        // Find which sockets have data to receive
-        //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000;  // frequency to poll pNode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds     = false;
-
-        for (auto hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket);
-            have_fds   = true;
-        }
-
+        vector<CNode*> vNodesCopy;
         {
             LOCK(cs_vNodes);
-            for (auto pNode : vNodes) {
-                if (pNode->hSocket == INVALID_SOCKET)
-                    continue;
-
-                FD_SET(pNode->hSocket, &fdsetError);
-                hSocketMax = max(hSocketMax, pNode->hSocket);
-                have_fds   = true;
-
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
-                // * (if neither of the above applies, there is certainly one message
-                //   in the receiver buffer ready to be processed).
-                // Together, that means that at least one of the following is always possible,
-                // so we don't deadlock:
-                // * We send some data.
-                // * We wait for data to be received (and disconnect after timeout).
-                // * We process a message in the buffer (message handler thread).
-                {
-                    TRY_LOCK(pNode->cs_vSend, lockSend);
-                    if (lockSend && !pNode->vSendMsg.empty()) {
-                        FD_SET(pNode->hSocket, &fdsetSend);
-                        continue;
-                    }
-                }
-                {
-                    TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
-                    if (lockRecv && (pNode->vRecvMsg.empty() || !pNode->vRecvMsg.front().complete() ||
-                                     pNode->GetTotalRecvSize() <= ReceiveFloodSize()))
-                        FD_SET(pNode->hSocket, &fdsetRecv);
-                }
-            }
+            vNodesCopy = vNodes;
+            for (auto pNode : vNodesCopy)
+                pNode->AddRef();
         }
 
-        int32_t nSelect = select(have_fds ? hSocketMax + 1 : 0, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
-        boost::this_thread::interruption_point();
-
-        if (nSelect == SOCKET_ERROR) {
-            if (have_fds) {
-                int32_t nErr = WSAGetLastError();
-                LogPrint(BCLog::INFO, "socket select error %s\n", NetworkErrorString(nErr));
-                for (uint32_t i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec / 1000);
-        }
+        //
+        // Find which sockets have data to receive
+        //
+        vector<SOCKET> vListenReady;
+#ifdef HAVE_SYS_EPOLL_H
+        if (fEpoll)
+            WaitSocketEventsEpoll(vNodesCopy, vListenReady, fPending);
+        else
+#endif
+            WaitSocketEventsSelect(vNodesCopy, vListenReady);
 
         //
         // Accept new connections
         //
-        for (auto hListenSocket : vhListenSocket)
-            if (hListenSocket != INVALID_SOCKET && FD_ISSET(hListenSocket, &fdsetRecv)) {
-                struct sockaddr_storage sockaddr;
-                socklen_t len  = sizeof(sockaddr);
-                SOCKET hSocket = accept(hListenSocket, (struct sockaddr*)&sockaddr, &len);
-                CAddress addr;
-                int32_t nInbound = 0;
-
-                if (hSocket != INVALID_SOCKET)
-                    if (!addr.SetSockAddr((const struct sockaddr*)&sockaddr))
-                        LogPrint(BCLog::INFO, "Warning: Unknown socket family\n");
-
-                {
-                    LOCK(cs_vNodes);
-                    for (auto pNode : vNodes)
-                        if (pNode->fInbound)
-                            nInbound++;
-                }
-
-                if (hSocket == INVALID_SOCKET) {
-                    int32_t nErr = WSAGetLastError();
-                    if (nErr != WSAEWOULDBLOCK)
-                        LogPrint(BCLog::INFO, "socket[%s] error accept failed: %s\n", addr.ToString(), NetworkErrorString(nErr));
-                } else if (nInbound >= nMaxConnections - MAX_OUTBOUND_CONNECTIONS) {
-                    closesocket(hSocket);
-                } else if (CNode::IsBanned(addr)) {
-                    LogPrint(BCLog::INFO, "connection from %s dropped (banned)\n", addr.ToString());
-                    closesocket(hSocket);
-                } else {
-                    LogPrint(BCLog::NET, "accepted connection %s\n", addr.ToString());
-                    CNode* pNode = new CNode(hSocket, addr, "", true);
-                    pNode->AddRef();
-                    {
-                        LOCK(cs_vNodes);
-                        vNodes.push_back(pNode);
-                    }
-                }
+        for (auto hListenSocket : vListenReady) {
+            if (!fEpoll) {
+                AcceptConnection(hListenSocket);
+                continue;
             }
 
+            // the edge-triggered listening socket is not reported again until all connections are accepted
+            while (AcceptConnection(hListenSocket)) {}
+        }
+
         //
         // Service each socket
         //
-        vector<CNode*> vNodesCopy;
-        {
-            LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            for (auto pNode : vNodesCopy)
-                pNode->AddRef();
-        }
+        fPending = false;
         for (auto pNode : vNodesCopy) {
             boost::this_thread::interruption_point();
 
@@ -677,47 +887,22 @@ void ThreadSocketHandler() {
             //
             if (pNode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pNode->hSocket, &fdsetRecv) || FD_ISSET(pNode->hSocket, &fdsetError)) {
-                TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
-                if (lockRecv) {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int32_t nBytes = recv(pNode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        if (nBytes > 0) {
-                            if (!pNode->ReceiveMsgBytes(pchBuf, nBytes))
-                                pNode->CloseSocketDisconnect();
-                            pNode->nLastRecv = GetTime();
-                            pNode->nRecvBytes += nBytes;
-                            pNode->RecordBytesRecv(nBytes);
-                        } else if (nBytes == 0) {
-                            // socket closed gracefully
-                            if (!pNode->fDisconnect)
-                                LogPrint(BCLog::NET, "socket[%s] closed\n", pNode->addr.ToString());
-                            pNode->CloseSocketDisconnect();
-                        } else if (nBytes < 0) {
-                            // error
-                            int32_t nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR &&
-                                nErr != WSAEINPROGRESS) {
-                                if (!pNode->fDisconnect)
-                                    LogPrint(BCLog::INFO, "socket[%s] recv error %s\n", pNode->addr.ToString(), NetworkErrorString(nErr));
-                                pNode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
-                }
-            }
+            if (pNode->fSocketReadable && !ReceiveFromSocket(pNode, fEpoll ? MAX_SOCKET_RECV_ROUNDS : 1))
+                fPending = true;
 
             //
             // Send
             //
             if (pNode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pNode->hSocket, &fdsetSend)) {
+            if (pNode->fSocketWritable) {
                 TRY_LOCK(pNode->cs_vSend, lockSend);
-                if (lockSend)
+                if (lockSend && !pNode->vSendMsg.empty()) {
                     pNode->SocketSendData();
+                    // the data is left only if the socket would block
+                    if (!pNode->vSendMsg.empty())
+                        pNode->fSocketWritable = false;
+                }
             }
 
             //
@@ -1171,7 +1356,9 @@ void static StartSync(const vector<CNode*>& vNodes) {
     }
 }
 
-void ThreadMessageHandler() {
+// The message handlers process the messages of the different peers in parallel, a peer is processed and
+// sent to by one handler at a time. The first one also starts the block sync.
+void ThreadMessageHandler(int32_t nHandler) {
     SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
     while (true) {
         bool fHaveSyncNode = false;
@@ -1187,7 +1374,7 @@ void ThreadMessageHandler() {
             }
         }
 
-        if (!fHaveSyncNode)
+        if (nHandler == 0 && !fHaveSyncNode)
             StartSync(vNodesCopy);
 
         // Poll the connected nodes for messages
@@ -1197,24 +1384,24 @@ void ThreadMessageHandler() {
 
         bool fSleep = true;
 
-        for (auto pNode : vNodesCopy) {
+        // the handlers start from the different nodes so they rarely contend for the same node
+        for (size_t i = 0; i < vNodesCopy.size(); i++) {
+            CNode* pNode = vNodesCopy[(i + nHandler) % vNodesCopy.size()];
             if (pNode->fDisconnect)
                 continue;
 
+            TRY_LOCK(pNode->cs_processMsg, lockProcess);
+            if (!lockProcess)
+                continue;
+
             // Receive messages
-            {
-                TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
-                if (lockRecv) {
-                    if (!GetNodeSignals().ProcessMessages(pNode))
-                        pNode->CloseSocketDisconnect();
-
-                    if (pNode->nSendSize < SendBufferSize()) {
-                        if (!pNode->vRecvGetData.empty() ||
-                            (!pNode->vRecvMsg.empty() && pNode->vRecvMsg[0].complete())) {
-                            fSleep = false;
-                        }
-                    }
-                }
+            if (!GetNodeSignals().ProcessMessages(pNode))
+                pNode->CloseSocketDisconnect();
+
+            if (pNode->nSendSize < SendBufferSize()) {
+                if (!pNode->vRecvGetData.empty() ||
+                    (!pNode->fProcessDeferred && (pNode->HasProcessMessage(false) || pNode->HasProcessMessage(true))))
+                    fSleep = false;
             }
             boost::this_thread::interruption_point();
 
@@ -1234,8 +1421,59 @@ void ThreadMessageHandler() {
                 pNode->Release();
         }
 
-        if (fSleep)
-            MilliSleep(100);
+        // wait for a complete message received by the socket handler, or poll the nodes again to send
+        {
+            std::unique_lock<std::mutex> lock(mutexMsgProc);
+            if (fSleep)
+                condMsgProc.wait_for(lock, std::chrono::milliseconds(100), [] { return fMsgProcWake; });
+            fMsgProcWake = false;
+        }
+        boost::this_thread::interruption_point();
+    }
+}
+
+// Process the block and pbft messages of all peers, one message of each peer in a round
+void ThreadPriorityMessageHandler() {
+    while (true) {
+        vector<CNode*> vNodesCopy;
+        {
+            LOCK(cs_vNodes);
+            vNodesCopy = vNodes;
+            for (auto pNode : vNodesCopy)
+                pNode->AddRef();
+        }
+
+        bool fSleep = true;
+        for (auto pNode : vNodesCopy) {
+            if (pNode->fDisconnect || !pNode->HasProcessMessage(true))
+                continue;
+
+            // the peer is processed by one handler at a time, the busy peer is tried in the next round
+            TRY_LOCK(pNode->cs_processMsg, lockProcess);
+            if (!lockProcess)
+                continue;
+
+            if (!GetNodeSignals().ProcessPriorityMessages(pNode))
+                pNode->CloseSocketDisconnect();
+
+            if (!pNode->fProcessDeferred && pNode->HasProcessMessage(true))
+                fSleep = false;
+            boost::this_thread::interruption_point();
+        }
+
+        {
+            LOCK(cs_vNodes);
+            for (auto pNode : vNodesCopy)
+                pNode->Release();
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutexMsgProc);
+            if (fSleep)
+                condPriorityMsgProc.wait_for(lock, std::chrono::milliseconds(100), [] { return fPriorityMsgProcWake; });
+            fPriorityMsgProcWake = false;
+        }
+        boost::this_thread::interruption_point();
     }
 }
 
@@ -1417,7 +1655,14 @@ void StartNode(boost::thread_group& threadGroup) {
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "opencon", &ThreadOpenConnections));
 
     // Process messages
-    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
+    int32_t nMsgHandlerThreads = SysCfg().GetArg("-msghandlerthreads", DEFAULT_MESSAGE_HANDLER_THREADS);
+    nMsgHandlerThreads = std::max(1, std::min(nMsgHandlerThreads, MAX_MESSAGE_HANDLER_THREADS));
+    LogPrint(BCLog::INFO, "Using %d threads to process the messages\n", nMsgHandlerThreads);
+    for (int32_t i = 0; i < nMsgHandlerThreads; i++) {
+        threadGroup.create_thread(boost::bind(&TraceThread<boost::function<void()> >, "msghand",
+                                              boost::function<void()>(boost::bind(&ThreadMessageHandler, i))));
+    }
+    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msgprio", &ThreadPriorityMessageHandler));
 
     // Dump network addresses
     threadGroup.create_thread(boost::bind(&LoopForever<void (*)()>, "dumpaddr", &DumpAddresses, DUMP_ADDRESSES_INTERVAL * 1000));
@@ -1480,15 +1725,20 @@ void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash) {
     RelayTransaction(pBaseTx, hash, ss);
 }
 
+// Requires cs_mapRelay.
+static void ExpireRelayMessages() {
+    int64_t nNow = GetTime();
+    while (!vRelayExpiration.empty() && vRelayExpiration.front().first < nNow) {
+        mapRelay.erase(vRelayExpiration.front().second);
+        vRelayExpiration.pop_front();
+    }
+}
+
 void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CDataStream& ss) {
     CInv inv(MSG_TX, hash);
     {
         LOCK(cs_mapRelay);
-        // Expire old relay messages
-        while (!vRelayExpiration.empty() && vRelayExpiration.front().first < GetTime()) {
-            mapRelay.erase(vRelayExpiration.front().second);
-            vRelayExpiration.pop_front();
-        }
+        ExpireRelayMessages();
 
         // Save original serialized message so newer versions are preserved
         mapRelay.insert(make_pair(inv, ss));
@@ -1511,6 +1761,48 @@ void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CDataStream&
     }
 }
 
+void RelayTransactions(const vector<std::shared_ptr<CBaseTx> >& txs) {
+    if (txs.empty())
+        return;
+
+    vector<CInv> vInv;
+    vector<CDataStream> vData;
+    vInv.reserve(txs.size());
+    vData.reserve(txs.size());
+    for (const auto& spTx : txs) {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss.reserve(1000);
+        ss << spTx;
+        vInv.push_back(CInv(MSG_TX, spTx->GetHash()));
+        vData.push_back(ss);
+    }
+
+    {
+        LOCK(cs_mapRelay);
+        ExpireRelayMessages();
+
+        int64_t nExpiration = GetTime() + 15 * 60;
+        for (size_t i = 0; i < vInv.size(); ++i) {
+            mapRelay.insert(make_pair(vInv[i], vData[i]));
+            vRelayExpiration.push_back(make_pair(nExpiration, vInv[i]));
+        }
+    }
+
+    LOCK(cs_vNodes);
+    for (auto pNode : vNodes) {
+        if (!pNode->fRelayTxes)
+            continue;
+        LOCK(pNode->cs_filter);
+        for (size_t i = 0; i < vInv.size(); ++i) {
+            if (pNode->pFilter && !pNode->pFilter->IsRelevantAndUpdate(txs[i].get(), vInv[i].hash))
+                continue;
+
+            pNode->PushInventory(vInv[i]);
+        }
+    }
+    LogPrint(BCLog::NET, "relay %u txs time:%ld\n", vInv.size(), GetTime());
+}
+
 //
 // CAddrDB
 //
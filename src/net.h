@@ -37,12 +37,18 @@ static const int TIMEOUT_INTERVAL = 20 * 60;
 
 /** -peertimeout default */
 static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
+/** Maximum number of the message handler threads */
+static const int32_t MAX_MESSAGE_HANDLER_THREADS = 8;
+/** -msghandlerthreads default (number of the threads to process the messages besides the priority one) */
+static const int32_t DEFAULT_MESSAGE_HANDLER_THREADS = 2;
 
 inline uint32_t ReceiveFloodSize() { return 1000 * SysCfg().GetArg("-maxreceivebuffer", 5 * 1000); }
 void AddOneShot(string strDest);
 bool RecvLine(SOCKET hSocket, string& strLine);
 bool GetMyExternalIP(CNetAddr& ipRet);
 void AddressCurrentlyConnected(const CService& addr);
+// Signal the message handlers when there are messages ready to process
+void WakeMessageHandler(bool fGeneral, bool fPriority);
 CNode* FindNode(const CNetAddr& ip);
 CNode* FindNode(const CService& ip);
 CNode* ConnectNode(CAddress addrConnect, const char* strDest = nullptr);
@@ -89,6 +95,8 @@ extern map<CNetAddr, LocalServiceInfo> mapLocalHost;
 
 void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash);
 void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CDataStream& ss);
+// relay the txs together, every peer gets their invs in one pass
+void RelayTransactions(const vector<std::shared_ptr<CBaseTx> >& txs);
 
 /** Access to the (IP) address database (peers.dat) */
 class CAddrDB {
@@ -46,6 +46,20 @@ map<uint256, tuple<NodeId, list<uint256>::iterator, int64_t>> mapBlocksToDownloa
 // them, if processing happens afterwards. Protected by cs_main.
 map<uint256, NodeId> mapBlockSource;  // Remember who we got this block from.
 
+// The header chain beyond the block index received from the sync peer during headers-first sync,
+// the blocks of it are downloaded from all peers. Protected by cs_main.
+map<int32_t, uint256> mapSyncHeaders;  // height -> block hash
+NodeId syncHeadersPeer = -1;
+bool fSyncHeadersPaused = false;       // more headers of the sync peer wait for the tip to catch up
+
+struct CPartialBlockItem {
+    NodeId nodeId;
+    int64_t nTime;
+    std::shared_ptr<CPartialBlock> spPartialBlock;
+};
+// The blocks rebuilt from the compact blocks, waiting for the missing txs from the peers. Protected by cs_main.
+map<uint256, CPartialBlockItem> mapPartialBlocks;
+
 
 // Requires cs_mapNodeState.
 void MarkBlockAsReceived(const uint256 &hash, NodeId nodeFrom = -1) {
@@ -82,13 +96,35 @@ struct COrphanBlock {
 
 static CMedianFilter<int32_t> cPeerBlockCounts(8, 0);
 
+// Get the message of the block to serve, the serialized block is read from disk without being
+// deserialized and serialized again, and kept in cache for the other peers requesting it.
+inline std::shared_ptr<const CSerializeData> GetBlockMessage(const uint256 &blockHash, const CDiskBlockPos &blockPos) {
+    auto spMsg = serializedBlockCache.Get(blockHash);
+    if (spMsg)
+        return spMsg;
+
+    auto spData = std::make_shared<CSerializeData>(CMessageHeader::HEADER_SIZE);
+    if (!ReadRawBlockFromDisk(blockPos, *spData))
+        return nullptr;
+
+    CMessageHeader header(NetMsgType::BLOCK, spData->size() - CMessageHeader::HEADER_SIZE);
+    uint256 hash = Hash(spData->begin() + CMessageHeader::HEADER_SIZE, spData->end());
+    memcpy(&header.nChecksum, &hash, sizeof(header.nChecksum));
+
+    CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+    ssHeader << header;
+    assert(ssHeader.size() == CMessageHeader::HEADER_SIZE);
+    memcpy(spData->data(), &ssHeader[0], CMessageHeader::HEADER_SIZE);
+
+    serializedBlockCache.Add(blockHash, spData);
+    return spData;
+}
+
 inline void ProcessGetData(CNode *pFrom) {
     deque<CInv>::iterator it = pFrom->vRecvGetData.begin();
 
     vector<CInv> vNotFound;
 
-    LOCK(cs_main);
-
     while (it != pFrom->vRecvGetData.end()) {
         // Don't bother if send buffer is too full to respond anyway
         if (pFrom->nSendSize >= SendBufferSize()) {
@@ -101,26 +137,65 @@ inline void ProcessGetData(CNode *pFrom) {
             boost::this_thread::interruption_point();
             it++;
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK) {
-                bool send                                = false;
-                map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(inv.hash);
-                if (mi != mapBlockIndex.end()) {
-                    send = true;
-                } else {
-                    LogPrint(BCLog::NET, "block %s not exist\n", inv.hash.GetHex());
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK) {
+                // cs_main is only held to look up the block index, the block is read and sent without it
+                bool send = false;
+                bool compact = false;
+                int32_t height = 0;
+                const CBlockIndex *pIndex = nullptr;
+                CDiskBlockPos blockPos;
+                uint256 continueHash;
+                {
+                    LOCK(cs_main);
+                    map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(inv.hash);
+                    if (mi != mapBlockIndex.end()) {
+                        send     = true;
+                        pIndex   = mi->second;
+                        height   = mi->second->height;
+                        blockPos = mi->second->GetBlockPos();
+                        // an old block is sent in full, the peer is not likely to have its txs in mempool
+                        compact  = inv.type == MSG_CMPCT_BLOCK && chainActive.Height() - height <= MAX_COMPACT_BLOCK_DEPTH;
+                        // Trigger them to send a getblocks request for the next batch of inventory
+                        if (inv.hash == pFrom->hashContinue) {
+                            continueHash = chainActive.Tip()->GetBlockHash();
+                            pFrom->hashContinue.SetNull();
+                        }
+                    } else {
+                        LogPrint(BCLog::NET, "block %s not exist\n", inv.hash.GetHex());
+                    }
                 }
 
                 if (send) {
                     // Send block from disk
-                    CBlock block;
-                    ReadBlockFromDisk((*mi).second, block);
-                    if (inv.type == MSG_BLOCK) {
-                        LogPrint(BCLog::NET, "send block[%u]: %s to peer %s\n", block.GetHeight(), block.GetHash().GetHex(),
-                                 pFrom->addr.ToString());
-                        pFrom->PushMessage(NetMsgType::BLOCK, block);
+                    if (inv.type == MSG_BLOCK || (inv.type == MSG_CMPCT_BLOCK && !compact)) {
+                        auto spMsg = GetBlockMessage(inv.hash, blockPos);
+                        if (spMsg) {
+                            LogPrint(BCLog::NET, "send block[%d]: %s to peer %s\n", height, inv.hash.GetHex(),
+                                     pFrom->addr.ToString());
+                            pFrom->PushRawMessage(*spMsg);
+                        } else {
+                            LogPrint(BCLog::NET, "read block[%d]: %s failed\n", height, inv.hash.GetHex());
+                        }
+                    } else if (inv.type == MSG_CMPCT_BLOCK) {
+                        CBlock block;
+                        bool fRead;
+                        {
+                            // the recent block cache reads the tip when evicting, it requires cs_main
+                            LOCK(cs_main);
+                            fRead = recentBlockCache.ReadBlock(pIndex, block);
+                        }
+                        if (fRead) {
+                            LogPrint(BCLog::NET, "send cmpctblock[%d]: %s to peer %s\n", height, inv.hash.GetHex(),
+                                     pFrom->addr.ToString());
+                            pFrom->PushMessage(NetMsgType::CMPCTBLOCK, CBlockHeaderAndShortTxIds(block));
+                        } else {
+                            LogPrint(BCLog::NET, "read block[%d]: %s failed\n", height, inv.hash.GetHex());
+                        }
                     }
                     else  // MSG_FILTERED_BLOCK)
                     {
+                        CBlock block;
+                        ReadBlockFromDisk(blockPos, block);
                         LOCK(pFrom->cs_filter);
                         if (pFrom->pFilter) {
                             CMerkleBlock merkleBlock(block, *pFrom->pFilter);
@@ -139,15 +214,13 @@ inline void ProcessGetData(CNode *pFrom) {
                         // no response
                     }
 
-                    // Trigger them to send a getblocks request for the next batch of inventory
-                    if (inv.hash == pFrom->hashContinue) {
+                    if (!continueHash.IsNull()) {
                         // Bypass PushInventory, this must send even if redundant,
                         // and we want it right after the last block so they don't
                         // wait for other stuff first.
                         vector<CInv> vInv;
-                        vInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
+                        vInv.push_back(CInv(MSG_BLOCK, continueHash));
                         pFrom->PushMessage(NetMsgType::INV, vInv);
-                        pFrom->hashContinue.SetNull();
                         LogPrint(BCLog::NET, "reset node hashcontinue\n");
                     }
                 }
@@ -180,7 +253,7 @@ inline void ProcessGetData(CNode *pFrom) {
             // Track requests for our stuff.
             // g_signals.Inventory(inv.hash);
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
                 break;
         }
     }
@@ -215,17 +288,30 @@ bool AlreadyHave(const CInv &inv) {
 }
 
 // Requires cs_main.
-inline bool AddBlockToQueue(const uint256 &hash, NodeId nodeId) {
+// Whether the block is queued or in flight to a peer, and not timed out yet
+inline bool IsBlockDownloading(const uint256 &hash) {
     int64_t now  = GetTimeMicros();
     bool isMiner = SysCfg().GetBoolArg("-genblock", false);
 
     int64_t blocksToDownloadTimeout = isMiner ? MINER_NODE_BLOCKS_TO_DOWNLOAD_TIMEOUT : WITNESS_NODE_BLOCKS_TO_DOWNLOAD_TIMEOUT;
     int64_t blockInFlightTimeout    = isMiner ? MINER_NODE_BLOCKS_IN_FLIGHT_TIMEOUT : WITNESS_NODE_BLOCKS_IN_FLIGHT_TIMEOUT;
 
-    if ((mapBlocksToDownload.count(hash) &&
-         (now - std::get<2>(mapBlocksToDownload[hash]) < blocksToDownloadTimeout * 1000000)) ||
-        (mapBlocksInFlight.count(hash) &&
-         (now - std::get<2>(mapBlocksInFlight[hash]) < blockInFlightTimeout * 1000000))) {
+    auto toDownloadIt = mapBlocksToDownload.find(hash);
+    if (toDownloadIt != mapBlocksToDownload.end() &&
+        now - std::get<2>(toDownloadIt->second) < blocksToDownloadTimeout * 1000000)
+        return true;
+
+    auto inFlightIt = mapBlocksInFlight.find(hash);
+    if (inFlightIt != mapBlocksInFlight.end() &&
+        now - std::get<2>(inFlightIt->second) < blockInFlightTimeout * 1000000)
+        return true;
+
+    return false;
+}
+
+// Requires cs_main.
+inline bool AddBlockToQueue(const uint256 &hash, NodeId nodeId) {
+    if (IsBlockDownloading(hash)) {
         LogPrint(BCLog::NET, "block is downloading from another peer, ignore! time_ms=%lld, hash=%s\n", GetTimeMillis(), hash.GetHex());
 
         return false;
@@ -256,6 +342,85 @@ inline bool AddBlockToQueue(const uint256 &hash, NodeId nodeId) {
     return true;
 }
 
+// Requires cs_main.
+inline bool IsSyncHeader(const uint256 &hash, int32_t height) {
+    auto it = mapSyncHeaders.find(height);
+    return it != mapSyncHeaders.end() && it->second == hash;
+}
+
+// Requires cs_main.
+// Ask the peer for the headers after hashLast, or after the active chain if hashLast is null
+inline void PushGetHeaders(CNode *pNode, const uint256 &hashLast) {
+    AssertLockHeld(cs_main);
+    CBlockLocator locator = chainActive.GetLocator();
+    if (!hashLast.IsNull())
+        locator.vHave.insert(locator.vHave.begin(), hashLast);
+
+    syncHeadersPeer    = pNode->GetId();
+    fSyncHeadersPaused = false;
+    pNode->PushMessage(NetMsgType::GETHEADERS, locator, uint256());
+    LogPrint(BCLog::NET, "getheaders after %s from peer %s\n",
+             (hashLast.IsNull() ? chainActive.Tip()->GetBlockHash() : hashLast).GetHex(), pNode->addrName);
+}
+
+// Requires cs_main.
+// Ask the sync peer for more headers once the tip has caught up with the paused headers sync
+inline void ResumeSyncHeaders(CNode *pTo) {
+    AssertLockHeld(cs_main);
+    if (!fSyncHeadersPaused || pTo->GetId() != syncHeadersPeer || pTo->fDisconnect)
+        return;
+
+    if (mapSyncHeaders.empty()) {
+        PushGetHeaders(pTo, uint256());
+    } else if (mapSyncHeaders.rbegin()->first < chainActive.Height() + MAX_SYNC_HEADERS_AHEAD) {
+        PushGetHeaders(pTo, mapSyncHeaders.rbegin()->second);
+    }
+}
+
+// Requires cs_main.
+// Spread the blocks of the sync headers within the download window to the peer, the window starts
+// from the active tip so that the blocks arriving out of order could be kept as orphans until connectable.
+inline void ScheduleBlockDownload(CNode *pTo) {
+    AssertLockHeld(cs_main);
+    if (mapSyncHeaders.empty() || pTo->fClient || pTo->fDisconnect || !pTo->fSuccessfullyConnected)
+        return;
+
+    int32_t tipHeight = chainActive.Height();
+    mapSyncHeaders.erase(mapSyncHeaders.begin(), mapSyncHeaders.upper_bound(tipHeight));
+
+    int32_t available = 0;
+    {
+        LOCK(cs_mapNodeState);
+        CNodeState *state = State(pTo->GetId());
+        if (state == nullptr)
+            return;
+
+        available = MAX_BLOCKS_IN_TRANSIT_PER_PEER - state->nBlocksInFlight - state->nBlocksToDownload;
+    }
+
+    int32_t windowEnd = std::min(tipHeight + BLOCK_DOWNLOAD_WINDOW, pTo->nStartingHeight);
+    bool fFirstMissing = true;
+    for (auto it = mapSyncHeaders.begin(); it != mapSyncHeaders.end() && it->first <= windowEnd && available > 0; ++it) {
+        const uint256 &hash = it->second;
+        if (mapBlockIndex.count(hash) || mapOrphanBlocks.count(hash))
+            continue;
+
+        // the first missing block stalls the whole window, it is taken over when timed out on another peer
+        if (fFirstMissing) {
+            fFirstMissing = false;
+            if (mapBlocksInFlight.count(hash) && !IsBlockDownloading(hash))
+                LogPrint(BCLog::NET, "block[%d]: %s stalled on peer %d, download it from peer %s\n", it->first,
+                         hash.GetHex(), std::get<0>(mapBlocksInFlight[hash]), pTo->addrName);
+        }
+
+        if (IsBlockDownloading(hash))
+            continue;
+
+        if (AddBlockToQueue(hash, pTo->GetId()))
+            --available;
+    }
+}
+
 inline int32_t ProcessVersionMessage(CNode *pFrom, string strCommand, CDataStream &vRecv) {
     // Each connection can only send one version message
     if (pFrom->nVersion != 0) {
@@ -480,11 +645,19 @@ inline bool ProcessAddrMessage(CNode *pFrom, CDataStream &vRecv) {
 }
 
 inline bool ProcessTxMessage(CNode *pFrom, string strCommand, CDataStream &vRecv) {
+    if (txAdmission.IsStarted() && !IsInitialBlockDownload()) {
+        // the tx is decoded and checked on the admission threads, then accepted with the other txs in a batch
+        if (!txAdmission.Submit(pFrom, strCommand, std::make_shared<CDataStream>(vRecv)))
+            LogPrint(BCLog::NET, "the tx admission queue is full, drop the tx from peer %s\n", pFrom->addr.ToString());
+
+        return true;
+    }
+
     std::shared_ptr<CBaseTx> pBaseTx;
     try {
         vRecv >> pBaseTx;
     } catch(EInvalidTxType e) {
-        // TODO: record the misebehaving or ban the peer node.
+        Misbehaving(pFrom->GetId(), 10);
         return ERRORMSG("Unknown transaction type from peer %s, ignore! %s", pFrom->addr.ToString(), e.what());
     }
 
@@ -553,7 +726,7 @@ inline bool ProcessGetHeadersMessage(CNode *pFrom, CDataStream &vRecv) {
 
     // We must use CBlocks, as CBlockHeaders won't include the 0x00 nTx count at the end
     vector<CBlock> vHeaders;
-    int32_t nLimit = 2000;
+    int32_t nLimit = MAX_HEADERS_RESULTS;
     LogPrint(BCLog::NET, "getheaders %d to %s from peer %s\n", (pIndex ? pIndex->height : -1), hashStop.ToString(),
              pFrom->addr.ToString());
     for (; pIndex; pIndex = chainActive.Next(pIndex)) {
@@ -561,11 +734,112 @@ inline bool ProcessGetHeadersMessage(CNode *pFrom, CDataStream &vRecv) {
         if (--nLimit <= 0 || pIndex->GetBlockHash() == hashStop)
             break;
     }
-    pFrom->PushMessage("headers", vHeaders);
+    pFrom->PushMessage(NetMsgType::HEADERS, vHeaders);
 
     return false;
 }
 
+// The checks of a sync header without its block, the signature is verified when the block is connected
+inline bool CheckSyncHeader(const CBlockHeader &header, CNode *pFrom) {
+    if (header.GetHeight() == 0 || header.GetVersion() != CBlockHeader::CURRENT_VERSION) {
+        Misbehaving(pFrom->GetId(), 100);
+        return ERRORMSG("invalid header version %d at height %d from peer %s", header.GetVersion(),
+                        header.GetHeight(), pFrom->addrName);
+    }
+
+    if (header.GetSignature().empty() || header.GetSignature().size() > MAX_SIGNATURE_SIZE) {
+        Misbehaving(pFrom->GetId(), 100);
+        return ERRORMSG("invalid header signature size at height %d from peer %s", header.GetHeight(),
+                        pFrom->addrName);
+    }
+
+    // the same `block interval' + 2 seconds limits as CheckBlock()
+    if (header.GetBlockTime() > GetAdjustedTime() + ::GetBlockInterval(header.GetHeight()) + 2) {
+        Misbehaving(pFrom->GetId(), 20);
+        return ERRORMSG("header timestamp too far in the future at height %d from peer %s", header.GetHeight(),
+                        pFrom->addrName);
+    }
+
+    return true;
+}
+
+inline bool ProcessHeadersMessage(CNode *pFrom, CDataStream &vRecv) {
+    vector<CBlock> vHeaders;
+    vRecv >> vHeaders;
+    if (vHeaders.size() > (size_t)MAX_HEADERS_RESULTS) {
+        Misbehaving(pFrom->GetId(), 20);
+        return ERRORMSG("message headers size() = %u from peer %s", vHeaders.size(), pFrom->addrName);
+    }
+
+    LOCK(cs_main);
+
+    if (pFrom->GetId() != syncHeadersPeer) {
+        LogPrint(BCLog::NET, "ignore the unrequested headers from peer %s\n", pFrom->addrName);
+        return true;
+    }
+
+    if (vHeaders.empty())
+        return true;
+
+    for (const auto &header : vHeaders) {
+        if (!CheckSyncHeader(header, pFrom))
+            return false;
+    }
+
+    if (!IsContinuousHeaders(vHeaders)) {
+        Misbehaving(pFrom->GetId(), 20);
+        return ERRORMSG("non-continuous headers from peer %s", pFrom->addrName);
+    }
+
+    // the headers connect to the active chain or the last sync headers, the sync headers after the
+    // connecting point are replaced
+    const CBlock &firstHeader = vHeaders.front();
+    int32_t firstHeight       = firstHeader.GetHeight();
+    auto indexIt              = mapBlockIndex.find(firstHeader.GetPrevBlockHash());
+    if (indexIt != mapBlockIndex.end()) {
+        if (indexIt->second->height + 1 != firstHeight) {
+            Misbehaving(pFrom->GetId(), 20);
+            return ERRORMSG("invalid header height %d from peer %s", firstHeight, pFrom->addrName);
+        }
+
+        // the getheaders locator is built from the active chain, a stale fork is never asked for
+        if (!chainActive.Contains(indexIt->second)) {
+            Misbehaving(pFrom->GetId(), 20);
+            return ERRORMSG("headers from height %d off the active chain from peer %s", firstHeight,
+                            pFrom->addrName);
+        }
+    } else if (!IsSyncHeader(firstHeader.GetPrevBlockHash(), firstHeight - 1)) {
+        LogPrint(BCLog::NET, "ignore the unconnected headers from height %d from peer %s\n", firstHeight,
+                 pFrom->addrName);
+        return true;
+    }
+
+    mapSyncHeaders.erase(mapSyncHeaders.lower_bound(firstHeight), mapSyncHeaders.end());
+    for (const auto &header : vHeaders) {
+        mapSyncHeaders[header.GetHeight()] = header.GetHash();
+        if (header.GetHash() == hashAssumeValid)
+            nAssumeValidHeight = header.GetHeight();
+    }
+
+    int32_t lastHeight = vHeaders.back().GetHeight();
+    if (lastHeight > nSyncTipHeight)
+        nSyncTipHeight = lastHeight;
+
+    LogPrint(BCLog::NET, "recv headers %d to %d from peer %s\n", firstHeight, lastHeight, pFrom->addrName);
+
+    // there are more headers of the peer, they are asked for by ResumeSyncHeaders() when too far ahead of the tip
+    if (vHeaders.size() == (size_t)MAX_HEADERS_RESULTS) {
+        if (lastHeight < chainActive.Height() + MAX_SYNC_HEADERS_AHEAD) {
+            PushGetHeaders(pFrom, vHeaders.back().GetHash());
+        } else {
+            fSyncHeadersPaused = true;
+            LogPrint(BCLog::NET, "pause getheaders at height %d until the tip catches up\n", lastHeight);
+        }
+    }
+
+    return true;
+}
+
 inline void ProcessGetBlocksMessage(CNode *pFrom, CDataStream &vRecv) {
     CBlockLocator locator;
     uint256 hashStop;
@@ -705,15 +979,11 @@ inline bool ProcessGetDataMessage(CNode *pFrom, CDataStream &vRecv) {
     return true;
 }
 
-inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
-    CBlock block;
-    vRecv >> block;
-
+inline void MarkBlockAsReceivedFrom(CNode *pFrom, const uint256 &blockHash) {
     LogPrint(BCLog::NET, "recv block! time_ms=%lld, hash=%s, peer=%s\n", GetTimeMillis(),
-        block.GetHash().ToString(), pFrom->addr.ToString());
-    // block.Print();
+        blockHash.ToString(), pFrom->addr.ToString());
 
-    CInv inv(MSG_BLOCK, block.GetHash());
+    CInv inv(MSG_BLOCK, blockHash);
     pFrom->AddInventoryKnown(inv);
 
     {
@@ -722,9 +992,36 @@ inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
         mapBlockSource[inv.hash] = pFrom->GetId();
         MarkBlockAsReceived(inv.hash, pFrom->GetId());
     }
+}
+
+inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
+    if (!blockPipeline.IsStarted()) {
+        CBlock block;
+        vRecv >> block;
+        MarkBlockAsReceivedFrom(pFrom, block.GetHash());
+        ProcessReceivedBlock(pFrom, block);
+        return;
+    }
+
+    // only the header is decoded here, the pipeline decodes and checks the block on its threads
+    auto spBlockData = std::make_shared<CDataStream>(vRecv);
+    CBlockHeader header;
+    vRecv >> header;
+    MarkBlockAsReceivedFrom(pFrom, header.GetHash());
+    if (blockPipeline.Submit(pFrom, spBlockData))
+        return;
+
+    // the pipeline was filled by the other handlers after the block was taken, process it here as without
+    // the pipeline
+    CBlock block;
+    *spBlockData >> block;
+    ProcessReceivedBlock(pFrom, block);
+}
 
+void ProcessReceivedBlock(CNode *pFrom, CBlock &block) {
     LOCK(cs_main);
     CValidationState state;
+    mapPartialBlocks.erase(block.GetHash());
 
     std::pair<int32_t ,uint256> globalfinblock = std::make_pair(0,uint256());
     pCdMan->pBlockCache->ReadGlobalFinBlock(globalfinblock);
@@ -737,8 +1034,168 @@ inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
 
 }
 
+inline void ProcessSendCmpctMessage(CNode *pFrom, CDataStream &vRecv) {
+    bool fAnnounce   = false;
+    uint64_t version = 0;
+    vRecv >> fAnnounce >> version;
+    if (version != COMPACT_BLOCKS_VERSION)
+        return;
+
+    pFrom->fSupportsCompactBlocks = true;
+    pFrom->fPreferCompactBlocks   = fAnnounce;
+    LogPrint(BCLog::NET, "peer %s supports compact blocks, announce=%d\n", pFrom->addr.ToString(), fAnnounce);
+}
+
+// Requires cs_main.
+inline void RequestFullBlock(CNode *pFrom, const uint256 &blockHash) {
+    LogPrint(BCLog::NET, "rebuild block %s failed, request the full block from peer %s\n", blockHash.GetHex(),
+             pFrom->addr.ToString());
+    mapPartialBlocks.erase(blockHash);
+    pFrom->PushMessage(NetMsgType::GETDATA, vector<CInv>(1, CInv(MSG_BLOCK, blockHash)));
+}
+
+// Requires cs_main.
+inline void AddPartialBlock(CNode *pFrom, const uint256 &blockHash, const std::shared_ptr<CPartialBlock> &spPartialBlock) {
+    while (mapPartialBlocks.size() >= MAX_PARTIAL_BLOCKS && !mapPartialBlocks.count(blockHash)) {
+        auto oldestIt = mapPartialBlocks.begin();
+        for (auto it = mapPartialBlocks.begin(); it != mapPartialBlocks.end(); ++it) {
+            if (it->second.nTime < oldestIt->second.nTime)
+                oldestIt = it;
+        }
+        mapPartialBlocks.erase(oldestIt);
+    }
+
+    mapPartialBlocks[blockHash] = {pFrom->GetId(), GetTimeMicros(), spPartialBlock};
+}
+
+inline bool ProcessCmpctBlockMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockHeaderAndShortTxIds cmpctBlock;
+    vRecv >> cmpctBlock;
+    const uint256 blockHash = cmpctBlock.header.GetHash();
+    pFrom->AddInventoryKnown(CInv(MSG_BLOCK, blockHash));
+
+    CBlock block;
+    {
+        LOCK(cs_main);
+        if (mapBlockIndex.count(blockHash) || mapOrphanBlocks.count(blockHash)) {
+            LOCK(cs_mapNodeState);
+            MarkBlockAsReceived(blockHash, pFrom->GetId());
+            return true;
+        }
+
+        int64_t nStart      = GetTimeMicros();
+        auto spPartialBlock = std::make_shared<CPartialBlock>();
+        CompactBlockStatus status = spPartialBlock->Init(cmpctBlock, mempool);
+        if (status == COMPACT_BLOCK_INVALID) {
+            Misbehaving(pFrom->GetId(), 100);
+            return ERRORMSG("invalid cmpctblock %s from peer %s", blockHash.GetHex(), pFrom->addr.ToString());
+        }
+        if (status == COMPACT_BLOCK_FAILED) {
+            RequestFullBlock(pFrom, blockHash);
+            return true;
+        }
+
+        vector<uint32_t> missingIndexes;
+        spPartialBlock->GetMissingIndexes(missingIndexes);
+        LogPrint(BCLog::NET, "recv cmpctblock[%d]: %s from peer %s, txs=%u, prefilled=%u, mempool=%u, missing=%u, %.2fms\n",
+                 cmpctBlock.header.GetHeight(), blockHash.GetHex(), pFrom->addr.ToString(), spPartialBlock->GetTxCount(),
+                 spPartialBlock->GetPrefilledCount(), spPartialBlock->GetMempoolCount(), missingIndexes.size(),
+                 0.001 * (GetTimeMicros() - nStart));
+
+        if (!missingIndexes.empty()) {
+            AddPartialBlock(pFrom, blockHash, spPartialBlock);
+            CBlockTxsRequest request;
+            request.blockHash = blockHash;
+            request.indexes   = std::move(missingIndexes);
+            pFrom->PushMessage(NetMsgType::GETBLOCKTXN, request);
+            return true;
+        }
+
+        if (spPartialBlock->FillBlock(block, {}) != COMPACT_BLOCK_OK) {
+            RequestFullBlock(pFrom, blockHash);
+            return true;
+        }
+    }
+
+    MarkBlockAsReceivedFrom(pFrom, blockHash);
+    ProcessReceivedBlock(pFrom, block);
+    return true;
+}
+
+inline bool ProcessGetBlockTxnMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockTxsRequest request;
+    vRecv >> request;
+
+    CBlock block;
+    {
+        LOCK(cs_main);
+        auto mi = mapBlockIndex.find(request.blockHash);
+        if (mi == mapBlockIndex.end()) {
+            LogPrint(BCLog::NET, "getblocktxn for the unknown block %s from peer %s\n", request.blockHash.GetHex(),
+                     pFrom->addr.ToString());
+            return true;
+        }
+
+        // the txs of an old block are not served one by one, the full block is sent instead
+        if (chainActive.Height() - mi->second->height > MAX_COMPACT_BLOCK_DEPTH) {
+            pFrom->vRecvGetData.push_back(CInv(MSG_BLOCK, request.blockHash));
+            return true;
+        }
+
+        if (!recentBlockCache.ReadBlock(mi->second, block))
+            return ERRORMSG("read block %s failed", request.blockHash.GetHex());
+    }
+
+    CBlockTxs blockTxs;
+    blockTxs.blockHash = request.blockHash;
+    blockTxs.txs.reserve(request.indexes.size());
+    for (uint32_t index : request.indexes) {
+        if (index >= block.vptx.size()) {
+            Misbehaving(pFrom->GetId(), 100);
+            return ERRORMSG("getblocktxn index %u out of range from peer %s", index, pFrom->addr.ToString());
+        }
+        blockTxs.txs.push_back(block.vptx[index]);
+    }
+
+    pFrom->PushMessage(NetMsgType::BLOCKTXN, blockTxs);
+    return true;
+}
+
+inline bool ProcessBlockTxnMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockTxs blockTxs;
+    vRecv >> blockTxs;
+
+    CBlock block;
+    {
+        LOCK(cs_main);
+        auto it = mapPartialBlocks.find(blockTxs.blockHash);
+        if (it == mapPartialBlocks.end() || it->second.nodeId != pFrom->GetId()) {
+            LogPrint(BCLog::NET, "unexpected blocktxn %s from peer %s\n", blockTxs.blockHash.GetHex(),
+                     pFrom->addr.ToString());
+            return true;
+        }
+        auto spPartialBlock = it->second.spPartialBlock;
+        mapPartialBlocks.erase(it);
+
+        CompactBlockStatus status = spPartialBlock->FillBlock(block, blockTxs.txs);
+        if (status == COMPACT_BLOCK_INVALID) {
+            Misbehaving(pFrom->GetId(), 100);
+            return ERRORMSG("invalid blocktxn %s from peer %s", blockTxs.blockHash.GetHex(), pFrom->addr.ToString());
+        }
+        if (status == COMPACT_BLOCK_FAILED) {
+            RequestFullBlock(pFrom, blockTxs.blockHash);
+            return true;
+        }
+    }
+
+    MarkBlockAsReceivedFrom(pFrom, blockTxs.blockHash);
+    ProcessReceivedBlock(pFrom, block);
+    return true;
+}
+
 inline void ProcessMempoolMessage(CNode *pFrom, CDataStream &vRecv) {
-    LOCK2(cs_main, pFrom->cs_filter);
+    // the mempool is read under its own lock, cs_main is not needed
+    LOCK(pFrom->cs_filter);
 
     vector<uint256> vtxid;
     mempool.QueryHash(vtxid);
@@ -766,10 +1223,18 @@ inline void ProcessAlertMessage(CNode *pFrom, CDataStream &vRecv) {
     vRecv >> alert;
 
     uint256 alertHash = alert.GetHash();
-    if (pFrom->setKnown.count(alertHash) == 0) {
+    bool fKnown = false;
+    {
+        LOCK(pFrom->cs_inventory);
+        fKnown = pFrom->setKnown.count(alertHash) > 0;
+    }
+    if (!fKnown) {
         if (alert.ProcessAlert()) {
             // Relay
-            pFrom->setKnown.insert(alertHash);
+            {
+                LOCK(pFrom->cs_inventory);
+                pFrom->setKnown.insert(alertHash);
+            }
             {
                 LOCK(cs_vNodes);
                 for (auto pNode : vNodes) alert.RelayTo(pNode);
@@ -826,9 +1291,12 @@ inline void ProcessFilterAddMessage(CNode *pFrom, CDataStream &vRecv) {
 
 bool ProcessBlockConfirmMessage(CNode *pFrom, CDataStream &vRecv) {
 
-    if(SysCfg().IsReindex()|| GetTime()-chainActive.Tip()->GetBlockTime()>600){
-        LogPrint(BCLog::NET, "local tip's height is too low,drop the confirm message ") ;
-        return false ;
+    {
+        LOCK(cs_main);
+        if(SysCfg().IsReindex()|| GetTime()-chainActive.Tip()->GetBlockTime()>600){
+            LogPrint(BCLog::NET, "local tip's height is too low,drop the confirm message ") ;
+            return false ;
+        }
     }
 
     CPBFTMessageMan<CBlockConfirmMessage>& msgMan = pbftContext.confirmMessageMan ;
@@ -871,9 +1339,11 @@ bool ProcessBlockConfirmMessage(CNode *pFrom, CDataStream &vRecv) {
 
 bool ProcessBlockFinalityMessage(CNode *pFrom, CDataStream &vRecv) {
 
-
-    if(SysCfg().IsReindex()|| GetTime()-chainActive.Tip()->GetBlockTime()>600)
-        return false ;
+    {
+        LOCK(cs_main);
+        if(SysCfg().IsReindex()|| GetTime()-chainActive.Tip()->GetBlockTime()>600)
+            return false ;
+    }
 
     CPBFTMessageMan<CBlockFinalityMessage>& msgMan = pbftContext.finalityMessageMan ;
     CBlockFinalityMessage message ;
@@ -0,0 +1,137 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "compactblock.h"
+
+#include "commons/random.h"
+#include "crypto/hash.h"
+#include "crypto/siphash.h"
+#include "tx/txmempool.h"
+
+#include <unordered_map>
+
+CBlockHeaderAndShortTxIds::CBlockHeaderAndShortTxIds(const CBlock &block)
+    : header(block.GetBlockHeader()), nonce(GetRand(std::numeric_limits<uint64_t>::max())) {
+    uint64_t k0, k1;
+    GetShortTxIdKeys(k0, k1);
+
+    shortTxIds.reserve(block.vptx.size());
+    for (uint32_t i = 0; i < block.vptx.size(); ++i) {
+        const auto &pTx = block.vptx[i];
+        if (pTx->IsBlockRewardTx() || pTx->IsCoinRewardTx() || pTx->IsPriceMedianTx()) {
+            prefilledTxs.emplace_back(i, pTx);
+        } else {
+            shortTxIds.emplace_back(GetShortTxId(k0, k1, pTx->GetHash()));
+        }
+    }
+}
+
+void CBlockHeaderAndShortTxIds::GetShortTxIdKeys(uint64_t &k0, uint64_t &k1) const {
+    CHashWriter ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << header << nonce;
+    uint256 keyHash = ss.GetHash();
+    k0              = keyHash.GetUint64(0);
+    k1              = keyHash.GetUint64(1);
+}
+
+uint64_t CBlockHeaderAndShortTxIds::GetShortTxId(uint64_t k0, uint64_t k1, const uint256 &txid) {
+    return SipHashUint256(k0, k1, txid) & 0xffffffffffffL;
+}
+
+CompactBlockStatus CPartialBlock::Init(const CBlockHeaderAndShortTxIds &cmpctBlock, CTxMemPool &pool) {
+    uint32_t txCount = cmpctBlock.GetTxCount();
+    // a tx is at least 10 bytes in the block
+    if (txCount == 0 || txCount > MAX_BLOCK_SIZE / 10)
+        return COMPACT_BLOCK_INVALID;
+
+    header = cmpctBlock.header;
+    txs.assign(txCount, nullptr);
+    prefilledCount = 0;
+    mempoolCount   = 0;
+
+    for (const auto &prefilledTx : cmpctBlock.prefilledTxs) {
+        if (prefilledTx.index >= txCount || prefilledTx.tx == nullptr || txs[prefilledTx.index] != nullptr)
+            return COMPACT_BLOCK_INVALID;
+
+        txs[prefilledTx.index] = prefilledTx.tx;
+        prefilledCount++;
+    }
+
+    // the short ids are for the positions not prefilled in order
+    std::unordered_map<uint64_t, uint32_t> shortTxIdIndexes;
+    shortTxIdIndexes.reserve(cmpctBlock.shortTxIds.size());
+    uint32_t shortTxIdPos = 0;
+    for (uint32_t i = 0; i < txCount; ++i) {
+        if (txs[i] != nullptr)
+            continue;
+
+        if (!shortTxIdIndexes.emplace(cmpctBlock.shortTxIds[shortTxIdPos++].Get(), i).second)
+            return COMPACT_BLOCK_FAILED;
+    }
+
+    uint64_t k0, k1;
+    cmpctBlock.GetShortTxIdKeys(k0, k1);
+    vector<bool> collided(txCount, false);
+    {
+        LOCK(pool.cs);
+        for (const auto &item : pool.memPoolTxs) {
+            auto it = shortTxIdIndexes.find(CBlockHeaderAndShortTxIds::GetShortTxId(k0, k1, item.first));
+            if (it == shortTxIdIndexes.end())
+                continue;
+
+            uint32_t index = it->second;
+            if (collided[index])
+                continue;
+
+            if (txs[index] != nullptr) {
+                // two mempool txs share the short id, the tx is requested from the peer instead
+                txs[index] = nullptr;
+                collided[index] = true;
+                mempoolCount--;
+                continue;
+            }
+
+            // the block owns its own copy of the tx, the mempool entry is left untouched
+            txs[index] = item.second.GetTransaction()->GetNewInstance();
+            if (++mempoolCount == shortTxIdIndexes.size())
+                break;
+        }
+    }
+
+    return COMPACT_BLOCK_OK;
+}
+
+void CPartialBlock::GetMissingIndexes(vector<uint32_t> &indexes) const {
+    indexes.clear();
+    for (uint32_t i = 0; i < txs.size(); ++i) {
+        if (txs[i] == nullptr)
+            indexes.push_back(i);
+    }
+}
+
+CompactBlockStatus CPartialBlock::FillBlock(CBlock &block, const vector<std::shared_ptr<CBaseTx> > &missingTxs) const {
+    block = CBlock(header);
+    block.vptx.reserve(txs.size());
+
+    uint32_t missingPos = 0;
+    for (const auto &pTx : txs) {
+        if (pTx != nullptr) {
+            block.vptx.push_back(pTx);
+            continue;
+        }
+
+        if (missingPos >= missingTxs.size() || missingTxs[missingPos] == nullptr)
+            return COMPACT_BLOCK_INVALID;
+
+        block.vptx.push_back(missingTxs[missingPos++]);
+    }
+    if (missingPos != missingTxs.size())
+        return COMPACT_BLOCK_INVALID;
+
+    // a wrong tx matched by its short id, or a peer sending the wrong txs, makes the merkle root differ
+    if (block.BuildMerkleTree() != block.GetMerkleRootHash())
+        return COMPACT_BLOCK_FAILED;
+
+    return COMPACT_BLOCK_OK;
+}
@@ -0,0 +1,130 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_COMPACTBLOCK_H
+#define P2P_COMPACTBLOCK_H
+
+#include "commons/serialize.h"
+#include "commons/uint256.h"
+#include "persistence/block.h"
+
+#include <memory>
+#include <vector>
+
+class CTxMemPool;
+
+/** -compactblocks default (relay the new blocks as compact blocks to the peers supporting them) */
+static const bool DEFAULT_COMPACT_BLOCKS = true;
+/** The version of the compact blocks in the sendcmpct message */
+static const uint64_t COMPACT_BLOCKS_VERSION = 1;
+/** The compact blocks and the txs of getblocktxn are only served for the blocks within the depth from the tip */
+static const int32_t MAX_COMPACT_BLOCK_DEPTH = 10;
+/** Maximum number of the blocks being reconstructed, waiting for their missing txs */
+static const uint32_t MAX_PARTIAL_BLOCKS = 16;
+
+/** The lower 48 bits of the SipHash of the txid */
+class CShortTxId {
+public:
+    uint32_t lsb = 0;
+    uint16_t msb = 0;
+
+    CShortTxId() {}
+    explicit CShortTxId(uint64_t shortTxId) : lsb(shortTxId & 0xffffffff), msb((shortTxId >> 32) & 0xffff) {}
+
+    uint64_t Get() const { return ((uint64_t)msb << 32) | lsb; }
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(lsb);
+        READWRITE(msb);)
+};
+
+/** The tx sent in full in the compact block, index is its position in the block */
+class CPrefilledTx {
+public:
+    uint32_t index = 0;
+    std::shared_ptr<CBaseTx> tx;
+
+    CPrefilledTx() {}
+    CPrefilledTx(uint32_t indexIn, const std::shared_ptr<CBaseTx> &txIn) : index(indexIn), tx(txIn) {}
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(VARINT(index));
+        READWRITE(tx);)
+};
+
+/**
+ * The "cmpctblock" message. The txs are identified by their short ids keyed by the header and the
+ * nonce, except the block reward, coin reward and price median txs which are never in the mempools,
+ * they are prefilled.
+ */
+class CBlockHeaderAndShortTxIds {
+public:
+    CBlockHeader header;
+    uint64_t nonce = 0;
+    vector<CShortTxId> shortTxIds;
+    vector<CPrefilledTx> prefilledTxs;
+
+    CBlockHeaderAndShortTxIds() {}
+    explicit CBlockHeaderAndShortTxIds(const CBlock &block);
+
+    uint32_t GetTxCount() const { return shortTxIds.size() + prefilledTxs.size(); }
+    void GetShortTxIdKeys(uint64_t &k0, uint64_t &k1) const;
+    static uint64_t GetShortTxId(uint64_t k0, uint64_t k1, const uint256 &txid);
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(header);
+        READWRITE(nonce);
+        READWRITE(shortTxIds);
+        READWRITE(prefilledTxs);)
+};
+
+/** The "getblocktxn" message, the positions of the txs missing from the compact block */
+class CBlockTxsRequest {
+public:
+    uint256 blockHash;
+    vector<uint32_t> indexes;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(blockHash);
+        READWRITE(indexes);)
+};
+
+/** The "blocktxn" message, the txs requested in the order of their positions */
+class CBlockTxs {
+public:
+    uint256 blockHash;
+    vector<std::shared_ptr<CBaseTx> > txs;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(blockHash);
+        READWRITE(txs);)
+};
+
+enum CompactBlockStatus {
+    COMPACT_BLOCK_OK,
+    COMPACT_BLOCK_INVALID,  // the message is malformed, the peer misbehaves
+    COMPACT_BLOCK_FAILED,   // short id collision, the full block has to be downloaded
+};
+
+/** The block being reconstructed from a compact block with the txs found in the mempool */
+class CPartialBlock {
+public:
+    CBlockHeader header;
+
+    CompactBlockStatus Init(const CBlockHeaderAndShortTxIds &cmpctBlock, CTxMemPool &pool);
+    void GetMissingIndexes(vector<uint32_t> &indexes) const;
+    // fill the missing txs in the order of their positions and check the merkle root of the block
+    CompactBlockStatus FillBlock(CBlock &block, const vector<std::shared_ptr<CBaseTx> > &missingTxs) const;
+
+    uint32_t GetTxCount() const { return txs.size(); }
+    uint32_t GetPrefilledCount() const { return prefilledCount; }
+    uint32_t GetMempoolCount() const { return mempoolCount; }
+
+private:
+    vector<std::shared_ptr<CBaseTx> > txs;  // nullptr if missing
+    uint32_t prefilledCount = 0;
+    uint32_t mempoolCount   = 0;
+};
+
+#endif  // P2P_COMPACTBLOCK_H
@@ -20,11 +20,14 @@ public:
     CDataStream vRecv;  // received message data
     uint32_t nDataPos;
 
+    int64_t nTime;  // time (in micros) of the message completely received
+
     CNetMessage(int32_t nTypeIn, int32_t nVersionIn) : hdrbuf(nTypeIn, nVersionIn), vRecv(nTypeIn, nVersionIn) {
         hdrbuf.resize(24);
         in_data  = false;
         nHdrPos  = 0;
         nDataPos = 0;
+        nTime    = 0;
     }
 
     bool complete() const {
@@ -127,6 +127,13 @@ void CNode::CloseSocketDisconnect() {
     TRY_LOCK(cs_vRecvMsg, lockRecv);
     if (lockRecv) vRecvMsg.clear();
 
+    {
+        LOCK(cs_vProcessMsg);
+        vProcessMsg.clear();
+        vPriorityMsg.clear();
+        nProcessQueueSize = 0;
+    }
+
     // if this was the sync node, we'll need a new one
     if (this == pnodeSync)
         pnodeSync = nullptr;
@@ -241,6 +248,9 @@ bool CNode::ReceiveMsgBytes(const char* pch, uint32_t nBytes) {
         if (handled < 0)
             return false;
 
+        if (msg.complete())
+            msg.nTime = GetTimeMicros();
+
         pch += handled;
         nBytes -= handled;
     }
@@ -249,6 +259,60 @@ bool CNode::ReceiveMsgBytes(const char* pch, uint32_t nBytes) {
 }
 
 
+// The messages relaying the blocks and the pbft messages, processed ahead of the other messages
+static bool IsPriorityMessage(const string& command) {
+    return command == NetMsgType::BLOCK || command == NetMsgType::CMPCTBLOCK || command == NetMsgType::BLOCKTXN ||
+           command == NetMsgType::CONFIRMBLOCK || command == NetMsgType::FINALITYBLOCK;
+}
+
+// requires LOCK(cs_vRecvMsg)
+void CNode::QueueCompleteMessages(bool* pfGeneral, bool* pfPriority) {
+    *pfGeneral  = false;
+    *pfPriority = false;
+    while (!vRecvMsg.empty() && vRecvMsg.front().complete()) {
+        bool fPriority;
+        {
+            LOCK(cs_vProcessMsg);
+            // the messages before the handshake are kept in order with the version message, and a priority
+            // message doesn't overtake the earlier messages of the peer
+            fPriority = fSuccessfullyConnected && vProcessMsg.empty() &&
+                        IsPriorityMessage(vRecvMsg.front().hdr.GetCommand());
+            nProcessQueueSize += vRecvMsg.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+            list<CNetMessage>& queue = fPriority ? vPriorityMsg : vProcessMsg;
+            queue.push_back(std::move(vRecvMsg.front()));
+        }
+        vRecvMsg.pop_front();
+        (fPriority ? *pfPriority : *pfGeneral) = true;
+    }
+}
+
+bool CNode::TakeProcessMessage(list<CNetMessage>& msgs, bool fPriority) {
+    LOCK(cs_vProcessMsg);
+    list<CNetMessage>& queue = fPriority ? vPriorityMsg : vProcessMsg;
+    if (queue.empty())
+        return false;
+
+    nProcessQueueSize -= queue.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+    msgs.splice(msgs.end(), queue, queue.begin());
+    return true;
+}
+
+bool CNode::HasProcessMessage(bool fPriority) {
+    LOCK(cs_vProcessMsg);
+    return fPriority ? !vPriorityMsg.empty() : !vProcessMsg.empty();
+}
+
+string CNode::GetNextProcessCommand(bool fPriority) {
+    LOCK(cs_vProcessMsg);
+    list<CNetMessage>& queue = fPriority ? vPriorityMsg : vProcessMsg;
+    return queue.empty() ? string() : queue.front().hdr.GetCommand();
+}
+
+uint64_t CNode::GetProcessQueueSize() {
+    LOCK(cs_vProcessMsg);
+    return nProcessQueueSize;
+}
+
 void CNode::RecordBytesRecv(uint64_t bytes) {
     LOCK(cs_totalBytesRecv);
     nTotalBytesRecv += bytes;
@@ -8,6 +8,7 @@
 #define P2P_NODE_H
 
 #include <boost/signals2/signal.hpp>
+#include <list>
 #include "commons/serialize.h"
 #include "sync.h"
 #include "commons/compat/compat.h"
@@ -50,6 +51,7 @@ struct LocalServiceInfo {
 struct CNodeSignals {
     boost::signals2::signal<int32_t()> GetHeight;
     boost::signals2::signal<bool(CNode*)> ProcessMessages;
+    boost::signals2::signal<bool(CNode*)> ProcessPriorityMessages;
     boost::signals2::signal<bool(CNode*, bool)> SendMessages;
     boost::signals2::signal<void(NodeId, const CNode*)> InitializeNode;
     boost::signals2::signal<void(NodeId)> FinalizeNode;
@@ -145,8 +147,25 @@ public:
     deque<CInv> vRecvGetData;  // strCommand == "getdata 保存的inv
     deque<CNetMessage> vRecvMsg;
     CCriticalSection cs_vRecvMsg;
+    // the complete messages moved from vRecvMsg by the socket handler, each queue is processed in order.
+    // The consensus messages are queued apart and processed by the priority message handler, unless an
+    // earlier message is still in vProcessMsg, so the messages of vPriorityMsg always precede vProcessMsg.
+    list<CNetMessage> vProcessMsg;
+    list<CNetMessage> vPriorityMsg;
+    uint64_t nProcessQueueSize;  // bytes of the messages in both queues
+    CCriticalSection cs_vProcessMsg;
+    // held by the message handler processing the messages of the peer and sending to the peer
+    CCriticalSection cs_processMsg;
+    // the next message waits for room in the block pipeline, the peer has nothing to process until then.
+    // Protected by cs_processMsg.
+    bool fProcessDeferred;
     uint64_t nRecvBytes;
     int32_t nRecvVersion;
+    // the socket readiness kept by the socket handler thread, with the edge-triggered events the socket
+    // is not reported again until it is read or written until it would block
+    bool fSocketReadable;
+    bool fSocketWritable;
+    bool fSocketEventsAdded;
 
     int64_t nLastSend;
     int64_t nLastRecv;
@@ -205,7 +224,7 @@ public:
     vector<CInv> vInventoryToSend;   //待发送的inv
     std::set<CInv> setForceToSend;   //强制发送的inv
 
-    CCriticalSection cs_inventory;
+    CCriticalSection cs_inventory;  // also guards vAddrToSend, setAddrKnown and setKnown
     multimap<int64_t, CInv> mapAskFor;  //向网络请求交易的时间, a priority queue
 
 
@@ -215,6 +234,12 @@ public:
     mruset<CBlockFinalityMessage> setBlockFinalityMsgKnown ;
     CCriticalSection cs_blockFinality ;
 
+    // compact block relay
+    bool fSupportsCompactBlocks;    // the peer sent sendcmpct, it serves the compact blocks
+    bool fPreferCompactBlocks;      // the peer wants the new blocks pushed as compact blocks without inv
+    bool fSentCompactBlocks;        // we sent sendcmpct to the peer
+    bool fSentPreferCompactBlocks;  // the announce flag of the sendcmpct we sent
+
     // Ping time measurement
     uint64_t nPingNonceSent;
     int64_t nPingUsecStart;
@@ -226,6 +251,11 @@ public:
         nServices                = 0;
         hSocket                  = hSocketIn;
         nRecvVersion             = INIT_PROTO_VERSION;
+        fSocketReadable          = false;
+        fSocketWritable          = false;
+        fSocketEventsAdded       = false;
+        nProcessQueueSize        = 0;
+        fProcessDeferred         = false;
         nLastSend                = 0;
         nLastRecv                = 0;
         nSendBytes               = 0;
@@ -254,6 +284,10 @@ public:
         fRelayTxes               = false;
         setInventoryKnown.max_size(SendBufferSize() / 1000);
         setBlockConfirmMsgKnown.max_size(200);
+        fSupportsCompactBlocks   = false;
+        fPreferCompactBlocks     = false;
+        fSentCompactBlocks       = false;
+        fSentPreferCompactBlocks = false;
         pFilter        = new CBloomFilter();
         nPingNonceSent = 0;
         nPingUsecStart = 0;
@@ -307,22 +341,29 @@ public:
         return nRefCount;
     }
 
-    // requires LOCK(cs_vRecvMsg)
-    uint32_t GetTotalRecvSize() {
-        uint32_t total = 0;
-        for (const auto& msg : vRecvMsg)
-            total += msg.vRecv.size() + 24;
-        return total;
-    }
-
     // requires LOCK(cs_vRecvMsg)
     bool ReceiveMsgBytes(const char* pch, uint32_t nBytes);
 
     // requires LOCK(cs_vRecvMsg)
+    // Move the complete messages to the process queues, return whether any of them is a priority message
+    // in *pfPriority and whether any of them is not in *pfGeneral.
+    void QueueCompleteMessages(bool* pfGeneral, bool* pfPriority);
+    // Take the first message of the queue into msgs, return false if the queue is empty
+    bool TakeProcessMessage(list<CNetMessage>& msgs, bool fPriority);
+    bool HasProcessMessage(bool fPriority);
+    // the command of the first message of the queue, empty if the queue is empty
+    string GetNextProcessCommand(bool fPriority);
+    uint64_t GetProcessQueueSize();
+
     void SetRecvVersion(int32_t nVersionIn) {
+        LOCK2(cs_vRecvMsg, cs_vProcessMsg);
         nRecvVersion = nVersionIn;
         for (auto& msg : vRecvMsg)
             msg.SetVersion(nVersionIn);
+        for (auto& msg : vProcessMsg)
+            msg.SetVersion(nVersionIn);
+        for (auto& msg : vPriorityMsg)
+            msg.SetVersion(nVersionIn);
     }
 
     CNode* AddRef() {
@@ -332,15 +373,25 @@ public:
 
     void Release() { nRefCount--; }
 
-    void AddAddressKnown(const CAddress& addr) { setAddrKnown.insert(addr); }
+    void AddAddressKnown(const CAddress& addr) {
+        LOCK(cs_inventory);
+        setAddrKnown.insert(addr);
+    }
 
-    void AddBlockConfirmMessageKnown(const CBlockConfirmMessage msg){ setBlockConfirmMsgKnown.insert(msg); }
-    void AddBlockFinalityMessageKnown(const CBlockFinalityMessage msg){ setBlockFinalityMsgKnown.insert(msg); }
+    void AddBlockConfirmMessageKnown(const CBlockConfirmMessage msg) {
+        LOCK(cs_blockConfirm);
+        setBlockConfirmMsgKnown.insert(msg);
+    }
+    void AddBlockFinalityMessageKnown(const CBlockFinalityMessage msg) {
+        LOCK(cs_blockFinality);
+        setBlockFinalityMsgKnown.insert(msg);
+    }
 
     void PushAddress(const CAddress& addr) {
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
+        LOCK(cs_inventory);
         if (addr.IsValid() && !setAddrKnown.count(addr)) {
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[insecure_rand() % vAddrToSend.size()] = addr;
@@ -475,6 +526,18 @@ public:
             LEAVE_CRITICAL_SECTION(cs_vSend);
     }
 
+    // Push a message already framed with the message header, e.g. a cached block message
+    void PushRawMessage(const CSerializeData &msg) {
+        LOCK(cs_vSend);
+        LogPrint(BCLog::NET, "sending: raw message (%d bytes)\n", msg.size());
+
+        deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), msg);
+        nSendSize += msg.size();
+
+        // If write queue empty, attempt "optimistic write"
+        if (it == vSendMsg.begin()) SocketSendData();
+    }
+
     void PushVersion();
 
     void PushMessage(const char* pszCommand) {
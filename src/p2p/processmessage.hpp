@@ -61,6 +61,12 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
             return true;
     }
 
+    else if (strCommand == NetMsgType::HEADERS &&
+            !SysCfg().IsImporting() && !SysCfg().IsReindex()) {
+        if (!ProcessHeadersMessage(pFrom, vRecv))
+            return false;
+    }
+
     else if (strCommand == NetMsgType::TX) {
         if (!ProcessTxMessage(pFrom, strCommand, vRecv))
             return false;
@@ -72,8 +78,30 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
         ProcessBlockMessage(pFrom, vRecv);
     }
 
+    else if (strCommand == NetMsgType::SENDCMPCT) {
+        ProcessSendCmpctMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::CMPCTBLOCK && !SysCfg().IsImporting() && !SysCfg().IsReindex()) {
+        if (!ProcessCmpctBlockMessage(pFrom, vRecv))
+            return false;
+    }
+
+    else if (strCommand == NetMsgType::GETBLOCKTXN) {
+        if (!ProcessGetBlockTxnMessage(pFrom, vRecv))
+            return false;
+    }
+
+    else if (strCommand == NetMsgType::BLOCKTXN && !SysCfg().IsImporting() && !SysCfg().IsReindex()) {
+        if (!ProcessBlockTxnMessage(pFrom, vRecv))
+            return false;
+    }
+
     else if (strCommand == NetMsgType::GETADDR) {
-        pFrom->vAddrToSend.clear();
+        {
+            LOCK(pFrom->cs_inventory);
+            pFrom->vAddrToSend.clear();
+        }
         vector<CAddress> vAddr = addrman.GetAddr();
         for (const auto &addr : vAddr)
             pFrom->PushAddress(addr);
@@ -150,11 +178,8 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
     return true;
 }
 
-// requires LOCK(cs_vRecvMsg)
-bool ProcessMessages(CNode *pFrom) {
-    //if (fDebug)
-    //    LogPrint(BCLog::INFO,"ProcessMessages(%u messages)\n", pFrom->vRecvMsg.size());
-
+// Check and process a complete message, return false if the message start is invalid
+bool static ProcessNetMessage(CNode *pFrom, CNetMessage &msg) {
     //
     // Message format
     //  (4) message start
@@ -163,103 +188,130 @@ bool ProcessMessages(CNode *pFrom) {
     //  (4) checksum
     //  (x) data
     //
-    bool fOk = true;
 
-    if (!pFrom->vRecvGetData.empty())
-        ProcessGetData(pFrom);
+    // Scan for message start
+    if (memcmp(msg.hdr.pchMessageStart, SysCfg().MessageStart(), MESSAGE_START_SIZE) != 0) {
+        LogPrint(BCLog::INFO, "\n\nPROCESSMESSAGE: INVALID MESSAGESTART\n\n");
+        return false;
+    }
 
-    // this maintains the order of responses
-    if (!pFrom->vRecvGetData.empty())
-        return fOk;
-
-    deque<CNetMessage>::iterator it = pFrom->vRecvMsg.begin();
-    while (!pFrom->fDisconnect && it != pFrom->vRecvMsg.end()) {
-        // Don't bother if send buffer is too full to respond anyway
-        if (pFrom->nSendSize >= SendBufferSize()) {
-            LogPrint(BCLog::NET, "send buffer size: %d full for peer: %s\n", pFrom->nSendSize, pFrom->addr.ToString());
-            break;
+    // Read header
+    CMessageHeader &hdr = msg.hdr;
+    if (!hdr.IsValid()) {
+        LogPrint(BCLog::INFO, "\n\nPROCESSMESSAGE: ERRORS IN HEADER %s\n\n\n", hdr.GetCommand());
+        return true;
+    }
+    string strCommand = hdr.GetCommand();
+
+    // Message size
+    uint32_t nMessageSize = hdr.nMessageSize;
+
+    // Checksum
+    CDataStream &vRecv = msg.vRecv;
+    uint256 hash       = Hash(vRecv.begin(), vRecv.begin() + nMessageSize);
+    uint32_t nChecksum = 0;
+    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    if (nChecksum != hdr.nChecksum) {
+        LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : CHECKSUM ERROR nChecksum=%08x hdr.nChecksum=%08x\n",
+                 strCommand, nMessageSize, nChecksum, hdr.nChecksum);
+        return true;
+    }
+
+    // Process message
+    bool fRet      = false;
+    int64_t nStart = GetTimeMicros();
+    try {
+        fRet = ProcessMessage(pFrom, strCommand, vRecv);
+        boost::this_thread::interruption_point();
+    } catch (std::ios_base::failure &e) {
+        pFrom->PushMessage(NetMsgType::REJECT, strCommand, REJECT_MALFORMED, string("error parsing message"));
+        if (strstr(e.what(), "end of data")) {
+            // Allow exceptions from under-length message on vRecv
+            LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : Exception '%s' caught, normally caused by a message being shorter than its stated length\n", strCommand, nMessageSize, e.what());
+            LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : %s\n", strCommand, nMessageSize, HexStr(vRecv.begin(), vRecv.end()).c_str());
+        } else if (strstr(e.what(), "size too large")) {
+            // Allow exceptions from over-long size
+            LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : Exception '%s' caught\n", strCommand, nMessageSize, e.what());
+        } else {
+            PrintExceptionContinue(&e, "ProcessMessages()");
         }
+    } catch (boost::thread_interrupted) {
+        throw;
+    } catch (std::exception &e) {
+        PrintExceptionContinue(&e, "ProcessMessages()");
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "ProcessMessages()");
+    }
 
-        // get next message
-        CNetMessage &msg = *it;
+    if (!fRet)
+        LogPrint(BCLog::INFO, "ProcessMessage(%s, %u bytes) FAILED\n", strCommand, nMessageSize);
 
-        //if (fDebug)
-        //    LogPrint(BCLog::INFO,"ProcessMessages(message %u msgsz, %u bytes, complete:%s)\n",
-        //            msg.hdr.nMessageSize, msg.vRecv.size(),
-        //            msg.complete() ? "Y" : "N");
+    // the relay latency of the blocks and the pbft messages from being received to being processed
+    if (SysCfg().IsBenchmark() && (strCommand == NetMsgType::BLOCK || strCommand == NetMsgType::CONFIRMBLOCK ||
+                                   strCommand == NetMsgType::FINALITYBLOCK)) {
+        int64_t nNow = GetTimeMicros();
+        LogPrint(BCLog::INFO, "- Relay %s from %s: %.2fms waiting, %.2fms processing\n", strCommand,
+                 pFrom->addr.ToString(), 0.001 * (nStart - msg.nTime), 0.001 * (nNow - nStart));
+    }
 
-        // end, if an incomplete message is found
-        if (!msg.complete())
-            break;
+    return true;
+}
 
-        // at this point, any failure means we can delete the current message
-        it++;
+// Requires pFrom->cs_processMsg.
+// Whether the next message of the peer is a block waiting for room in the block pipeline. It stays in the
+// queue, with the later messages of the peer behind it, instead of blocking the handler until the queued
+// blocks are verified. The pipeline wakes the handlers when a block leaves it.
+static bool IsProcessDeferred(CNode *pFrom, bool fPriorityOnly) {
+    string command = pFrom->GetNextProcessCommand(true);
+    if (command.empty() && !fPriorityOnly)
+        command = pFrom->GetNextProcessCommand(false);
+
+    pFrom->fProcessDeferred = command == NetMsgType::BLOCK && blockPipeline.IsStarted() && blockPipeline.IsFull();
+    return pFrom->fProcessDeferred;
+}
 
-        // Scan for message start
-        if (memcmp(msg.hdr.pchMessageStart, SysCfg().MessageStart(), MESSAGE_START_SIZE) != 0) {
-            LogPrint(BCLog::INFO, "\n\nPROCESSMESSAGE: INVALID MESSAGESTART\n\n");
-            fOk = false;
-            break;
-        }
+// Requires pFrom->cs_processMsg.
+// Process the getdata requests or the next message of the peer, the messages of a peer are processed in
+// order by one message handler at a time, the handlers process the different peers in parallel.
+bool ProcessMessages(CNode *pFrom) {
+    if (!pFrom->vRecvGetData.empty())
+        ProcessGetData(pFrom);
 
-        // Read header
-        CMessageHeader &hdr = msg.hdr;
-        if (!hdr.IsValid()) {
-            LogPrint(BCLog::INFO, "\n\nPROCESSMESSAGE: ERRORS IN HEADER %s\n\n\n", hdr.GetCommand());
-            continue;
-        }
-        string strCommand = hdr.GetCommand();
-
-        // Message size
-        uint32_t nMessageSize = hdr.nMessageSize;
-
-        // Checksum
-        CDataStream &vRecv = msg.vRecv;
-        uint256 hash       = Hash(vRecv.begin(), vRecv.begin() + nMessageSize);
-        uint32_t nChecksum = 0;
-        memcpy(&nChecksum, &hash, sizeof(nChecksum));
-        if (nChecksum != hdr.nChecksum) {
-            LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : CHECKSUM ERROR nChecksum=%08x hdr.nChecksum=%08x\n",
-                     strCommand, nMessageSize, nChecksum, hdr.nChecksum);
-            continue;
-        }
+    // this maintains the order of responses
+    if (!pFrom->vRecvGetData.empty())
+        return true;
+
+    // Don't bother if send buffer is too full to respond anyway
+    if (pFrom->fDisconnect)
+        return true;
+    if (pFrom->nSendSize >= SendBufferSize()) {
+        LogPrint(BCLog::NET, "send buffer size: %d full for peer: %s\n", pFrom->nSendSize, pFrom->addr.ToString());
+        return true;
+    }
 
-        // Process message
-        bool fRet = false;
-        try {
-            fRet = ProcessMessage(pFrom, strCommand, vRecv);
-            boost::this_thread::interruption_point();
-        } catch (std::ios_base::failure &e) {
-            pFrom->PushMessage(NetMsgType::REJECT, strCommand, REJECT_MALFORMED, string("error parsing message"));
-            if (strstr(e.what(), "end of data")) {
-                // Allow exceptions from under-length message on vRecv
-                LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : Exception '%s' caught, normally caused by a message being shorter than its stated length\n", strCommand, nMessageSize, e.what());
-                LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : %s\n", strCommand, nMessageSize, HexStr(vRecv.begin(), vRecv.end()).c_str());
-            } else if (strstr(e.what(), "size too large")) {
-                // Allow exceptions from over-long size
-                LogPrint(BCLog::INFO, "ProcessMessages(%s, %u bytes) : Exception '%s' caught\n", strCommand, nMessageSize, e.what());
-            } else {
-                PrintExceptionContinue(&e, "ProcessMessages()");
-            }
-        } catch (boost::thread_interrupted) {
-            throw;
-        } catch (std::exception &e) {
-            PrintExceptionContinue(&e, "ProcessMessages()");
-        } catch (...) {
-            PrintExceptionContinue(nullptr, "ProcessMessages()");
-        }
+    if (IsProcessDeferred(pFrom, false))
+        return true;
 
-        if (!fRet)
-            LogPrint(BCLog::INFO, "ProcessMessage(%s, %u bytes) FAILED\n", strCommand, nMessageSize);
+    // the queued priority messages are earlier than the other messages of the peer
+    list<CNetMessage> msgs;
+    if (!pFrom->TakeProcessMessage(msgs, true) && !pFrom->TakeProcessMessage(msgs, false))
+        return true;
 
-        break;
-    }
+    return ProcessNetMessage(pFrom, msgs.front());
+}
+
+// Requires pFrom->cs_processMsg.
+// Process the next block or pbft message of the peer by the priority message handler, they are not
+// delayed by the slow requests such as getdata of the old blocks from the other peers.
+bool ProcessPriorityMessages(CNode *pFrom) {
+    if (pFrom->fDisconnect || IsProcessDeferred(pFrom, true))
+        return true;
 
-    // In case the connection got shut down, its receive buffer was wiped
-    if (!pFrom->fDisconnect)
-        pFrom->vRecvMsg.erase(pFrom->vRecvMsg.begin(), it);
+    list<CNetMessage> msgs;
+    if (!pFrom->TakeProcessMessage(msgs, true))
+        return true;
 
-    return fOk;
+    return ProcessNetMessage(pFrom, msgs.front());
 }
 
 #endif
\ No newline at end of file
@@ -22,7 +22,7 @@ namespace NetMsgType {
     const char *GETBLOCKS="getblocks";
     const char *GETHEADERS="getheaders";
     const char *TX="tx";
-    // const char *HEADERS="headers";
+    const char *HEADERS="headers";
     const char *BLOCK="block";
     const char *GETADDR="getaddr";
     const char *MEMPOOL="mempool";
@@ -38,10 +38,10 @@ namespace NetMsgType {
     const char *FINALITYBLOCK = "finblock" ;
     // const char *SENDHEADERS="sendheaders";
     // const char *FEEFILTER="feefilter";
-    // const char *SENDCMPCT="sendcmpct";
-    // const char *CMPCTBLOCK="cmpctblock";
-    // const char *GETBLOCKTXN="getblocktxn";
-    // const char *BLOCKTXN="blocktxn";
+    const char *SENDCMPCT="sendcmpct";
+    const char *CMPCTBLOCK="cmpctblock";
+    const char *GETBLOCKTXN="getblocktxn";
+    const char *BLOCKTXN="blocktxn";
 } // namespace NetMsgType
 
 static const char* ppszTypeName[] =
@@ -49,7 +49,8 @@ static const char* ppszTypeName[] =
     "ERROR",
     "tx",
     "block",
-    "filtered block"
+    "filtered block",
+    "cmpct block"
 };
 
 CMessageHeader::CMessageHeader()
@@ -131,7 +131,7 @@ extern const char *TX;
  * @since protocol version 31800.
  * @see https://bitcoin.org/en/developer-reference#headers
  */
-// extern const char *HEADERS;
+extern const char *HEADERS;
 /**
  * The block message transmits a single serialized block.
  * @see https://bitcoin.org/en/developer-reference#block
@@ -383,6 +383,8 @@ enum
     // Nodes may always request a MSG_FILTERED_BLOCK in a getdata, however,
     // MSG_FILTERED_BLOCK should not appear in any invs except as a part of getdata.
     MSG_FILTERED_BLOCK,
+    // MSG_CMPCT_BLOCK is only requested in a getdata for a new block, the peer replies a "cmpctblock" message.
+    MSG_CMPCT_BLOCK,
 };
 
 #endif // __INCLUDED_PROTOCOL_H__
@@ -32,6 +32,17 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
         if (pTo->nVersion == 0)
             return true;
 
+        //
+        // Message: sendcmpct
+        //
+        // the delegates ask the peers to push the new blocks as compact blocks, again when becoming one
+        if (fCompactBlocks && (!pTo->fSentCompactBlocks || pTo->fSentPreferCompactBlocks != mining)) {
+            bool fAnnounce = mining;
+            pTo->PushMessage(NetMsgType::SENDCMPCT, fAnnounce, COMPACT_BLOCKS_VERSION);
+            pTo->fSentCompactBlocks       = true;
+            pTo->fSentPreferCompactBlocks = fAnnounce;
+        }
+
         //
         // Message: ping
         //
@@ -80,8 +91,10 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
                     LOCK(cs_vNodes);
                     for (auto pNode : vNodes) {
                         // Periodically clear setAddrKnown to allow refresh broadcasts
-                        if (nLastRebroadcast)
+                        if (nLastRebroadcast) {
+                            LOCK(pNode->cs_inventory);
                             pNode->setAddrKnown.clear();
+                        }
 
                         // Rebroadcast our address
                         if (!fNoListen) {
@@ -98,6 +111,7 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
             // Message: addr
             //
             if (fSendTrickle) {
+                LOCK(pTo->cs_inventory);
                 vector<CAddress> vAddr;
                 vAddr.reserve(pTo->vAddrToSend.size());
                 for (const auto &addr : pTo->vAddrToSend) {
@@ -116,14 +130,23 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
                     pTo->PushMessage(NetMsgType::ADDR, vAddr);
             }
 
-            // Start block sync
+            // Start block sync, the headers-first sync downloads the blocks from all peers
             if (pTo->fStartSync && !SysCfg().IsImporting() && !SysCfg().IsReindex()) {
                 pTo->fStartSync = false;
                 nSyncTipHeight  = pTo->nStartingHeight;
-                LogPrint(BCLog::NET, "start block sync lead to getblocks\n");
-                PushGetBlocks(pTo, chainActive.Tip(), uint256());
+                static bool fHeadersFirstSync = SysCfg().GetBoolArg("-headersfirstsync", DEFAULT_HEADERS_FIRST_SYNC);
+                if (fHeadersFirstSync && pTo->nVersion >= HEADERS_FIRST_VERSION) {
+                    LogPrint(BCLog::NET, "start block sync lead to getheaders\n");
+                    PushGetHeaders(pTo, uint256());
+                } else {
+                    LogPrint(BCLog::NET, "start block sync lead to getblocks\n");
+                    PushGetBlocks(pTo, chainActive.Tip(), uint256());
+                }
             }
 
+            ResumeSyncHeaders(pTo);
+            ScheduleBlockDownload(pTo);
+
             // Resend wallet transactions that haven't gotten in a block yet
             // Except during reindex, importing and IBD, when old wallet
             // transactions become unconfirmed and spams other nodes.
@@ -220,7 +243,10 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
         int32_t index = 0;
         while (!pTo->fDisconnect && state.nBlocksToDownload && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
             uint256 hash = state.vBlocksToDownload.front();
-            vGetData.push_back(CInv(MSG_BLOCK, hash));
+            // a single new block announced by the peer is requested as a compact block, not the blocks to sync
+            bool fCompact = fCompactBlocks && pTo->fSupportsCompactBlocks && state.nBlocksToDownload == 1 &&
+                            state.nBlocksInFlight == 0;
+            vGetData.push_back(CInv(fCompact ? MSG_CMPCT_BLOCK : MSG_BLOCK, hash));
             MarkBlockAsInFlight(hash, pTo->GetId());
             LogPrint(BCLog::NET, "send MSG_BLOCK msg! time_ms=%lld, hash=%s, peer=%s, FlightBlocks=%d, index=%d\n",
                 GetTimeMillis(), hash.ToString(), state.name, state.nBlocksInFlight, index++);
@@ -290,6 +290,12 @@ bool CAccountDBCache::Flush() {
     return true;
 }
 
+void CAccountDBCache::Clear() {
+    accountCache.Clear();
+    regId2KeyIdCache.Clear();
+    nickId2KeyIdCache.Clear();
+}
+
 uint32_t CAccountDBCache::GetCacheSize() const {
     return accountCache.GetCacheSize() +
         regId2KeyIdCache.GetCacheSize() +
@@ -95,6 +95,7 @@ public:
     uint64_t GetAccountFreeAmount(const CKeyID &keyId, const TokenSymbol &tokenSymbol);
 
     bool Flush();
+    void Clear();
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
         accountCache.SetDbOpLogMap(pDbOpLogMapIn);
@@ -62,6 +62,7 @@ public:
     bool EraseAssetTradingPair(const CAssetTradingPair &assetTradingPair);
 
     bool Flush();
+    void Clear();
 
     uint32_t GetCacheSize() const { return assetCache.GetCacheSize() + assetTradingPairCache.GetCacheSize(); }
 
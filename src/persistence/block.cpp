@@ -185,6 +185,149 @@ bool ReadBlockFromDisk(const CBlockIndex *pIndex, CBlock &block) {
     return true;
 }
 
+bool ReadRawBlockFromDisk(const CDiskBlockPos &pos, CSerializeData &data) {
+    // the block is preceded by the message start and its size
+    static const uint32_t BLOCK_HEADER_SIZE = MESSAGE_START_SIZE + sizeof(uint32_t);
+    if (pos.nPos < BLOCK_HEADER_SIZE)
+        return ERRORMSG("ReadRawBlockFromDisk : invalid block pos %d:%u", pos.nFile, pos.nPos);
+
+    CAutoFile filein = CAutoFile(OpenBlockFile(CDiskBlockPos(pos.nFile, pos.nPos - BLOCK_HEADER_SIZE), true),
+                                 SER_DISK, CLIENT_VERSION);
+    if (!filein)
+        return ERRORMSG("ReadRawBlockFromDisk : OpenBlockFile failed");
+
+    try {
+        uint8_t messageStart[MESSAGE_START_SIZE];
+        uint32_t nSize;
+        filein >> FLATDATA(messageStart) >> nSize;
+        if (memcmp(messageStart, SysCfg().MessageStart(), MESSAGE_START_SIZE) != 0)
+            return ERRORMSG("ReadRawBlockFromDisk : invalid message start at %d:%u", pos.nFile, pos.nPos);
+        if (nSize > MAX_BLOCK_SIZE)
+            return ERRORMSG("ReadRawBlockFromDisk : invalid block size %u at %d:%u", nSize, pos.nFile, pos.nPos);
+
+        size_t offset = data.size();
+        data.resize(offset + nSize);
+        filein.read(&data[offset], nSize);
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : I/O error - %s", __func__, e.what());
+    }
+
+    return true;
+}
+
+void CRecentBlockCache::SetLimit(uint32_t maxCountIn, uint64_t maxSizeIn) {
+    LOCK(cs);
+    maxCount = maxCountIn;
+    maxSize  = maxSizeIn;
+    EvictFarthest();
+}
+
+void CRecentBlockCache::Add(const CBlock &block) {
+    LOCK(cs);
+    if (maxCount == 0)
+        return;
+
+    CItem &item = items[std::make_pair((int32_t)block.GetHeight(), block.GetHash())];
+    if (item.spBlock)
+        return;
+
+    item.spBlock = std::make_shared<CBlock>(block);
+    item.size    = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+    totalSize += item.size;
+    EvictFarthest();
+}
+
+bool CRecentBlockCache::Get(const CBlockIndex *pIndex, CBlock &block) const {
+    LOCK(cs);
+    auto it = items.find(std::make_pair(pIndex->height, pIndex->GetBlockHash()));
+    if (it == items.end())
+        return false;
+
+    // the txs are shared with the cached block, they are immutable except the memory only fields
+    block = *it->second.spBlock;
+    return true;
+}
+
+bool CRecentBlockCache::ReadBlock(const CBlockIndex *pIndex, CBlock &block) {
+    if (Get(pIndex, block))
+        return true;
+
+    if (!ReadBlockFromDisk(pIndex, block))
+        return false;
+
+    Add(block);
+    return true;
+}
+
+uint32_t CRecentBlockCache::GetCount() const {
+    LOCK(cs);
+    return items.size();
+}
+
+uint64_t CRecentBlockCache::GetSize() const {
+    LOCK(cs);
+    return totalSize;
+}
+
+void CRecentBlockCache::EvictFarthest() {
+    // the farthest block is the lowest or the highest one, the lower one goes first if they are as far
+    int32_t tipHeight = chainActive.Height();
+    // keep the nearest block even if it exceeds the memory limit alone
+    while (!items.empty() && (items.size() > maxCount || (items.size() > 1 && totalSize > maxSize))) {
+        auto it = std::prev(items.end());
+        if (tipHeight - items.begin()->first.first >= it->first.first - tipHeight)
+            it = items.begin();
+
+        totalSize -= it->second.size;
+        items.erase(it);
+    }
+}
+
+void CSerializedBlockCache::SetLimit(uint64_t maxSizeIn) {
+    LOCK(cs);
+    maxSize = maxSizeIn;
+    EvictOldest();
+}
+
+void CSerializedBlockCache::Add(const uint256 &blockHash, const std::shared_ptr<const CSerializeData> &spData) {
+    LOCK(cs);
+    if (maxSize == 0 || itemIndex.count(blockHash))
+        return;
+
+    items.emplace_front(blockHash, spData);
+    itemIndex[blockHash] = items.begin();
+    totalSize += spData->size();
+    EvictOldest();
+}
+
+std::shared_ptr<const CSerializeData> CSerializedBlockCache::Get(const uint256 &blockHash) {
+    LOCK(cs);
+    auto it = itemIndex.find(blockHash);
+    if (it == itemIndex.end())
+        return nullptr;
+
+    items.splice(items.begin(), items, it->second);
+    return it->second->second;
+}
+
+uint32_t CSerializedBlockCache::GetCount() const {
+    LOCK(cs);
+    return items.size();
+}
+
+uint64_t CSerializedBlockCache::GetSize() const {
+    LOCK(cs);
+    return totalSize;
+}
+
+void CSerializedBlockCache::EvictOldest() {
+    while (!items.empty() && totalSize > maxSize) {
+        totalSize -= items.back().second->size();
+        itemIndex.erase(items.back().first);
+        items.pop_back();
+    }
+}
+
 bool ReadBaseTxFromDisk(const CTxCord txCord, std::shared_ptr<CBaseTx> &pTx) {
     auto pBlock = std::make_shared<CBlock>();
     const CBlockIndex* pBlockIndex = chainActive[ txCord.GetHeight() ];
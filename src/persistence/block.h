@@ -20,6 +20,7 @@
 
 
 #include <stdint.h>
+#include <list>
 #include <memory>
 
 class CBlockDBCache;
@@ -324,6 +325,8 @@ public:
         block.SetTime(nTime);
         block.SetNonce(nNonce);
         block.SetHeight(height);
+        block.SetFuel(nFuel);
+        block.SetFuelRate(nFuelRate);
         block.SetSignature(vSignature);
 
         return block;
@@ -468,8 +471,86 @@ struct CBlockLocator {
 bool WriteBlockToDisk(CBlock &block, CDiskBlockPos &pos);
 bool ReadBlockFromDisk(const CDiskBlockPos &pos, CBlock &block);
 bool ReadBlockFromDisk(const CBlockIndex *pIndex, CBlock &block);
+// Append the serialized block at pos to data as it is on disk, without deserializing it
+bool ReadRawBlockFromDisk(const CDiskBlockPos &pos, CSerializeData &data);
+
+// the default memory limit of the recently connected blocks
+static const uint64_t DEFAULT_RECENT_BLOCK_CACHE_SIZE = 64 << 20;
+
+/**
+ * The recently accepted and connected blocks indexed by height and hash, the forked blocks could be kept too.
+ * Connecting a block needs the blocks of mature reward, tx memory cache and price point memory cache
+ * windows, all of them could be served here instead of reading from disk. The blocks farthest from
+ * the active tip, far below it or far ahead of it, are evicted when exceeding the count or memory
+ * limit. Requires cs_main by the callers, the tip is read when evicting.
+ */
+class CRecentBlockCache {
+public:
+    CRecentBlockCache(): maxCount(0), maxSize(DEFAULT_RECENT_BLOCK_CACHE_SIZE), totalSize(0) {}
+
+    void SetLimit(uint32_t maxCountIn, uint64_t maxSizeIn);
+
+    void Add(const CBlock &block);
+
+    bool Get(const CBlockIndex *pIndex, CBlock &block) const;
+
+    // read the block from cache, or from disk and add it to cache
+    bool ReadBlock(const CBlockIndex *pIndex, CBlock &block);
+
+    uint32_t GetCount() const;
+    uint64_t GetSize() const;
+
+private:
+    struct CItem {
+        std::shared_ptr<const CBlock> spBlock;
+        uint32_t size = 0;
+    };
+
+    void EvictFarthest();
+
+    mutable CCriticalSection cs;
+    map<std::pair<int32_t, uint256>, CItem> items;  // (height, hash) -> block
+    uint32_t maxCount;
+    uint64_t maxSize;
+    uint64_t totalSize;
+};
 
 
+// the default memory limit of the serialized blocks recently served to peers
+static const uint64_t DEFAULT_SERIALIZED_BLOCK_CACHE_SIZE = 32 << 20;
+
+/**
+ * The serialized blocks recently served to peers, keyed by block hash and evicted in LRU order.
+ * The peers syncing from the same node request the same blocks in a short time, the cached bytes
+ * are sent again without reading from disk. The bytes are opaque to the cache, the p2p layer keeps
+ * the whole block message including the message header in it.
+ */
+class CSerializedBlockCache {
+public:
+    CSerializedBlockCache(): maxSize(DEFAULT_SERIALIZED_BLOCK_CACHE_SIZE), totalSize(0) {}
+
+    void SetLimit(uint64_t maxSizeIn);
+
+    void Add(const uint256 &blockHash, const std::shared_ptr<const CSerializeData> &spData);
+
+    // return nullptr if not found, the found block becomes the most recently used
+    std::shared_ptr<const CSerializeData> Get(const uint256 &blockHash);
+
+    uint32_t GetCount() const;
+    uint64_t GetSize() const;
+
+private:
+    typedef list<std::pair<uint256, std::shared_ptr<const CSerializeData>>> ItemList;
+
+    void EvictOldest();
+
+    mutable CCriticalSection cs;
+    ItemList items;  // the most recently used first
+    map<uint256, ItemList::iterator> itemIndex;
+    uint64_t maxSize;
+    uint64_t totalSize;
+};
+
 bool ReadBaseTxFromDisk(const CTxCord txCord, std::shared_ptr<CBaseTx> &pTx);
 
 template<typename TxType>
@@ -123,6 +123,15 @@ bool CBlockDBCache::Flush() {
     return true;
 }
 
+void CBlockDBCache::Clear() {
+    txDiskPosCache.Clear();
+    flagCache.Clear();
+    bestBlockHashCache.Clear();
+    lastBlockFileCache.Clear();
+    reindexCache.Clear();
+    finalityBlockCache.Clear();
+}
+
 uint256 CBlockDBCache::GetBestBlockHash() const {
     uint256 blockHash;
     bestBlockHashCache.GetData(blockHash);
@@ -63,6 +63,7 @@ public:
 
 public:
     bool Flush();
+    void Clear();
     uint32_t GetCacheSize() const;
 
     bool GetTxHashByAddress(const CKeyID &keyId, uint32_t height, map<string, string > &mapTxHash);
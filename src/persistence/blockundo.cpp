@@ -99,8 +99,15 @@ bool CBlockUndoExecutor::Execute() {
     // RegisterUndoFunc();
     const UndoDataFuncMap &undoDataFuncMap = cw.GetUndoDataFuncMap();
 
-    for (auto it = block_undo.vtxundo.rbegin(); it != block_undo.vtxundo.rend(); it++) {
-        for (const auto &opLogPair : it->dbOpLogMap.GetMap()) {
+    // the txs are undone in reverse order, or in order with fKeepData to set the first old value of a key
+    vector<CTxUndo*> txUndos;
+    for (auto &txUndo : block_undo.vtxundo)
+        txUndos.push_back(&txUndo);
+    if (!fKeepData)
+        std::reverse(txUndos.begin(), txUndos.end());
+
+    for (auto *pTxUndo : txUndos) {
+        for (const auto &opLogPair : pTxUndo->dbOpLogMap.GetMap()) {
             dbk::PrefixType prefixType = dbk::ParseKeyPrefixType(opLogPair.first);
             if (prefixType == dbk::EMPTY)
                 return ERRORMSG("%s(), unkown prefix! prefix_type=%s", __FUNCTION__,
@@ -110,7 +117,7 @@ bool CBlockUndoExecutor::Execute() {
                 return ERRORMSG("%s(), unfound prefix in db! prefix_type=%s", __FUNCTION__,
                                 opLogPair.first);
             }
-            funcMapIt->second(opLogPair.second);
+            funcMapIt->second(opLogPair.second, fKeepData);
         }
     }
     return true;
@@ -74,13 +74,19 @@ public:
     }
 };
 
+/**
+ * Undo the block in cw. With fKeepData, the block is undone beneath the data already changed in cw: the
+ * changed data is kept and the other data is set to its value before the block. It keeps an overlay which
+ * has undone the later blocks (e.g. a fork cache) valid when the block is connected to its base.
+ */
 class CBlockUndoExecutor {
 public:
     CCacheWrapper &cw;
     CBlockUndo &block_undo;
+    bool fKeepData;
 
-    CBlockUndoExecutor(CCacheWrapper &cwIn, CBlockUndo &blockUndoIn)
-        : cw(cwIn), block_undo(blockUndoIn) {}
+    CBlockUndoExecutor(CCacheWrapper &cwIn, CBlockUndo &blockUndoIn, bool fKeepDataIn = false)
+        : cw(cwIn), block_undo(blockUndoIn), fKeepData(fKeepDataIn) {}
     bool Execute();
 };
 
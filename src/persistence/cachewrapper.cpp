@@ -10,10 +10,11 @@
 ////////////////////////////////////////////////////////////////////////////////
 // class CCacheWrapper
 
-std::shared_ptr<CCacheWrapper>CCacheWrapper::NewCopyFrom(CCacheDBManager* pCdMan) {
-    auto pNewCopy = make_shared<CCacheWrapper>();
-    pNewCopy->CopyFrom(pCdMan);
-    return pNewCopy;
+std::shared_ptr<CCacheWrapper>CCacheWrapper::NewOverlayFrom(CCacheDBManager* pCdMan) {
+    auto pNewOverlay = make_shared<CCacheWrapper>(pCdMan);
+    // the tx memory cache can not record the removed txids in overlay, copy it since it is small
+    pNewOverlay->txCache = *pCdMan->pTxCache;
+    return pNewOverlay;
 }
 
 CCacheWrapper::CCacheWrapper() {}
@@ -50,22 +51,6 @@ CCacheWrapper::CCacheWrapper(CCacheDBManager* pCdMan) {
     ppCache.SetBaseViewPtr(pCdMan->pPpCache);
 }
 
-void CCacheWrapper::CopyFrom(CCacheDBManager* pCdMan){
-    sysParamCache  = *pCdMan->pSysParamCache;
-    blockCache     = *pCdMan->pBlockCache;
-    accountCache   = *pCdMan->pAccountCache;
-    assetCache     = *pCdMan->pAssetCache;
-    contractCache  = *pCdMan->pContractCache;
-    delegateCache  = *pCdMan->pDelegateCache;
-    cdpCache       = *pCdMan->pCdpCache;
-    closedCdpCache = *pCdMan->pClosedCdpCache;
-    dexCache       = *pCdMan->pDexCache;
-    txReceiptCache = *pCdMan->pReceiptCache;
-
-    txCache = *pCdMan->pTxCache;
-    ppCache = *pCdMan->pPpCache;
-}
-
 CCacheWrapper& CCacheWrapper::operator=(CCacheWrapper& other) {
     if (this == &other)
         return *this;
@@ -102,6 +87,22 @@ void CCacheWrapper::Flush() {
     ppCache.Flush();
 }
 
+void CCacheWrapper::Clear() {
+    sysParamCache.Clear();
+    blockCache.Clear();
+    accountCache.Clear();
+    assetCache.Clear();
+    contractCache.Clear();
+    delegateCache.Clear();
+    cdpCache.Clear();
+    closedCdpCache.Clear();
+    dexCache.Clear();
+    txReceiptCache.Clear();
+
+    txCache.Clear();
+    ppCache.Clear();
+}
+
 void CCacheWrapper::SetDbOpLogMap(CDBOpLogMap *pDbOpLogMap) {
     sysParamCache.SetDbOpLogMap(pDbOpLogMap);
     blockCache.SetDbOpLogMap(pDbOpLogMap);
@@ -239,3 +240,46 @@ bool CCacheDBManager::Flush() {
 
     return true;
 }
+
+void CCacheDBManager::SetReadCacheSize(int64_t totalSize) {
+    for (auto pDb : GetDbAccesses()) {
+        int64_t limit = totalSize / 100 * DBReadCachePercent[pDb->GetDbNameType()];
+        pDb->SetReadCacheLimit(limit);
+        LogPrint(BCLog::CDB, "set read cache size of db %s to %lld bytes\n", GetDbName(pDb->GetDbNameType()), limit);
+    }
+}
+
+int64_t CCacheDBManager::GetReadCacheUsage() const {
+    int64_t usage = 0;
+    for (auto pDb : GetDbAccesses()) {
+        usage += pDb->GetReadCacheUsage();
+    }
+    return usage;
+}
+
+bool CCacheDBManager::EnableKeyFilter(const string &prefixName) {
+    dbk::PrefixType prefixType = dbk::ParseKeyPrefixType(prefixName);
+    if (prefixType == dbk::EMPTY)
+        return ERRORMSG("%s, unknown db prefix: %s", __func__, prefixName);
+
+    DBNameType dbNameType = dbk::GetDbNameEnumByPrefix(prefixType);
+    for (auto pDb : GetDbAccesses()) {
+        if (pDb->GetDbNameType() == dbNameType) {
+            int64_t start = GetTimeMillis();
+            if (!pDb->EnableKeyFilter(prefixType))
+                return false;
+
+            LogPrint(BCLog::CDB, "enabled key filter of prefix %s, keys=%llu, memory=%llu bytes, %dms\n", prefixName,
+                     pDb->GetKeyFilter(prefixType)->GetKeyCount(), pDb->GetKeyFilter(prefixType)->GetMemorySize(),
+                     GetTimeMillis() - start);
+            return true;
+        }
+    }
+
+    return ERRORMSG("%s, the db of prefix %s is not found", __func__, prefixName);
+}
+
+vector<CDBAccess*> CCacheDBManager::GetDbAccesses() const {
+    return {pSysParamDb, pAccountDb, pAssetDb, pContractDb, pDelegateDb, pCdpDb,
+            pClosedCdpDb, pDexDb, pBlockDb, pLogDb, pReceiptDb};
+}
@@ -38,7 +38,8 @@ public:
     CTxMemCache         txCache;
     CPricePointMemCache ppCache;
 public:
-    static std::shared_ptr<CCacheWrapper> NewCopyFrom(CCacheDBManager* pCdMan);
+    // new overlay of the global caches, it only holds the changed data and shares the rest with pCdMan
+    static std::shared_ptr<CCacheWrapper> NewOverlayFrom(CCacheDBManager* pCdMan);
 public:
     CCacheWrapper();
 
@@ -47,10 +48,11 @@ public:
 
     CCacheWrapper& operator=(CCacheWrapper& other);
 
-    void CopyFrom(CCacheDBManager* pCdMan);
-
     void Flush();
 
+    // discard the dirty data of all caches, so the wrapper can be reused as a fresh overlay of its base
+    void Clear();
+
     UndoDataFuncMap GetUndoDataFuncMap();
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMap);
@@ -106,6 +108,16 @@ public:
     ~CCacheDBManager();
 
     bool Flush();
+
+    // split the total read cache size (in bytes) to the dbs by DBReadCachePercent
+    void SetReadCacheSize(int64_t totalSize);
+
+    int64_t GetReadCacheUsage() const;
+
+    // enable the key filter of prefix by prefix name, such as "idac"
+    bool EnableKeyFilter(const string &prefixName);
+
+    vector<CDBAccess*> GetDbAccesses() const;
 };  // CCacheDBManager
 
 #endif //PERSIST_CACHEWRAPPER_H
\ No newline at end of file
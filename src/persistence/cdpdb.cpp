@@ -5,19 +5,131 @@
 
 #include "cdpdb.h"
 
+bool CCdpRatioIndex::Load(CDBAccess *pDbAccess) {
+    keys.clear();
+    if (pDbAccess == nullptr) {
+        loaded = true;
+        return true;
+    }
+
+    RatioCDPIdCache::KeyType key;
+    shared_ptr<leveldb::Iterator> pCursor = pDbAccess->NewIterator();
+    const string &prefix = dbk::GetKeyPrefix(dbk::CDP_RATIO);
+    for (pCursor->Seek(prefix); pCursor->Valid(); pCursor->Next()) {
+        boost::this_thread::interruption_point();
+
+        try {
+            // only the keys are loaded, the cdps are read on demand
+            if (!dbk::ParseDbKey(pCursor->key(), dbk::CDP_RATIO, key))
+                break;
+        } catch (std::exception &e) {
+            keys.clear();
+            return ERRORMSG("%s : Deserialize or I/O error - %s", __FUNCTION__, e.what());
+        }
+        keys.emplace_hint(keys.end(), key);
+    }
+
+    loaded = true;
+    return true;
+}
+
+void CCdpRatioIndex::Update(const RatioCDPIdCache::Map &mapData) {
+    // the data will be read from db when the index is loaded
+    if (!loaded)
+        return;
+
+    for (const auto &item : mapData) {
+        if (db_util::IsEmpty(item.second))
+            keys.erase(item.first);
+        else
+            keys.insert(item.first);
+    }
+}
+
+CCdpRatioCursor::CCdpRatioCursor(CCdpDBCache &cdpCache, const uint64_t collateralRatio,
+                                 const uint64_t bcoinMedianPrice)
+    : ratioCache(cdpCache.ratioCDPIdCache) {
+    double ratio = (double(collateralRatio) / RATIO_BOOST) / (double(bcoinMedianPrice) / PRICE_BOOST);
+    assert(uint64_t(ratio * CDP_BASE_RATIO_BOOST) < UINT64_MAX);
+    uint64_t ratioBoost = uint64_t(ratio * CDP_BASE_RATIO_BOOST) + 1;
+    string strRatio = strprintf("%016x", ratioBoost);
+    string heightStr      = strprintf("%016x", 0);
+    RatioCDPIdCache::KeyType endKey(strRatio, heightStr, uint256());
+
+    RatioCDPIdCache *pCache = &cdpCache.ratioCDPIdCache;
+    for (; pCache != nullptr; pCache = pCache->GetBasePtr()) {
+        const auto &mapData = pCache->GetMapData();
+        layers.emplace_back(mapData.begin(), mapData.lower_bound(endKey));
+    }
+
+    CCdpRatioIndex &index = *cdpCache.pRatioIndex;
+    if (!index.IsLoaded() && !index.Load(cdpCache.ratioCDPIdCache.GetDbAccessPtr())) {
+        // the cdps of db are unknown, the cursor must not be taken as empty
+        failed   = true;
+        indexIt  = index.GetKeys().end();
+        indexEnd = index.GetKeys().end();
+        return;
+    }
+    indexIt  = index.GetKeys().begin();
+    indexEnd = index.GetKeys().lower_bound(endKey);
+
+    MoveToNext();
+}
+
+void CCdpRatioCursor::MoveToNext() {
+    while (true) {
+        // the smallest key of all the layers, the upper layer overrides the lower ones
+        const RatioCDPIdCache::KeyType *pKey = nullptr;
+        const CUserCDP *pValue               = nullptr;
+        for (const auto &layer : layers) {
+            if (layer.first != layer.second && (pKey == nullptr || layer.first->first < *pKey)) {
+                pKey   = &layer.first->first;
+                pValue = &layer.first->second;
+            }
+        }
+        if (indexIt != indexEnd && (pKey == nullptr || *indexIt < *pKey)) {
+            pKey   = &(*indexIt);
+            pValue = nullptr;
+        }
+
+        if (pKey == nullptr) {
+            valid = false;
+            return;
+        }
+
+        currKey = *pKey;
+        // the empty value is the cdp erased from the lower layers
+        bool erased = pValue != nullptr && db_util::IsEmpty(*pValue);
+
+        for (auto &layer : layers) {
+            if (layer.first != layer.second && layer.first->first == currKey)
+                ++layer.first;
+        }
+        if (indexIt != indexEnd && *indexIt == currKey)
+            ++indexIt;
+
+        if (!erased) {
+            valid = true;
+            return;
+        }
+    }
+}
+
 CCdpDBCache::CCdpDBCache(CDBAccess *pDbAccess)
     : globalStakedBcoinsCache(pDbAccess),
       globalOwedScoinsCache(pDbAccess),
       cdpCache(pDbAccess),
       regId2CDPCache(pDbAccess),
-      ratioCDPIdCache(pDbAccess) {}
+      ratioCDPIdCache(pDbAccess),
+      pRatioIndex(make_shared<CCdpRatioIndex>()) {}
 
 CCdpDBCache::CCdpDBCache(CCdpDBCache *pBaseIn)
     : globalStakedBcoinsCache(pBaseIn->globalStakedBcoinsCache),
       globalOwedScoinsCache(pBaseIn->globalOwedScoinsCache),
       cdpCache(pBaseIn->cdpCache),
       regId2CDPCache(pBaseIn->regId2CDPCache),
-      ratioCDPIdCache(pBaseIn->ratioCDPIdCache) {}
+      ratioCDPIdCache(pBaseIn->ratioCDPIdCache),
+      pRatioIndex(pBaseIn->pRatioIndex) {}
 
 bool CCdpDBCache::NewCDP(const int32_t blockHeight, CUserCDP &cdp) {
     assert(!cdpCache.HaveData(cdp.cdpid));
@@ -130,14 +242,19 @@ bool CCdpDBCache::CheckGlobalCollateralCeilingReached(const uint64_t newBcoinsTo
 
 bool CCdpDBCache::GetCdpListByCollateralRatio(const uint64_t collateralRatio, const uint64_t bcoinMedianPrice,
                                               RatioCDPIdCache::Map &userCdps) {
-    double ratio = (double(collateralRatio) / RATIO_BOOST) / (double(bcoinMedianPrice) / PRICE_BOOST);
-    assert(uint64_t(ratio * CDP_BASE_RATIO_BOOST) < UINT64_MAX);
-    uint64_t ratioBoost = uint64_t(ratio * CDP_BASE_RATIO_BOOST) + 1;
-    string strRatio = strprintf("%016x", ratioBoost);
-    string heightStr      = strprintf("%016x", 0);
-    RatioCDPIdCache::KeyType endKey(strRatio, heightStr, uint256());
+    CUserCDP cdp;
+    CCdpRatioCursor cursor(*this, collateralRatio, bcoinMedianPrice);
+    if (cursor.IsFailed())
+        return ERRORMSG("%s : load cdp ratio index failed", __FUNCTION__);
 
-    return ratioCDPIdCache.GetAllElements(endKey, userCdps);
+    for (; cursor.IsValid(); cursor.Next()) {
+        if (!cursor.GetCdp(cdp))
+            return ERRORMSG("%s : read cdp failed", __FUNCTION__);
+
+        userCdps.emplace(cursor.GetKey(), cdp);
+    }
+
+    return true;
 }
 
 uint64_t CCdpDBCache::GetGlobalStakedBcoins() const {
@@ -177,6 +294,7 @@ void CCdpDBCache::SetBaseViewPtr(CCdpDBCache *pBaseIn) {
     cdpCache.SetBase(&pBaseIn->cdpCache);
     regId2CDPCache.SetBase(&pBaseIn->regId2CDPCache);
     ratioCDPIdCache.SetBase(&pBaseIn->ratioCDPIdCache);
+    pRatioIndex = pBaseIn->pRatioIndex;
 }
 
 void CCdpDBCache::SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
@@ -197,11 +315,22 @@ bool CCdpDBCache::Flush() {
     globalOwedScoinsCache.Flush();
     cdpCache.Flush();
     regId2CDPCache.Flush();
+    // the bottom cache writes the ratio data to db
+    if (ratioCDPIdCache.GetBasePtr() == nullptr)
+        pRatioIndex->Update(ratioCDPIdCache.GetMapData());
     ratioCDPIdCache.Flush();
 
     return true;
 }
 
+void CCdpDBCache::Clear() {
+    globalStakedBcoinsCache.Clear();
+    globalOwedScoinsCache.Clear();
+    cdpCache.Clear();
+    regId2CDPCache.Clear();
+    ratioCDPIdCache.Clear();
+}
+
 string GetCdpCloseTypeName(const CDPCloseType type) {
     switch (type) {
         case CDPCloseType:: BY_REDEEM:
@@ -11,9 +11,11 @@
 #include "dbaccess.h"
 
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <cstdint>
+#include <vector>
 
 using namespace std;
 
@@ -22,11 +24,26 @@ using namespace std;
 // cdpr{$Ratio}{$height}{$cdpid} -> CUserCDP
 typedef CCompositeKVCache<dbk::CDP_RATIO, tuple<string, string, uint256>, CUserCDP>      RatioCDPIdCache;
 
+// The ratio keys of the cdps saved in db, sorted by collateral ratio. It is loaded from db when it is used
+// at the first time, then updated with the ratio data written to db by the flush of the bottom cache.
+class CCdpRatioIndex {
+public:
+    bool IsLoaded() const { return loaded; }
+    bool Load(CDBAccess *pDbAccess);
+    void Update(const RatioCDPIdCache::Map &mapData);
+
+    const set<RatioCDPIdCache::KeyType>& GetKeys() const { return keys; }
+
+private:
+    bool loaded = false;
+    set<RatioCDPIdCache::KeyType> keys;
+};
 
+class CCdpRatioCursor;
 
 class CCdpDBCache {
 public:
-    CCdpDBCache() {}
+    CCdpDBCache(): pRatioIndex(make_shared<CCdpRatioIndex>()) {}
     CCdpDBCache(CDBAccess *pDbAccess);
     CCdpDBCache(CCdpDBCache *pBaseIn);
 
@@ -62,6 +79,7 @@ public:
 
     uint32_t GetCacheSize() const;
     bool Flush();
+    void Clear();
 
 private:
     bool SaveCDPToDB(const CUserCDP &cdp);
@@ -85,6 +103,41 @@ private:
     CCompositeKVCache<      dbk::REGID_CDP, string,                     set<uint256>>       regId2CDPCache;
     // cdpr{Ratio}{$cdpid} -> CUserCDP
     RatioCDPIdCache           ratioCDPIdCache;
+    // shared by all the cache layers, only the bottom cache updates it
+    shared_ptr<CCdpRatioIndex> pRatioIndex;
+
+    friend class CCdpRatioCursor;
+};
+
+// Iterates the cdps whose collateral ratio is below the given ratio, from the lowest ratio. The dirty data of
+// every cache layer is merged with the ratio index of db, and the cdp is only read when GetCdp() is called.
+// The cdp cache must not be changed while the cursor is in use. IsFailed() must be checked before iterating, the
+// failed cursor is never valid.
+class CCdpRatioCursor {
+public:
+    CCdpRatioCursor(CCdpDBCache &cdpCache, const uint64_t collateralRatio, const uint64_t bcoinMedianPrice);
+
+    // failed to load the ratio index of db
+    bool IsFailed() const { return failed; }
+    bool IsValid() const { return valid; }
+    void Next() { MoveToNext(); }
+
+    const RatioCDPIdCache::KeyType& GetKey() const { return currKey; }
+    bool GetCdp(CUserCDP &cdp) const { return ratioCache.GetData(currKey, cdp); }
+
+private:
+    typedef RatioCDPIdCache::Map::const_iterator LayerIterator;
+    typedef set<RatioCDPIdCache::KeyType>::const_iterator IndexIterator;
+
+    void MoveToNext();
+
+    const RatioCDPIdCache &ratioCache;
+    vector<pair<LayerIterator, LayerIterator>> layers;  // from the top cache to the bottom cache
+    IndexIterator indexIt;
+    IndexIterator indexEnd;
+    bool valid  = false;
+    bool failed = false;
+    RatioCDPIdCache::KeyType currKey;
 };
 
 enum CDPCloseType: uint8_t {
@@ -133,6 +186,11 @@ public:
         closedTxCdpCache.Flush();
     }
 
+    void Clear() {
+        closedCdpTxCache.Clear();
+        closedTxCdpCache.Clear();
+    }
+
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
         closedCdpTxCache.SetDbOpLogMap(pDbOpLogMapIn);
         closedTxCdpCache.SetDbOpLogMap(pDbOpLogMapIn);
@@ -43,7 +43,8 @@ bool CContractDBCache::GetContracts(map<string, CUniversalContract> &contracts)
 }
 
 bool CContractDBCache::SaveContract(const CRegID &contractRegId, const CUniversalContract &contract) {
-    return contractCache.SetData(contractRegId.ToRawString(), contract);
+    return contractCache.SetData(contractRegId.ToRawString(), contract) &&
+           contractCodeHashCache.SetData(contractRegId.ToRawString(), Hash(contract.code.begin(), contract.code.end()));
 }
 
 bool CContractDBCache::HaveContract(const CRegID &contractRegId) {
@@ -51,9 +52,22 @@ bool CContractDBCache::HaveContract(const CRegID &contractRegId) {
 }
 
 bool CContractDBCache::EraseContract(const CRegID &contractRegId) {
+    contractCodeHashCache.EraseData(contractRegId.ToRawString());
     return contractCache.EraseData(contractRegId.ToRawString());
 }
 
+bool CContractDBCache::GetContractCodeHash(const CRegID &contractRegId, uint256 &codeHash) {
+    if (contractCodeHashCache.GetData(contractRegId.ToRawString(), codeHash))
+        return true;
+
+    CUniversalContract contract;
+    if (!contractCache.GetData(contractRegId.ToRawString(), contract))
+        return false;
+
+    codeHash = Hash(contract.code.begin(), contract.code.end());
+    return true;
+}
+
 /************************ contract data ******************************/
 bool CContractDBCache::GetContractData(const CRegID &contractRegId, const string &contractKey, string &contractData) {
     auto key = std::make_pair(contractRegId.ToRawString(), contractKey);
@@ -89,14 +103,24 @@ bool CContractDBCache::Flush() {
     contractDataCache.Flush();
     contractAccountCache.Flush();
     contractTracesCache.Flush();
+    contractCodeHashCache.Flush();
 
     return true;
 }
 
+void CContractDBCache::Clear() {
+    contractCache.Clear();
+    contractDataCache.Clear();
+    contractAccountCache.Clear();
+    contractTracesCache.Clear();
+    contractCodeHashCache.Clear();
+}
+
 uint32_t CContractDBCache::GetCacheSize() const {
     return contractCache.GetCacheSize() +
         contractDataCache.GetCacheSize() +
-        contractTracesCache.GetCacheSize();
+        contractTracesCache.GetCacheSize() +
+        contractCodeHashCache.GetCacheSize();
 }
 
 
@@ -68,7 +68,8 @@ public:
         contractCache(pDbAccess),
         contractDataCache(pDbAccess),
         contractAccountCache(pDbAccess),
-        contractTracesCache(pDbAccess) {
+        contractTracesCache(pDbAccess),
+        contractCodeHashCache(pDbAccess) {
         assert(pDbAccess->GetDbNameType() == DBNameType::CONTRACT);
     };
 
@@ -76,7 +77,8 @@ public:
         contractCache(pBaseIn->contractCache),
         contractDataCache(pBaseIn->contractDataCache),
         contractAccountCache(pBaseIn->contractAccountCache),
-        contractTracesCache(pBaseIn->contractTracesCache) {};
+        contractTracesCache(pBaseIn->contractTracesCache),
+        contractCodeHashCache(pBaseIn->contractCodeHashCache) {};
 
     bool GetContractAccount(const CRegID &contractRegId, const string &accountKey, CAppUserAccount &appAccOut);
     bool SetContractAccount(const CRegID &contractRegId, const CAppUserAccount &appAccIn);
@@ -86,6 +88,9 @@ public:
     bool SaveContract(const CRegID &contractRegId, const CUniversalContract &contract);
     bool HaveContract(const CRegID &contractRegId);
     bool EraseContract(const CRegID &contractRegId);
+    // the hash of the contract code saved with the contract, it is computed from the code for the
+    // contracts saved before
+    bool GetContractCodeHash(const CRegID &contractRegId, uint256 &codeHash);
 
     bool GetContractData(const CRegID &contractRegId, const string &contractKey, string &contractData);
     bool SetContractData(const CRegID &contractRegId, const string &contractKey, const string &contractData);
@@ -96,6 +101,7 @@ public:
     bool SetContractTraces(const uint256 &txid, const string &contractTraces);
 
     bool Flush();
+    void Clear();
     uint32_t GetCacheSize() const;
 
     void SetBaseViewPtr(CContractDBCache *pBaseIn) {
@@ -103,6 +109,7 @@ public:
         contractDataCache.SetBase(&pBaseIn->contractDataCache);
         contractAccountCache.SetBase(&pBaseIn->contractAccountCache);
         contractTracesCache.SetBase(&pBaseIn->contractTracesCache);
+        contractCodeHashCache.SetBase(&pBaseIn->contractCodeHashCache);
     };
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
@@ -110,6 +117,7 @@ public:
         contractDataCache.SetDbOpLogMap(pDbOpLogMapIn);
         contractAccountCache.SetDbOpLogMap(pDbOpLogMapIn);
         contractTracesCache.SetDbOpLogMap(pDbOpLogMapIn);
+        contractCodeHashCache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
@@ -117,6 +125,7 @@ public:
         contractDataCache.RegisterUndoFunc(undoDataFuncMap);
         contractAccountCache.RegisterUndoFunc(undoDataFuncMap);
         contractTracesCache.RegisterUndoFunc(undoDataFuncMap);
+        contractCodeHashCache.RegisterUndoFunc(undoDataFuncMap);
     }
 
     shared_ptr<CDBContractDataIterator> CreateContractDataIterator(const CRegID &contractRegid,
@@ -135,6 +144,8 @@ private:
     CCompositeKVCache< dbk::CONTRACT_ACCOUNT,     pair<string, string>,     CAppUserAccount >      contractAccountCache;
     // txid -> contract_traces
     CCompositeKVCache< dbk::CONTRACT_ACCOUNT,     uint256,                  string >      contractTracesCache;
+    // contract $RegId.ToRawString() -> code hash
+    CCompositeKVCache< dbk::CONTRACT_CODE_HASH,   string,                   uint256 >     contractCodeHashCache;
 };
 
 #endif  // PERSIST_CONTRACTDB_H
\ No newline at end of file
@@ -10,6 +10,11 @@
 #include "dbconf.h"
 #include "leveldbwrapper.h"
 
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -145,20 +150,245 @@ namespace db_util {
     }
 };
 
-typedef void(UndoDataFunc)(const CDbOpLogs &pDbOpLogs);
+/**
+ * Memory budget of the clean read caches of one db, shared by all the kv caches on the db.
+ */
+class CDBReadCacheBudget {
+public:
+    std::atomic<int64_t> limit{0};  // in bytes
+    std::atomic<int64_t> usage{0};  // in bytes, shared by the read caches of one db
+
+    bool IsFull() const { return usage > limit; }
+};
+
+/**
+ * Size-accounted LRU cache of the clean values read from db.
+ * Only the top level kv cache (which has the db access) owns it, the dirty values are kept in
+ * mapData of the kv cache and never stay in the read cache at the same time.
+ * The copy of a read cache is empty, it only shares the budget of the source.
+ * The reads are not always under cs_main (e.g. rpc), so the cache has its own lock and the values are
+ * shared with the readers, an evicted value stays valid until the reader releases it.
+ */
+template<typename KeyType, typename ValueType>
+class CDBReadCache {
+public:
+    typedef std::shared_ptr<const ValueType> ValuePtr;
+    typedef std::pair<KeyType, ValuePtr> Item;
+    typedef typename std::list<Item>::iterator ItemIterator;
+
+public:
+    CDBReadCache() {}
+
+    CDBReadCache(const CDBReadCache &other): spBudget(other.spBudget) {}
+
+    CDBReadCache& operator=(const CDBReadCache &other) {
+        if (this != &other) {
+            Clear();
+            spBudget = other.spBudget;
+        }
+        return *this;
+    }
+
+    ~CDBReadCache() { Clear(); }
+
+    void SetBudget(const std::shared_ptr<CDBReadCacheBudget> &spBudgetIn) {
+        std::lock_guard<std::mutex> lock(mtx);
+        assert(itemList.empty());
+        spBudget = spBudgetIn;
+    }
+
+    // return nullptr if not found, the hit item is moved to the most recently used position
+    ValuePtr Get(const KeyType &key) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = itemIndex.find(key);
+        if (it == itemIndex.end())
+            return nullptr;
+
+        itemList.splice(itemList.begin(), itemList, it->second);
+        return it->second->second;
+    }
+
+    ValuePtr Put(const KeyType &key, const ValueType &value) {
+        auto spValue = std::make_shared<const ValueType>(value);
+        std::lock_guard<std::mutex> lock(mtx);
+        EraseKey(key);
+        itemList.emplace_front(key, spValue);
+        itemIndex.emplace(key, itemList.begin());
+        AddUsage(GetItemSize(itemList.front()));
+        Evict();
+        return spValue;
+    }
+
+    // remove the item and return its value, used to move a clean value to the dirty set
+    bool Take(const KeyType &key, ValueType &value) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = itemIndex.find(key);
+        if (it == itemIndex.end())
+            return false;
+
+        value = *it->second->second;
+        EraseItem(it);
+        return true;
+    }
+
+    void Erase(const KeyType &key) {
+        std::lock_guard<std::mutex> lock(mtx);
+        EraseKey(key);
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mtx);
+        AddUsage(-usage);
+        itemIndex.clear();
+        itemList.clear();
+    }
+
+    size_t GetCount() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return itemList.size();
+    }
+
+    int64_t GetUsage() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return usage;
+    }
+
+private:
+    static int64_t GetItemSize(const Item &item) {
+        return ::GetSerializeSize(item.first, SER_DISK, CLIENT_VERSION) +
+               ::GetSerializeSize(*item.second, SER_DISK, CLIENT_VERSION);
+    }
+
+    // the methods below require mtx
+    void EraseKey(const KeyType &key) {
+        auto it = itemIndex.find(key);
+        if (it != itemIndex.end())
+            EraseItem(it);
+    }
+
+    void EraseItem(typename std::map<KeyType, ItemIterator>::iterator it) {
+        AddUsage(-GetItemSize(*it->second));
+        itemList.erase(it->second);
+        itemIndex.erase(it);
+    }
+
+    void Evict() {
+        if (!spBudget)
+            return;
+        // keep the most recently used item
+        while (itemList.size() > 1 && spBudget->IsFull()) {
+            EraseItem(itemIndex.find(itemList.back().first));
+        }
+    }
+
+    void AddUsage(int64_t delta) {
+        usage += delta;
+        if (spBudget)
+            spBudget->usage += delta;
+    }
+
+private:
+    mutable std::mutex mtx;
+    std::list<Item> itemList;  // front is the most recently used
+    std::map<KeyType, ItemIterator> itemIndex;
+    int64_t usage = 0;
+    std::shared_ptr<CDBReadCacheBudget> spBudget = nullptr;
+};
+
+/**
+ * In-memory bloom filter of the db keys of one prefix, to short-circuit the definite misses.
+ * The key is never removed from the filter, so the erased keys become false positives only.
+ */
+class CDBKeyFilter {
+public:
+    enum {
+        BITS_PER_KEY = 10,
+        HASH_FUNCS   = 7, // about 1% false positive rate when filled with the expected keys
+    };
+
+    CDBKeyFilter(uint64_t expectedKeys)
+        : bitCount(std::max<uint64_t>(expectedKeys, 1 << 16) * BITS_PER_KEY),
+          bits((bitCount + 63) / 64, 0) {}
+
+    void Insert(const string &key) {
+        uint64_t h1, h2;
+        Hash(key, h1, h2);
+        for (uint32_t i = 0; i < HASH_FUNCS; i++) {
+            uint64_t pos = (h1 + i * h2) % bitCount;
+            bits[pos >> 6] |= (uint64_t)1 << (pos & 63);
+        }
+        ++keyCount;
+    }
+
+    bool MayContain(const string &key) const {
+        uint64_t h1, h2;
+        Hash(key, h1, h2);
+        for (uint32_t i = 0; i < HASH_FUNCS; i++) {
+            uint64_t pos = (h1 + i * h2) % bitCount;
+            if ((bits[pos >> 6] & ((uint64_t)1 << (pos & 63))) == 0)
+                return false;
+        }
+        return true;
+    }
+
+    uint64_t GetKeyCount() const { return keyCount; }
+    uint64_t GetMemorySize() const { return bits.size() * sizeof(uint64_t); }
+
+private:
+    static void Hash(const string &key, uint64_t &h1, uint64_t &h2) {
+        h1 = std::hash<string>()(key);
+        h2 = ((h1 >> 33) ^ (h1 * 0x9E3779B97F4A7C15ULL)) | 1;
+    }
+
+private:
+    uint64_t bitCount;
+    vector<uint64_t> bits;
+    uint64_t keyCount = 0;
+};
+
+/**
+ * Lookup statistics of one prefix on the top level caches
+ */
+struct CDBLookupStat {
+    std::atomic<uint64_t> readCacheHits{0};  // found the value in read cache
+    std::atomic<uint64_t> negativeHits{0};   // found the cached miss (empty value) in read cache
+    std::atomic<uint64_t> filterMisses{0};   // definite miss by key filter, db is not read
+    std::atomic<uint64_t> dbHits{0};
+    std::atomic<uint64_t> dbMisses{0};
+
+    bool IsEmpty() const {
+        return readCacheHits == 0 && negativeHits == 0 && filterMisses == 0 && dbHits == 0 && dbMisses == 0;
+    }
+};
+
+// with fKeepData, the op logs are applied beneath the data of the cache, see CBlockUndoExecutor
+typedef void(UndoDataFunc)(const CDbOpLogs &pDbOpLogs, bool fKeepData);
 typedef std::map<dbk::PrefixType, std::function<UndoDataFunc>> UndoDataFuncMap;
 
 class CDBAccess {
 public:
     CDBAccess(const boost::filesystem::path& dir, DBNameType dbNameTypeIn, bool fMemory, bool fWipe) :
               dbNameType(dbNameTypeIn),
-              db( dir / ::GetDbName(dbNameTypeIn), DBCacheSize[dbNameTypeIn], fMemory, fWipe ) {}
+              db( dir / ::GetDbName(dbNameTypeIn), DBCacheSize[dbNameTypeIn], fMemory, fWipe ),
+              spReadCacheBudget(make_shared<CDBReadCacheBudget>()) {}
 
     int64_t GetDbCount() const { return db.GetDbCount(); }
     template<typename KeyType, typename ValueType>
     bool GetData(const dbk::PrefixType prefixType, const KeyType &key, ValueType &value) const {
         string keyStr = dbk::GenDbKey(prefixType, key);
-        return db.Read(keyStr, value);
+        CDBLookupStat &stat = lookupStats[prefixType];
+        const auto &pKeyFilter = keyFilters[prefixType];
+        if (pKeyFilter && !pKeyFilter->MayContain(keyStr)) {
+            ++stat.filterMisses;
+            return false;
+        }
+
+        if (db.Read(keyStr, value)) {
+            ++stat.dbHits;
+            return true;
+        }
+        ++stat.dbMisses;
+        return false;
     }
 
     template<typename ValueType>
@@ -336,12 +566,15 @@ public:
 
     template<typename KeyType, typename ValueType>
     void BatchWrite(const dbk::PrefixType prefixType, const map<KeyType, ValueType> &mapData) {        CLevelDBBatch batch;
+        const auto &pKeyFilter = keyFilters[prefixType];
         for (auto item : mapData) {
             string key = dbk::GenDbKey(prefixType, item.first);
             if (db_util::IsEmpty(item.second)) {
                 batch.Erase(key);
             } else {
                 batch.Write(key, item.second);
+                if (pKeyFilter)
+                    pKeyFilter->Insert(key);
             }
         }
         db.WriteBatch(batch, true);
@@ -362,12 +595,53 @@ public:
 
     DBNameType GetDbNameType() const { return dbNameType; }
 
+    void SetReadCacheLimit(int64_t limit) { spReadCacheBudget->limit = limit; }
+    int64_t GetReadCacheLimit() const { return spReadCacheBudget->limit; }
+    int64_t GetReadCacheUsage() const { return spReadCacheBudget->usage; }
+    const std::shared_ptr<CDBReadCacheBudget>& GetReadCacheBudget() const { return spReadCacheBudget; }
+
+    CDBLookupStat& GetLookupStat(dbk::PrefixType prefixType) const { return lookupStats[prefixType]; }
+    const CDBKeyFilter* GetKeyFilter(dbk::PrefixType prefixType) const { return keyFilters[prefixType].get(); }
+
+    // load all the keys of the prefix from db to a new key filter
+    bool EnableKeyFilter(const dbk::PrefixType prefixType) {
+        assert(dbk::GetDbNameEnumByPrefix(prefixType) == dbNameType);
+        vector<string> keys;
+        shared_ptr<leveldb::Iterator> pCursor = NewIterator();
+        const string &prefix = dbk::GetKeyPrefix(prefixType);
+        for (pCursor->Seek(prefix); pCursor->Valid() && pCursor->key().starts_with(prefix); pCursor->Next()) {
+            boost::this_thread::interruption_point();
+            keys.push_back(pCursor->key().ToString());
+        }
+
+        // reserve the space for the keys of new data
+        std::unique_ptr<CDBKeyFilter> pKeyFilter(new CDBKeyFilter(keys.size() * 2));
+        for (const auto &key : keys) {
+            pKeyFilter->Insert(key);
+        }
+        keyFilters[prefixType] = std::move(pKeyFilter);
+        return true;
+    }
+
     std::shared_ptr<leveldb::Iterator> NewIterator() {
         return std::shared_ptr<leveldb::Iterator>(db.NewIterator());
     }
+
+    // the raw records as of the snapshot, for dumping the state snapshot
+    std::shared_ptr<leveldb::Iterator> NewIterator(const leveldb::Snapshot *pSnapshot) {
+        return std::shared_ptr<leveldb::Iterator>(db.NewIterator(pSnapshot));
+    }
+    const leveldb::Snapshot *GetSnapshot() { return db.GetSnapshot(); }
+    void ReleaseSnapshot(const leveldb::Snapshot *pSnapshot) { db.ReleaseSnapshot(pSnapshot); }
+
+    // write the raw records bypassing the caches, for loading the state snapshot
+    bool WriteBatch(CLevelDBBatch &batch) { return db.WriteBatch(batch, true); }
 private:
     DBNameType dbNameType;
     mutable CLevelDBWrapper db; // // TODO: remove the mutable declare
+    std::shared_ptr<CDBReadCacheBudget> spReadCacheBudget;
+    mutable CDBLookupStat lookupStats[dbk::PREFIX_COUNT];
+    std::unique_ptr<CDBKeyFilter> keyFilters[dbk::PREFIX_COUNT];
 };
 
 template<int32_t PREFIX_TYPE_VALUE, typename __KeyType, typename __ValueType>
@@ -395,6 +669,7 @@ public:
         pDbAccess(pDbAccessIn) {
         assert(pDbAccessIn != nullptr);
         assert(pDbAccess->GetDbNameType() == GetDbNameEnumByPrefix(PREFIX_TYPE));
+        readCache.SetBudget(pDbAccess->GetReadCacheBudget());
     };
 
     void SetBase(CCompositeKVCache *pBaseIn) {
@@ -407,11 +682,18 @@ public:
         pDbOpLogMap = pDbOpLogMapIn;
     }
 
+    // the size of dirty data which need to be flushed, accounted incrementally
     uint32_t GetCacheSize() const {
-        return ::GetSerializeSize(mapData, SER_DISK, CLIENT_VERSION);
+        return dataSize;
+    }
+
+    // the size of clean data read from db, only the top level cache has it
+    uint32_t GetReadCacheSize() const {
+        return readCache.GetUsage();
     }
 
     bool GetTopNElements(const uint32_t maxNum, set<KeyType> &keys) {
+        AddAccessPrefixLog();
         // 1. Get all candidate elements.
         set<KeyType> expiredKeys;
         set<KeyType> candidateKeys;
@@ -434,6 +716,7 @@ public:
 
     // map<string, ValueType>
     bool GetAllElements(const KeyType &endKey, Map &elements) {
+        AddAccessPrefixLog();
         set<KeyType> expiredKeys;
         if (!GetAllElements(endKey, elements, expiredKeys)) {
             // TODO: log
@@ -444,6 +727,7 @@ public:
     }
 
     bool GetAllElements(map<KeyType, ValueType> &elements) {
+        AddAccessPrefixLog();
         set<KeyType> expiredKeys;
         if (!GetAllElements(expiredKeys, elements)) {
             // TODO: log
@@ -457,9 +741,10 @@ public:
         if (db_util::IsEmpty(key)) {
             return false;
         }
-        auto it = GetDataIt(key);
-        if (it != mapData.end() && !db_util::IsEmpty(it->second)) {
-            value = it->second;
+        AddAccessLog(key);
+        auto pValue = GetDataPtr(key);
+        if (pValue != nullptr && !db_util::IsEmpty(*pValue)) {
+            value = *pValue;
             return true;
         }
         return false;
@@ -472,14 +757,11 @@ public:
         auto it = GetDataIt(key);
         if (it == mapData.end()) {
             auto emptyValue = db_util::MakeEmptyValue<ValueType>();
-            auto newRet = mapData.emplace(key, *emptyValue); // create new empty value
-            if (!newRet.second)
-                throw runtime_error(strprintf("%s :  %s, alloc new cache item failed", __FUNCTION__, __LINE__));
-
-            it = newRet.first;
+            it = AddDataItem(key, *emptyValue); // create new empty value
         }
         AddOpLog(key, it->second);
-        it->second = value;
+        UpdateDataItem(it, value);
+        AddRedoLog(key, value);
         return true;
     }
 
@@ -487,56 +769,80 @@ public:
         if (db_util::IsEmpty(key)) {
             return false;
         }
-        auto it = GetDataIt(key);
-        return it != mapData.end() && !db_util::IsEmpty(it->second);
+        AddAccessLog(key);
+        auto pValue = GetDataPtr(key);
+        return pValue != nullptr && !db_util::IsEmpty(*pValue);
     }
 
     bool EraseData(const KeyType &key) {
         if (db_util::IsEmpty(key)) {
             return false;
         }
+        AddAccessLog(key);
         Iterator it = GetDataIt(key);
         if (it != mapData.end() && !db_util::IsEmpty(it->second)) {
             AddOpLog(key, it->second);
-            db_util::SetEmpty(it->second);
+            UpdateDataItem(it, db_util::MakeEmpty<ValueType>());
+            AddRedoLog(key, it->second);
         }
         return true;
     }
 
+    // clear the dirty data only, the clean data in read cache is always the same as db
     void Clear() {
         mapData.clear();
+        dataSize = 0;
     }
 
     void Flush() {
         assert(pBase != nullptr || pDbAccess != nullptr);
+        if (pDbOpLogMap != nullptr && pDbOpLogMap->IsTrackingAccess()) {
+            for (const auto &item : mapData)
+                pDbOpLogMap->AddAccessKey(PREFIX_TYPE, dbk::GenDbKey(PREFIX_TYPE, item.first));
+        }
+
         if (pBase != nullptr) {
             assert(pDbAccess == nullptr);
             for (auto it : mapData) {
-                pBase->mapData[it.first] = it.second;
+                pBase->SetDataItem(it.first, it.second);
             }
         } else if (pDbAccess != nullptr) {
             assert(pBase == nullptr);
             pDbAccess->BatchWrite<KeyType, ValueType>(PREFIX_TYPE, mapData);
+            // keep the hot data resident after flushed, the erased data become cached misses
+            for (const auto &item : mapData) {
+                readCache.Put(item.first, item.second);
+            }
         }
 
         Clear();
     }
 
-    void UndoData(const CDbOpLog &dbOpLog) {
+    void UndoData(const CDbOpLog &dbOpLog, bool fKeepData = false) {
         KeyType key;
         ValueType value;
         dbOpLog.Get(key, value);
-        mapData[key] = value;
+        if (!fKeepData || mapData.count(key) == 0)
+            SetDataItem(key, value);
     }
 
-    void UndoDataList(const CDbOpLogs &dbOpLogs) {
+    // with fKeepData the logs are applied in order and the data in mapData is kept, so the first old
+    // value of a key is set only if the key is not changed in this cache
+    void UndoDataList(const CDbOpLogs &dbOpLogs, bool fKeepData) {
+        if (fKeepData) {
+            for (const auto &dbOpLog : dbOpLogs)
+                UndoData(dbOpLog, true);
+            return;
+        }
+
         for (auto it = dbOpLogs.rbegin(); it != dbOpLogs.rend(); it++) {
             UndoData(*it);
         }
     }
 
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
-        undoDataFuncMap[GetPrefixType()] = std::bind(&CCompositeKVCache::UndoDataList, this, std::placeholders::_1);
+        undoDataFuncMap[GetPrefixType()] = std::bind(&CCompositeKVCache::UndoDataList, this, std::placeholders::_1,
+                                                     std::placeholders::_2);
     }
 
     dbk::PrefixType GetPrefixType() const { return PREFIX_TYPE; }
@@ -553,36 +859,91 @@ public:
 
     map<KeyType, ValueType>& GetMapData() { return mapData; };
 private:
+    // find the value for reading, the value read from db is kept in the read cache instead of mapData
+    std::shared_ptr<const ValueType> GetDataPtr(const KeyType &key) const {
+        Iterator it = mapData.find(key);
+        if (it != mapData.end()) {
+            // the dirty value is owned by mapData, the pointer does not share it
+            return std::shared_ptr<const ValueType>(std::shared_ptr<const ValueType>(), &it->second);
+        } else if (pBase != nullptr) {
+            // read through the base cache, only the written data is copied to current mapData
+            return pBase->GetDataPtr(key);
+        } else if (pDbAccess != NULL) {
+            auto pValue = readCache.Get(key);
+            if (pValue != nullptr) {
+                CDBLookupStat &stat = pDbAccess->GetLookupStat(PREFIX_TYPE);
+                if (db_util::IsEmpty(*pValue))
+                    ++stat.negativeHits;
+                else
+                    ++stat.readCacheHits;
+                return pValue;
+            }
+
+            // the miss is saved as empty value for search performance
+            auto pDbValue = db_util::MakeEmptyValue<ValueType>();
+            pDbAccess->GetData(PREFIX_TYPE, key, *pDbValue);
+            return readCache.Put(key, *pDbValue);
+        }
+
+        return nullptr;
+    }
+
+    // find the value for writing, the found value must be in mapData
     Iterator GetDataIt(const KeyType &key) const {
         Iterator it = mapData.find(key);
         if (it != mapData.end()) {
             return it;
         } else if (pBase != nullptr) {
             // find key-value at base cache
-            auto baseIt = pBase->GetDataIt(key);
-            if (baseIt != pBase->mapData.end()) {
+            auto pBaseValue = pBase->GetDataPtr(key);
+            if (pBaseValue != nullptr && !db_util::IsEmpty(*pBaseValue)) {
                 // the found key-value add to current mapData
-                auto newRet = mapData.emplace(key, baseIt->second);
-                if (!newRet.second)
-                    throw runtime_error(strprintf("%s :  %s, alloc new cache item failed", __FUNCTION__, __LINE__));
-
-                return newRet.first;
+                return AddDataItem(key, *pBaseValue);
             }
         } else if (pDbAccess != NULL) {
-            // TODO: need to save the empty value to mapData for search performance?
+            // move the clean value to dirty data, the cached miss is dropped too
             auto pDbValue = db_util::MakeEmptyValue<ValueType>();
-            if (pDbAccess->GetData(PREFIX_TYPE, key, *pDbValue)) {
-                auto newRet = mapData.emplace(key, *pDbValue);
-                if (!newRet.second)
-                    throw runtime_error(strprintf("%s :  %s, alloc new cache item failed", __FUNCTION__, __LINE__));
-
-                return newRet.first;
+            bool found = readCache.Take(key, *pDbValue) ? !db_util::IsEmpty(*pDbValue)
+                                                        : pDbAccess->GetData(PREFIX_TYPE, key, *pDbValue);
+            if (found) {
+                return AddDataItem(key, *pDbValue);
             }
         }
 
         return mapData.end();
     }
 
+    static uint32_t GetDataItemSize(const KeyType &key, const ValueType &value) {
+        return ::GetSerializeSize(key, SER_DISK, CLIENT_VERSION) +
+               ::GetSerializeSize(value, SER_DISK, CLIENT_VERSION);
+    }
+
+    Iterator AddDataItem(const KeyType &key, const ValueType &value) const {
+        auto newRet = mapData.emplace(key, value);
+        if (!newRet.second)
+            throw runtime_error(strprintf("%s :  %s, alloc new cache item failed", __FUNCTION__, __LINE__));
+
+        dataSize += GetDataItemSize(key, value);
+        return newRet.first;
+    }
+
+    void UpdateDataItem(Iterator it, const ValueType &value) {
+        dataSize -= GetDataItemSize(it->first, it->second);
+        it->second = value;
+        dataSize += GetDataItemSize(it->first, it->second);
+    }
+
+    // set the dirty data directly without op log, the data overrides the read cache
+    void SetDataItem(const KeyType &key, const ValueType &value) {
+        Iterator it = mapData.find(key);
+        if (it != mapData.end()) {
+            UpdateDataItem(it, value);
+        } else {
+            readCache.Erase(key);
+            AddDataItem(key, value);
+        }
+    }
+
     bool GetTopNElements(const uint32_t maxNum, set<KeyType> &expiredKeys, set<KeyType> &keys) {
         if (!mapData.empty()) {
             uint32_t count = 0;
@@ -667,10 +1028,30 @@ private:
         }
 
     }
+
+    inline void AddAccessLog(const KeyType &key) const {
+        if (pDbOpLogMap != nullptr && pDbOpLogMap->IsTrackingAccess())
+            pDbOpLogMap->AddAccessKey(PREFIX_TYPE, dbk::GenDbKey(PREFIX_TYPE, key));
+    }
+
+    inline void AddAccessPrefixLog() const {
+        if (pDbOpLogMap != nullptr && pDbOpLogMap->IsTrackingAccess())
+            pDbOpLogMap->AddAccessPrefix(PREFIX_TYPE);
+    }
+
+    inline void AddRedoLog(const KeyType &key, const ValueType &newValue) {
+        if (pDbOpLogMap != nullptr && pDbOpLogMap->IsTrackingAccess()) {
+            CDbOpLog redoLog;
+            redoLog.Set(key, newValue);
+            pDbOpLogMap->AddRedoLog(PREFIX_TYPE, dbk::GenDbKey(PREFIX_TYPE, key), redoLog);
+        }
+    }
 private:
     mutable CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType> *pBase;
     CDBAccess *pDbAccess;
     mutable map<KeyType, ValueType> mapData;
+    mutable uint32_t dataSize = 0;
+    mutable CDBReadCache<KeyType, ValueType> readCache;
     CDBOpLogMap *pDbOpLogMap = nullptr;
 };
 
@@ -732,6 +1113,7 @@ public:
     }
 
     bool GetData(ValueType &value) const {
+        AddAccessLog();
         auto ptr = GetDataPtr();
         if (ptr && !db_util::IsEmpty(*ptr)) {
             value = *ptr;
@@ -741,24 +1123,31 @@ public:
     }
 
     bool SetData(const ValueType &value) {
-        if (!ptrData) {
-            ptrData = db_util::MakeEmptyValue<ValueType>();
+        auto ptr = GetDataPtr();
+        if (ptr) {
+            AddOpLog(*ptr);
+        } else {
+            AddOpLog(*db_util::MakeEmptyValue<ValueType>());
         }
-        AddOpLog(*ptrData);
-        *ptrData = value;
+        // the ptr may be shared with the base cache, so set a new value instead
+        ptrData = std::make_shared<ValueType>(value);
+        AddRedoLog(*ptrData);
         return true;
     }
 
     bool HaveData() const {
+        AddAccessLog();
         auto ptr = GetDataPtr();
         return ptr && !db_util::IsEmpty(*ptr);
     }
 
     bool EraseData() {
+        AddAccessLog();
         auto ptr = GetDataPtr();
         if (ptr && !db_util::IsEmpty(*ptr)) {
             AddOpLog(*ptr);
-            db_util::SetEmpty(*ptr);
+            ptrData = db_util::MakeEmptyValue<ValueType>();
+            AddRedoLog(*ptrData);
         }
         return true;
     }
@@ -770,6 +1159,7 @@ public:
     void Flush() {
         assert(pBase != nullptr || pDbAccess != nullptr);
         if (ptrData) {
+            AddAccessLog();
             if (pBase != nullptr) {
                 assert(pDbAccess == nullptr);
                 pBase->ptrData = ptrData;
@@ -788,14 +1178,22 @@ public:
         dbOpLog.Get(*ptrData);
     }
 
-    void UndoDataList(const CDbOpLogs &dbOpLogs) {
+    // with fKeepData only the first old value is set, and only if the value is not changed in this cache
+    void UndoDataList(const CDbOpLogs &dbOpLogs, bool fKeepData) {
+        if (fKeepData) {
+            if (!ptrData && !dbOpLogs.empty())
+                UndoData(dbOpLogs.front());
+            return;
+        }
+
         for (auto it = dbOpLogs.rbegin(); it != dbOpLogs.rend(); it++) {
             UndoData(*it);
         }
     }
 
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
-        undoDataFuncMap[GetPrefixType()] = std::bind(&CSimpleKVCache::UndoDataList, this, std::placeholders::_1);
+        undoDataFuncMap[GetPrefixType()] = std::bind(&CSimpleKVCache::UndoDataList, this, std::placeholders::_1,
+                                                     std::placeholders::_2);
     }
 
     dbk::PrefixType GetPrefixType() const { return PREFIX_TYPE; }
@@ -805,11 +1203,8 @@ private:
         if (ptrData) {
             return ptrData;
         } else if (pBase != nullptr){
-            auto ptr = pBase->GetDataPtr();
-            if (ptr) {
-                ptrData = std::make_shared<ValueType>(*ptr);
-                return ptrData;
-            }
+            // read through the base cache, the value is copied only when it is written
+            return pBase->GetDataPtr();
         } else if (pDbAccess != NULL) {
             auto ptrDbData = db_util::MakeEmptyValue<ValueType>();
 
@@ -830,6 +1225,20 @@ private:
         }
 
     }
+
+    // the db key of the single value is the prefix
+    inline void AddAccessLog() const {
+        if (pDbOpLogMap != nullptr && pDbOpLogMap->IsTrackingAccess())
+            pDbOpLogMap->AddAccessKey(PREFIX_TYPE, dbk::GetKeyPrefix(PREFIX_TYPE));
+    }
+
+    inline void AddRedoLog(const ValueType &newValue) {
+        if (pDbOpLogMap != nullptr && pDbOpLogMap->IsTrackingAccess()) {
+            CDbOpLog redoLog;
+            redoLog.Set(newValue);
+            pDbOpLogMap->AddRedoLog(PREFIX_TYPE, dbk::GetKeyPrefix(PREFIX_TYPE), redoLog);
+        }
+    }
 private:
     mutable CSimpleKVCache<PREFIX_TYPE, ValueType> *pBase;
     CDBAccess *pDbAccess;
@@ -14,27 +14,28 @@
 
 typedef leveldb::Slice Slice;
 
-#define DEF_DB_NAME_ENUM(enumType, enumName, cacheSize) enumType,
-#define DEF_DB_NAME_ARRAY(enumType, enumName, cacheSize) enumName,
-#define DEF_CACHE_SIZE_ARRAY(enumType, enumName, cacheSize) cacheSize,
+#define DEF_DB_NAME_ENUM(enumType, enumName, cacheSize, readCachePct) enumType,
+#define DEF_DB_NAME_ARRAY(enumType, enumName, cacheSize, readCachePct) enumName,
+#define DEF_CACHE_SIZE_ARRAY(enumType, enumName, cacheSize, readCachePct) cacheSize,
+#define DEF_READ_CACHE_PCT_ARRAY(enumType, enumName, cacheSize, readCachePct) readCachePct,
 
-//         DBNameType            DBName             DBCacheSize           description
-//         ----------           --------------    --------------     ----------------------------
+//         DBNameType            DBName             DBCacheSize     ReadCachePct     description
+//         ----------           --------------    --------------   ------------    ----------------------------
 #define DB_NAME_LIST(DEFINE) \
-    DEFINE( SYSPARAM,           "params",         (50 << 10) )      /* system params */ \
-    DEFINE( ACCOUNT,            "accounts",       (50 << 20) )      /* accounts & account assets */ \
-    DEFINE( ASSET,              "assets",         (100 << 10) )     /* asset registry */ \
-    DEFINE( BLOCK,              "blocks",         (500 << 10) )     /* block & tx indexes */ \
-    DEFINE( CONTRACT,           "contracts",      (50 << 20) )      /* contract */ \
-    DEFINE( DELEGATE,           "delegates",      (100 << 10) )     /* delegates */ \
-    DEFINE( CDP,                "cdps",           (50 << 20) )      /* cdp */ \
-    DEFINE( CLOSEDCDP,          "closedcdps",     (1  << 20) )      /* closed cdp */ \
-    DEFINE( DEX,                "dexes",          (50 << 20) )      /* dex */ \
-    DEFINE( LOG,                "logs",           (100 << 10) )     /* log */ \
-    DEFINE( RECEIPT,            "receipts",       (100 << 10) )     /* tx receipt */ \
+    DEFINE( SYSPARAM,           "params",         (50 << 10),      1  )      /* system params */ \
+    DEFINE( ACCOUNT,            "accounts",       (50 << 20),      35 )      /* accounts & account assets */ \
+    DEFINE( ASSET,              "assets",         (100 << 10),     1  )      /* asset registry */ \
+    DEFINE( BLOCK,              "blocks",         (500 << 10),     10 )      /* block & tx indexes */ \
+    DEFINE( CONTRACT,           "contracts",      (50 << 20),      25 )      /* contract */ \
+    DEFINE( DELEGATE,           "delegates",      (100 << 10),     2  )      /* delegates */ \
+    DEFINE( CDP,                "cdps",           (50 << 20),      10 )      /* cdp */ \
+    DEFINE( CLOSEDCDP,          "closedcdps",     (1  << 20),      1  )      /* closed cdp */ \
+    DEFINE( DEX,                "dexes",          (50 << 20),      12 )      /* dex */ \
+    DEFINE( LOG,                "logs",           (100 << 10),     1  )      /* log */ \
+    DEFINE( RECEIPT,            "receipts",       (100 << 10),     2  )      /* tx receipt */ \
     /*                                                                  */  \
     /* Add new Enum elements above, DB_NAME_COUNT Must be the last one */ \
-    DEFINE( DB_NAME_COUNT,        "",               0)                  /* enum count, must be the last one */
+    DEFINE( DB_NAME_COUNT,        "",               0,               0  )      /* enum count, must be the last one */
 
 enum DBNameType {
     DB_NAME_LIST(DEF_DB_NAME_ENUM)
@@ -47,6 +48,11 @@ static const int32_t DBCacheSize[DBNameType::DB_NAME_COUNT + 1] {
     DB_NAME_LIST(DEF_CACHE_SIZE_ARRAY)
 };
 
+// percentage of the -dbcache budget given to the clean read cache of each db, sums to 100
+static const int32_t DBReadCachePercent[DBNameType::DB_NAME_COUNT + 1] {
+    DB_NAME_LIST(DEF_READ_CACHE_PCT_ARRAY)
+};
+
 static const std::string kDbNames[DBNameType::DB_NAME_COUNT + 1] {
     DB_NAME_LIST(DEF_DB_NAME_ARRAY)
 };
@@ -89,6 +95,7 @@ namespace dbk {
         DEFINE( CONTRACT_ITEM_NUM,    "citn",   CONTRACT )      /* citn{$ContractRegId} --> $total_num_of_contract_i */ \
         DEFINE( CONTRACT_ACCOUNT,     "cacc",   CONTRACT )      /* cacc{$ContractRegId}{$AccUserId} --> appUserAccount */ \
         DEFINE( CONTRACT_TRACES,      "ctrs",   CONTRACT )      /* [prefix]{$txid} --> contract_traces */ \
+        DEFINE( CONTRACT_CODE_HASH,   "ccdh",   CONTRACT )      /* ccdh{$ContractRegId} --> $CodeHash */ \
         /**** delegate db                                                                      */ \
         DEFINE( VOTE,                 "vote",   DELEGATE )      /* "vote{(uint64t)MAX - $votedBcoins}{$RegId} --> 1 */ \
         DEFINE( LAST_VOTE_HEIGHT,     "lvht",   DELEGATE )      /* "[prefix] --> last_vote_height */ \
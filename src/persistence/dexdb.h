@@ -124,6 +124,14 @@ public:
         return true;
     }
 
+    void Clear() {
+        activeOrderCache.Clear();
+        blockOrdersCache.Clear();
+        operator_detail_cache.Clear();
+        operator_owner_map_cache.Clear();
+        operator_last_id_cache.Clear();
+    }
+
     uint32_t GetCacheSize() const {
         return activeOrderCache.GetCacheSize() +
             blockOrdersCache.GetCacheSize() +
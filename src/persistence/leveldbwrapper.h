@@ -106,12 +106,44 @@ public:
     void Clear() { mapDbOpLogs.clear(); }
 
     std::string ToString() const;
+
+    /**
+     * The access tracking is optional and not serialized. When it is enabled, the caches log the
+     * db keys they read, write or flush, and the new values they write as redo logs. The mempool
+     * uses it to find the txs depending on the state changed by a block, and to apply the writes
+     * of the other txs again without executing them.
+     */
+    void SetAccessTracking(bool fTrackAccessIn) { fTrackAccess = fTrackAccessIn; }
+    bool IsTrackingAccess() const { return fTrackAccess; }
+
+    void AddAccessKey(dbk::PrefixType prefixType, const string &dbKey) {
+        accessKeys[dbk::GetKeyPrefix(prefixType)].insert(dbKey);
+    }
+
+    // all the keys of the prefix are read, e.g. by a range scan
+    void AddAccessPrefix(dbk::PrefixType prefixType) { accessPrefixes.insert(dbk::GetKeyPrefix(prefixType)); }
+
+    // only the last written value of a key is kept
+    void AddRedoLog(dbk::PrefixType prefixType, const string &dbKey, const CDbOpLog &redoLog) {
+        AddAccessKey(prefixType, dbKey);
+        redoLogs[prefixType][dbKey] = redoLog;
+    }
+
+    // prefix -> db keys
+    const map<string, set<string>>& GetAccessKeys() const { return accessKeys; }
+    const set<string>& GetAccessPrefixes() const { return accessPrefixes; }
+    const map<dbk::PrefixType, map<string, CDbOpLog>>& GetRedoLogs() const { return redoLogs; }
 public:
     IMPLEMENT_SERIALIZE(
         READWRITE(mapDbOpLogs);
 	)
 private:
     mutable map<string, CDbOpLogs> mapDbOpLogs; // dbName -> dbOpLogs
+
+    bool fTrackAccess = false;
+    map<string, set<string>> accessKeys;
+    set<string> accessPrefixes;
+    map<dbk::PrefixType, map<string, CDbOpLog>> redoLogs;
 };
 
 class leveldb_error : public runtime_error
@@ -144,6 +176,15 @@ public:
         batch.Delete(key);
     }
 
+    // the value has been serialized
+    void WriteRaw(const std::string &key, const std::string &value) {
+        batch.Put(key, value);
+    }
+
+    void Clear() {
+        batch.Clear();
+    }
+
  };
 
 class CLevelDBWrapper {
@@ -236,6 +277,16 @@ public:
     leveldb::Iterator *NewIterator() {
         return pdb->NewIterator(iteroptions);
     }
+
+    // iterate the db as of the snapshot
+    leveldb::Iterator *NewIterator(const leveldb::Snapshot *pSnapshot) {
+        leveldb::ReadOptions options = iteroptions;
+        options.snapshot             = pSnapshot;
+        return pdb->NewIterator(options);
+    }
+
+    const leveldb::Snapshot *GetSnapshot() { return pdb->GetSnapshot(); }
+    void ReleaseSnapshot(const leveldb::Snapshot *pSnapshot) { pdb->ReleaseSnapshot(pSnapshot); }
     int64_t GetDbCount();
    // Object ToJsonObj();
 };
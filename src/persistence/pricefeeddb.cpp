@@ -138,8 +138,17 @@ void CPricePointMemCache::Flush() {
     pBase->BatchWrite(mapCoinPricePointCache);
     mapCoinPricePointCache.clear();
 
+    // keep the latest median price points, they are the same as the base cache after flushed
     pBase->latestBlockMedianPricePoints = latestBlockMedianPricePoints;
-    latestBlockMedianPricePoints.clear();
+}
+
+void CPricePointMemCache::Clear() {
+    mapCoinPricePointCache.clear();
+
+    if (pBase != nullptr)
+        latestBlockMedianPricePoints = pBase->latestBlockMedianPricePoints;
+    else
+        latestBlockMedianPricePoints.clear();
 }
 
 void CPricePointMemCache::Reset() {
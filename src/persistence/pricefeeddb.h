@@ -59,6 +59,7 @@ public:
 
     void SetBaseViewPtr(CPricePointMemCache *pBaseIn);
     void Flush();
+    void Clear();
     void Reset();
 
 private:
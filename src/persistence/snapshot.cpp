@@ -0,0 +1,487 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "snapshot.h"
+
+#include "crypto/hash.h"
+#include "main.h"
+
+#include <functional>
+
+// the dbs of the chain state, the block, log and receipt dbs are history of the local node
+static const DBNameType kSnapshotDbs[] = {SYSPARAM, ACCOUNT, ASSET, CONTRACT, DELEGATE, CDP, CLOSEDCDP, DEX};
+
+uint256 CSnapshotChunk::ComputeHash() const {
+    CHashWriter ss(SER_GETHASH, CLIENT_VERSION);
+    ss << type << dbType << count << data;
+    return ss.GetHash();
+}
+
+static CDBAccess *FindDb(const vector<CDBAccess *> &dbs, uint8_t dbType) {
+    for (auto pDb : dbs) {
+        if (pDb->GetDbNameType() == dbType)
+            return pDb;
+    }
+    return nullptr;
+}
+
+// the state dbs of the node in the order of dumping
+static vector<CDBAccess *> GetSnapshotDbs() {
+    vector<CDBAccess *> allDbs = pCdMan->GetDbAccesses();
+    vector<CDBAccess *> dbs;
+    for (auto dbType : kSnapshotDbs) {
+        CDBAccess *pDb = FindDb(allDbs, dbType);
+        assert(pDb != nullptr);
+        dbs.push_back(pDb);
+    }
+    return dbs;
+}
+
+// Collects the serialized items into the chunks of SNAPSHOT_CHUNK_SIZE
+class CSnapshotChunker {
+public:
+    typedef SnapshotChunkFunc ChunkFunc;
+
+    CSnapshotChunker(uint8_t typeIn, uint8_t dbTypeIn, const ChunkFunc &funcIn)
+        : type(typeIn), dbType(dbTypeIn), func(funcIn), ss(SER_DISK, CLIENT_VERSION) {}
+
+    template <typename T>
+    bool Add(const T &item) {
+        ss << item;
+        count++;
+        return ss.size() < SNAPSHOT_CHUNK_SIZE || Close();
+    }
+
+    void AddRaw(const leveldb::Slice &key, const leveldb::Slice &value) {
+        WriteCompactSize(ss, key.size());
+        ss.write(key.data(), key.size());
+        WriteCompactSize(ss, value.size());
+        ss.write(value.data(), value.size());
+        count++;
+    }
+
+    bool IsFull() const { return ss.size() >= SNAPSHOT_CHUNK_SIZE; }
+
+    // pass the pending items to the callback as a chunk
+    bool Close() {
+        if (count == 0)
+            return true;
+
+        CSnapshotChunk chunk;
+        chunk.type   = type;
+        chunk.dbType = dbType;
+        chunk.count  = count;
+        chunk.data.assign(ss.begin(), ss.end());
+        chunk.hash = chunk.ComputeHash();
+
+        ss.clear();
+        count = 0;
+        return func(chunk);
+    }
+
+private:
+    uint8_t type;
+    uint8_t dbType;
+    ChunkFunc func;
+    CDataStream ss;
+    uint32_t count = 0;
+};
+
+// Chunk the records of the db in the key order, the same records always produce the same chunks
+static bool ChunkDbRecords(CDBAccess *pDb, const leveldb::Snapshot *pSnapshot,
+                           const CSnapshotChunker::ChunkFunc &func) {
+    CSnapshotChunker chunker(SNAPSHOT_CHUNK_DB_RECORDS, pDb->GetDbNameType(), func);
+    auto pCursor = pSnapshot ? pDb->NewIterator(pSnapshot) : pDb->NewIterator();
+    for (pCursor->SeekToFirst(); pCursor->Valid(); pCursor->Next()) {
+        boost::this_thread::interruption_point();
+
+        chunker.AddRaw(pCursor->key(), pCursor->value());
+        if (chunker.IsFull() && !chunker.Close())
+            return false;
+    }
+
+    if (!pCursor->status().ok())
+        return ERRORMSG("%s, iterate db %s failed: %s", __func__, GetDbName(pDb->GetDbNameType()),
+                        pCursor->status().ToString());
+
+    return chunker.Close();
+}
+
+bool WriteSnapshotFile(const string &path, const vector<std::pair<CDBAccess *, const leveldb::Snapshot *>> &dbSnapshots,
+                       const SnapshotWriteFunc &writeFunc, CSnapshotInfo &info) {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return ERRORMSG("%s, open file %s failed", __func__, path);
+
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    CHashWriter stateHasher(SER_GETHASH, CLIENT_VERSION);
+    SnapshotChunkFunc writeChunk = [&](CSnapshotChunk &chunk) {
+        fileout << chunk;
+        info.chunks++;
+        if (chunk.type == SNAPSHOT_CHUNK_DB_RECORDS) {
+            stateHasher << chunk.hash;
+            info.records += chunk.count;
+        }
+        return true;
+    };
+
+    try {
+        fileout << info.header;
+
+        for (auto &item : dbSnapshots) {
+            if (!ChunkDbRecords(item.first, item.second, writeChunk))
+                return ERRORMSG("%s, dump db %s failed", __func__, GetDbName(item.first->GetDbNameType()));
+
+            LogPrint(BCLog::INFO, "%s, dumped db %s, records=%llu\n", __func__,
+                     GetDbName(item.first->GetDbNameType()), info.records);
+        }
+
+        if (writeFunc && !writeFunc(writeChunk))
+            return false;
+
+        info.stateCommitment = stateHasher.GetHash();
+
+        CSnapshotChunk endChunk;
+        endChunk.type = SNAPSHOT_CHUNK_END;
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << info.stateCommitment << info.chunks;
+        endChunk.data.assign(ss.begin(), ss.end());
+        endChunk.hash = endChunk.ComputeHash();
+        fileout << endChunk;
+
+        FileCommit(fileout);
+        info.fileSize = ftell(fileout);
+    } catch (std::exception &e) {
+        return ERRORMSG("%s, write file %s failed: %s", __func__, path, e.what());
+    }
+
+    return true;
+}
+
+bool ComputeStateCommitment(const vector<CDBAccess *> &dbs, uint256 &commitment) {
+    CHashWriter stateHasher(SER_GETHASH, CLIENT_VERSION);
+    auto hashChunk = [&stateHasher](CSnapshotChunk &chunk) {
+        stateHasher << chunk.hash;
+        return true;
+    };
+
+    for (auto pDb : dbs) {
+        if (!ChunkDbRecords(pDb, nullptr, hashChunk))
+            return false;
+    }
+
+    commitment = stateHasher.GetHash();
+    return true;
+}
+
+bool ReadSnapshotFile(const string &path, const vector<CDBAccess *> &dbs, const SnapshotHeaderFunc &headerFunc,
+                      const SnapshotChunkFunc &chunkFunc, CSnapshotInfo &info) {
+    CSnapshotHeader &header = info.header;
+    FILE *file              = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return ERRORMSG("%s, open file %s failed", __func__, path);
+
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    try {
+        filein >> header;
+        if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION)
+            return ERRORMSG("%s, %s is not a snapshot of version %d", __func__, path, SNAPSHOT_VERSION);
+
+        if (headerFunc && !headerFunc(header))
+            return false;
+
+        uint8_t lastType = 0;
+        uint256 stateCommitment;
+        while (true) {
+            boost::this_thread::interruption_point();
+
+            CSnapshotChunk chunk;
+            filein >> chunk;
+            if (chunk.hash != chunk.ComputeHash())
+                return ERRORMSG("%s, chunk %u is corrupted", __func__, info.chunks);
+
+            if (chunk.type < lastType)
+                return ERRORMSG("%s, chunk %u of type %d is out of order", __func__, info.chunks, chunk.type);
+
+            lastType = chunk.type;
+            if (chunk.type == SNAPSHOT_CHUNK_END) {
+                CDataStream ss(chunk.data.data(), chunk.data.data() + chunk.data.size(), SER_DISK, CLIENT_VERSION);
+                uint32_t chunkCount;
+                ss >> stateCommitment >> chunkCount;
+                if (chunkCount != info.chunks)
+                    return ERRORMSG("%s, %u chunks are loaded, but %u chunks are dumped", __func__, info.chunks,
+                                    chunkCount);
+                break;
+            }
+
+            info.chunks++;
+            if (chunk.type == SNAPSHOT_CHUNK_DB_RECORDS) {
+                CDBAccess *pDb = FindDb(dbs, chunk.dbType);
+                if (pDb == nullptr)
+                    return ERRORMSG("%s, unexpected db type %d", __func__, chunk.dbType);
+
+                CDataStream ss(chunk.data.data(), chunk.data.data() + chunk.data.size(), SER_DISK, CLIENT_VERSION);
+                CLevelDBBatch batch;
+                string key, value;
+                for (uint32_t i = 0; i < chunk.count; i++) {
+                    ss >> key >> value;
+                    batch.WriteRaw(key, value);
+                }
+                if (!pDb->WriteBatch(batch))
+                    return ERRORMSG("%s, write db %s failed", __func__, GetDbName(pDb->GetDbNameType()));
+
+                info.records += chunk.count;
+
+            } else if (!chunkFunc) {
+                return ERRORMSG("%s, unexpected chunk type %d", __func__, chunk.type);
+            } else if (!chunkFunc(chunk)) {
+                return false;
+            }
+
+            if (info.chunks % 100 == 0)
+                LogPrint(BCLog::INFO, "%s, loaded %u chunks, records=%llu\n", __func__, info.chunks, info.records);
+        }
+
+        // verify the written dbs against the state commitment of the dumping node
+        int64_t nStart = GetTimeMillis();
+        if (!ComputeStateCommitment(dbs, info.stateCommitment))
+            return ERRORMSG("%s, compute the state commitment failed", __func__);
+
+        if (info.stateCommitment != stateCommitment)
+            return ERRORMSG("%s, state commitment mismatch, loaded=%s, dumped=%s", __func__,
+                            info.stateCommitment.GetHex(), stateCommitment.GetHex());
+
+        LogPrint(BCLog::INFO, "%s, verified state commitment %s, %lldms\n", __func__, info.stateCommitment.GetHex(),
+                 GetTimeMillis() - nStart);
+    } catch (std::exception &e) {
+        return ERRORMSG("%s, read file %s failed: %s", __func__, path, e.what());
+    }
+
+    return true;
+}
+
+bool DumpStateSnapshot(const string &path, CSnapshotInfo &info) {
+    CSnapshotHeader &header = info.header;
+    vector<std::pair<CDBAccess *, const leveldb::Snapshot *>> dbSnapshots;
+    vector<CBlockIndex *> vIndexes;
+    {
+        LOCK(cs_main);
+        CBlockIndex *pTip = chainActive.Tip();
+        if (pTip == nullptr)
+            return ERRORMSG("%s, the chain is empty", __func__);
+
+        // write the state at the tip to the dbs, then the db snapshots keep it while the tip moves on
+        if (!pCdMan->Flush())
+            return ERRORMSG("%s, flush the state to db failed", __func__);
+
+        for (auto pDb : GetSnapshotDbs())
+            dbSnapshots.emplace_back(pDb, pDb->GetSnapshot());
+
+        header.netType      = SysCfg().NetworkID();
+        header.height       = pTip->height;
+        header.blockHash    = pTip->GetBlockHash();
+        header.blockTime    = pTip->nTime;
+        header.recentBlocks = std::min(std::max<int32_t>(SysCfg().GetTxCacheHeight(), BLOCK_REWARD_MATURITY) + 2,
+                                       pTip->height + 1);
+
+        std::pair<int32_t, uint256> finBlock;
+        if (pCdMan->pBlockCache->ReadGlobalFinBlock(finBlock)) {
+            header.finHeight    = finBlock.first;
+            header.finBlockHash = finBlock.second;
+        }
+
+        // the block indexes are never freed, their headers can be read without cs_main
+        vIndexes.reserve(pTip->height + 1);
+        for (int32_t height = 0; height <= pTip->height; height++)
+            vIndexes.push_back(chainActive[height]);
+    }
+
+    auto writeChain = [&](const SnapshotChunkFunc &writeChunk) {
+        // the blocks below the tip are loaded as headers, they are connected already
+        CSnapshotChunker headerChunker(SNAPSHOT_CHUNK_BLOCK_HEADERS, DB_NAME_NONE, writeChunk);
+        for (auto pIndex : vIndexes) {
+            boost::this_thread::interruption_point();
+
+            CDiskBlockIndex diskIndex(pIndex);
+            diskIndex.nStatus = BLOCK_VALID_SCRIPTS;
+            if (!headerChunker.Add(diskIndex))
+                return false;
+        }
+        if (!headerChunker.Close())
+            return false;
+        info.headers = vIndexes.size();
+
+        // the recent blocks are read when connecting the next blocks and loading the memory caches
+        CSnapshotChunker blockChunker(SNAPSHOT_CHUNK_BLOCKS, DB_NAME_NONE, writeChunk);
+        for (int32_t height = header.height - header.recentBlocks + 1; height <= header.height; height++) {
+            CBlock block;
+            if (!ReadBlockFromDisk(vIndexes[height], block))
+                return ERRORMSG("%s, read block %d from disk failed", __func__, height);
+
+            if (!blockChunker.Add(block))
+                return false;
+        }
+        if (!blockChunker.Close())
+            return false;
+        info.blocks = header.recentBlocks;
+        return true;
+    };
+
+    int64_t nStart = GetTimeMillis();
+    bool ret       = WriteSnapshotFile(path, dbSnapshots, writeChain, info);
+    for (auto &item : dbSnapshots)
+        item.first->ReleaseSnapshot(item.second);
+
+    if (!ret)
+        return false;
+
+    LogPrint(BCLog::INFO, "%s, dumped snapshot at %d:%s to %s, chunks=%u, records=%llu, commitment=%s, %lldms\n",
+             __func__, header.height, header.blockHash.GetHex(), path, info.chunks, info.records,
+             info.stateCommitment.GetHex(), GetTimeMillis() - nStart);
+    return true;
+}
+
+// Erase all the records of the db in batches
+template <typename DB>
+static bool EraseDbRecords(DB &db) {
+    CLevelDBBatch batch;
+    uint32_t count = 0;
+    std::shared_ptr<leveldb::Iterator> pCursor(db.NewIterator());
+    for (pCursor->SeekToFirst(); pCursor->Valid(); pCursor->Next()) {
+        batch.Erase(pCursor->key().ToString());
+        if (++count % 10000 == 0) {
+            if (!db.WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+    }
+    return db.WriteBatch(batch);
+}
+
+// The partly loaded or unverified state must not be left to the next start
+static void EraseLoadedState(const vector<CDBAccess *> &dbs) {
+    for (auto pDb : dbs) {
+        if (!EraseDbRecords(*pDb))
+            LogPrint(BCLog::ERROR, "%s, erase db %s failed\n", __func__, GetDbName(pDb->GetDbNameType()));
+    }
+    if (!EraseDbRecords(*pCdMan->pBlockIndexDb))
+        LogPrint(BCLog::ERROR, "%s, erase the block indexes failed\n", __func__);
+}
+
+bool LoadStateSnapshot(const string &path, CSnapshotInfo &info) {
+    const CSnapshotHeader &header = info.header;
+    vector<CDBAccess *> dbs       = GetSnapshotDbs();
+
+    // the block indexes of the recent blocks, they are written when the blocks are written
+    map<uint256, CDiskBlockIndex> recentIndexes;
+    int32_t recentHeight = 0;
+    int32_t nextHeight   = 0;
+    uint256 prevHash;
+
+    auto checkHeader = [&](const CSnapshotHeader &header) {
+        if (header.netType != SysCfg().NetworkID())
+            return ERRORMSG("%s, the snapshot is of another network", __func__);
+
+        if (header.height < 0 || header.recentBlocks <= 0 || header.recentBlocks > header.height + 1)
+            return ERRORMSG("%s, invalid snapshot header, height=%d, recent_blocks=%d", __func__, header.height,
+                            header.recentBlocks);
+
+        LogPrint(BCLog::INFO, "%s, loading snapshot at %d:%s from %s\n", __func__, header.height,
+                 header.blockHash.GetHex(), path);
+
+        recentHeight = header.height - header.recentBlocks + 1;
+        return true;
+    };
+
+    auto loadChain = [&](CSnapshotChunk &chunk) {
+        CDataStream ss(chunk.data.data(), chunk.data.data() + chunk.data.size(), SER_DISK, CLIENT_VERSION);
+        if (chunk.type == SNAPSHOT_CHUNK_BLOCK_HEADERS) {
+            CLevelDBBatch batch;
+            for (uint32_t i = 0; i < chunk.count; i++) {
+                CDiskBlockIndex diskIndex;
+                ss >> diskIndex;
+
+                // the headers are a chain from the genesis block to the tip
+                uint256 blockHash = diskIndex.GetBlockHash();
+                if (diskIndex.height != nextHeight || diskIndex.hashPrev != prevHash ||
+                    (nextHeight == 0 && blockHash != SysCfg().GetGenesisBlockHash()))
+                    return ERRORMSG("%s, unconnected block header at height %d", __func__, nextHeight);
+
+                diskIndex.nStatus = BLOCK_VALID_SCRIPTS;
+                if (diskIndex.height >= recentHeight)
+                    recentIndexes.emplace(blockHash, diskIndex);
+                else
+                    batch.Write(dbk::GenDbKey(dbk::BLOCK_INDEX, blockHash), diskIndex);
+
+                prevHash = blockHash;
+                nextHeight++;
+            }
+            if (!pCdMan->pBlockIndexDb->WriteBatch(batch, true))
+                return ERRORMSG("%s, write block indexes failed", __func__);
+
+            info.headers += chunk.count;
+
+        } else if (chunk.type == SNAPSHOT_CHUNK_BLOCKS) {
+            if (nextHeight != header.height + 1 || prevHash != header.blockHash)
+                return ERRORMSG("%s, the block headers don't end at the snapshot tip", __func__);
+
+            for (uint32_t i = 0; i < chunk.count; i++) {
+                CBlock block;
+                ss >> block;
+
+                auto it = recentIndexes.find(block.GetHash());
+                if (it == recentIndexes.end())
+                    return ERRORMSG("%s, unexpected block %s", __func__, block.GetHash().GetHex());
+
+                CValidationState state;
+                CDiskBlockPos blockPos;
+                uint32_t nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+                if (!FindBlockPos(state, blockPos, nBlockSize + 8, block.GetHeight(), block.GetTime()) ||
+                    !WriteBlockToDisk(block, blockPos))
+                    return ERRORMSG("%s, write block %d to disk failed", __func__, block.GetHeight());
+
+                CDiskBlockIndex &diskIndex = it->second;
+                diskIndex.nStatus |= BLOCK_HAVE_DATA;
+                diskIndex.nFile    = blockPos.nFile;
+                diskIndex.nDataPos = blockPos.nPos;
+                if (!pCdMan->pBlockIndexDb->WriteBlockIndex(diskIndex))
+                    return ERRORMSG("%s, write block index %d failed", __func__, block.GetHeight());
+
+                recentIndexes.erase(it);
+                info.blocks++;
+            }
+
+        } else {
+            return ERRORMSG("%s, unknown chunk type %d", __func__, chunk.type);
+        }
+        return true;
+    };
+
+    int64_t nStart = GetTimeMillis();
+    bool ret       = ReadSnapshotFile(path, dbs, checkHeader, loadChain, info);
+    if (ret && nextHeight != header.height + 1) {
+        ret = ERRORMSG("%s, the block headers don't end at the snapshot tip", __func__);
+    } else if (ret && !recentIndexes.empty()) {
+        ret = ERRORMSG("%s, %u recent blocks are missing", __func__, recentIndexes.size());
+    }
+
+    if (ret) {
+        // the tip of the loaded chain is written only after the state is verified, no tx index is loaded
+        pCdMan->pBlockCache->SetBestBlock(header.blockHash);
+        pCdMan->pBlockCache->WriteFlag("txindex", false);
+        if (!header.finBlockHash.IsNull())
+            pCdMan->pBlockCache->WriteGlobalFinBlock(header.finHeight, header.finBlockHash);
+        if (!pCdMan->pBlockCache->Flush())
+            ret = ERRORMSG("%s, write the best block failed", __func__);
+    }
+
+    if (!ret) {
+        EraseLoadedState(dbs);
+        return false;
+    }
+
+    LogPrint(BCLog::INFO, "%s, loaded %u chunks, records=%llu, headers=%u, blocks=%u, %lldms\n", __func__,
+             info.chunks, info.records, info.headers, info.blocks, GetTimeMillis() - nStart);
+    return true;
+}
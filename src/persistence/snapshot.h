@@ -0,0 +1,117 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_SNAPSHOT_H
+#define PERSIST_SNAPSHOT_H
+
+#include "commons/serialize.h"
+#include "commons/uint256.h"
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+class CDBAccess;
+namespace leveldb {
+class Snapshot;
+}
+
+static const uint32_t SNAPSHOT_MAGIC   = 0x50534357;  // "WCSP"
+static const int32_t SNAPSHOT_VERSION  = 1;
+/** A chunk is closed once its data reaches the size */
+static const uint32_t SNAPSHOT_CHUNK_SIZE = 4 << 20;
+
+enum SnapshotChunkType : uint8_t {
+    SNAPSHOT_CHUNK_DB_RECORDS    = 1,  // the raw key-values of a state db
+    SNAPSHOT_CHUNK_BLOCK_HEADERS = 2,  // the block indexes of the active chain from genesis
+    SNAPSHOT_CHUNK_BLOCKS        = 3,  // the full blocks at the tip
+    SNAPSHOT_CHUNK_END           = 0xFF
+};
+
+class CSnapshotHeader {
+public:
+    uint32_t magic       = SNAPSHOT_MAGIC;
+    int32_t version      = SNAPSHOT_VERSION;
+    uint8_t netType      = 0;
+    int32_t height       = 0;  // the tip of the state
+    uint256 blockHash;
+    uint32_t blockTime   = 0;
+    int32_t recentBlocks = 0;  // the number of the full blocks at the tip
+    int32_t finHeight    = 0;  // the global finality block
+    uint256 finBlockHash;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(magic);
+        READWRITE(version);
+        READWRITE(netType);
+        READWRITE(height);
+        READWRITE(blockHash);
+        READWRITE(blockTime);
+        READWRITE(recentBlocks);
+        READWRITE(finHeight);
+        READWRITE(finBlockHash);)
+};
+
+/**
+ * The file is the header followed by the chunks, every chunk carries the hash of its content so it is
+ * checked once it is read. The db records are iterated in the key order and chunked by the size, so
+ * the same state always produces the same chunks, the state commitment is the hash of their hashes.
+ */
+class CSnapshotChunk {
+public:
+    uint8_t type   = 0;
+    uint8_t dbType = 0;  // DBNameType of the db records
+    uint32_t count = 0;  // the number of the items in data
+    std::string data;    // the serialized items
+    uint256 hash;
+
+    uint256 ComputeHash() const;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(type);
+        READWRITE(dbType);
+        READWRITE(count);
+        READWRITE(data);
+        READWRITE(hash);)
+};
+
+struct CSnapshotInfo {
+    CSnapshotHeader header;
+    uint256 stateCommitment;
+    uint32_t chunks   = 0;
+    uint64_t records  = 0;
+    uint32_t headers  = 0;
+    uint32_t blocks   = 0;
+    uint64_t fileSize = 0;
+};
+
+typedef std::function<bool(CSnapshotChunk &chunk)> SnapshotChunkFunc;
+typedef std::function<bool(const SnapshotChunkFunc &writeChunk)> SnapshotWriteFunc;
+typedef std::function<bool(const CSnapshotHeader &header)> SnapshotHeaderFunc;
+
+// Write info.header, the records of the dbs and the chunks given by writeFunc to the file, then the
+// end chunk with the state commitment of the db records.
+bool WriteSnapshotFile(const std::string &path,
+                       const std::vector<std::pair<CDBAccess *, const leveldb::Snapshot *>> &dbSnapshots,
+                       const SnapshotWriteFunc &writeFunc, CSnapshotInfo &info);
+
+// Read the file, the db records are written to the dbs of their types and the other chunks are passed to
+// chunkFunc. It fails unless the dbs match the state commitment at the end of the file.
+bool ReadSnapshotFile(const std::string &path, const std::vector<CDBAccess *> &dbs,
+                      const SnapshotHeaderFunc &headerFunc, const SnapshotChunkFunc &chunkFunc, CSnapshotInfo &info);
+
+// Hash the records of the dbs as they are chunked by WriteSnapshotFile
+bool ComputeStateCommitment(const std::vector<CDBAccess *> &dbs, uint256 &commitment);
+
+// Dump the state dbs, the block indexes of the active chain and the recent full blocks at the tip.
+// cs_main is only held to take the db snapshots at the tip.
+bool DumpStateSnapshot(const std::string &path, CSnapshotInfo &info);
+
+// Load the snapshot into the empty dbs and block files before loading the block index, the blocks
+// below the tip are known by their headers only. The best block is written after the state commitment
+// is verified, the loaded data is erased on failure.
+bool LoadStateSnapshot(const std::string &path, CSnapshotInfo &info);
+
+#endif  // PERSIST_SNAPSHOT_H
@@ -38,6 +38,8 @@ public:
         return true;
     }
 
+    void Clear() { sysParamCache.Clear(); }
+
     uint32_t GetCacheSize() const { return sysParamCache.GetCacheSize(); }
 
     void SetBaseViewPtr(CSysParamDBCache *pBaseIn) { sysParamCache.SetBase(&pBaseIn->sysParamCache); }
@@ -21,3 +21,5 @@ bool CTxReceiptDBCache::GetTxReceipts(const TxID &txid, vector<CReceipt> &receip
 }
 
 void CTxReceiptDBCache::Flush() { txReceiptCache.Flush(); }
+
+void CTxReceiptDBCache::Clear() { txReceiptCache.Clear(); }
@@ -28,6 +28,7 @@ public:
     bool GetTxReceipts(const TxID &txid, vector<CReceipt> &receipts);
 
     void Flush();
+    void Clear();
 
     uint32_t GetCacheSize() const { return txReceiptCache.GetCacheSize(); }
 
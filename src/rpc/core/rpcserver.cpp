@@ -258,11 +258,16 @@ static const CRPCCommand vRPCCommands[] =
     { "getblockcount",          &getblockcount,          true,      true,       false },
     { "getblock",               &getblock,               true,      false,      false },
     { "getrawmempool",          &getrawmempool,          true,      false,      false },
+    { "getmempoolinfo",         &getmempoolinfo,         true,      false,      false },
+    { "getblockpipelineinfo",   &getblockpipelineinfo,   true,      false,      false },
+    { "gettxadmissioninfo",     &gettxadmissioninfo,     true,      true,       false },
     { "verifychain",            &verifychain,            true,      false,      false },
+    { "dumpsnapshot",           &dumpsnapshot,           true,      true,       false },
 
     { "gettotalcoins",          &gettotalcoins,          true,      false,      false },
     { "invalidateblock",        &invalidateblock,        true,      true,       false },
     { "reconsiderblock",        &reconsiderblock,        true,      true,       false },
+    { "getdbcacheinfo",         &getdbcacheinfo,         true,      false,      false },
 
     /* Mining */
     { "getmininginfo",          &getmininginfo,          true,      false,      false },
@@ -314,7 +319,7 @@ static const CRPCCommand vRPCCommands[] =
     { "decodemulsigscript",     &decodemulsigscript,     true,      false,      false },
 
     /* submit raw tx */
-    { "submittxraw",            &submittxraw,            true,      false,      false },
+    { "submittxraw",            &submittxraw,            true,      true,       false },
 
     /* basic tx */
     { "submitsendtx",           &submitsendtx,           false,     false,      true },
@@ -369,6 +374,7 @@ static const CRPCCommand vRPCCommands[] =
     { "getcodewasm",                &getcodewasm,       true,      false,      true },
     { "getabiwasm",                 &getabiwasm,        true,      false,      true },
     { "gettxtrace",                 &gettxtrace,        true,      false,      true },
+    { "getwasmcacheinfo",           &getwasmcacheinfo,  true,      true,       false },
 
     /* for test code */
     { "disconnectblock",        &disconnectblock,        true,      false,      true },
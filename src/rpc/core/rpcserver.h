@@ -160,14 +160,19 @@ extern json_spirit::Value getfcoingenesistxinfo(const json_spirit::Array& params
 extern json_spirit::Value getblockcount(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getdifficulty(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getrawmempool(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getmempoolinfo(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getblockpipelineinfo(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value gettxadmissioninfo(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getblock(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value verifychain(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value dumpsnapshot(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getcontractregid(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value invalidateblock(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value reconsiderblock(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value startcommontpstest(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value startcontracttpstest(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getblockfailures(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getdbcacheinfo(const json_spirit::Array& params, bool fHelp);
 
 extern json_spirit::Value submitpricefeedtx(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value submitcoinstaketx(const json_spirit::Array& params, bool fHelp);
@@ -208,6 +213,7 @@ extern json_spirit::Value bintojsonwasm(const json_spirit::Array& params, bool f
 extern json_spirit::Value getcodewasm(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getabiwasm(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value gettxtrace(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getwasmcacheinfo(const json_spirit::Array& params, bool fHelp);
 
 json_spirit::Object JSONRPCExecOne(const json_spirit::Value& req);
 
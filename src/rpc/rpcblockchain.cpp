@@ -13,6 +13,8 @@
 #include "init.h"
 #include "commons/json/json_spirit_value.h"
 #include "main.h"
+#include "persistence/snapshot.h"
+#include "rpc/core/rpccommons.h"
 #include "rpc/core/rpcserver.h"
 #include "sync.h"
 #include "tx/merkletx.h"
@@ -109,13 +111,15 @@ Value getfcoingenesistxinfo(const Array& params, bool fHelp) {
 
 Value getrawmempool(const Array& params, bool fHelp)
 {
-    if (fHelp || params.size() > 1)
+    if (fHelp || params.size() > 2)
         throw runtime_error(
-            "getrawmempool ( verbose )\n"
+            "getrawmempool ( verbose \"addr\" )\n"
             "\nReturns all transaction ids in memory pool as a json or an array of string transaction ids.\n"
             "\nArguments:\n"
             "1. verbose           (boolean, optional, default=false) true for a json object, false for array of "
             "transaction ids\n"
+            "2. \"addr\"            (string, optional) only the transactions sent by the account of the address, "
+            "regid or nickname\n"
             "\nResult: (for verbose = false):\n"
             "[                     (json array of string)\n"
             "  \"txid\"     (string) The transaction id\n"
@@ -139,12 +143,26 @@ Value getrawmempool(const Array& params, bool fHelp)
     if (params.size() > 0)
         fVerbose = params[0].get_bool();
 
+    vector<uint256> txids;
+    if (params.size() > 1) {
+        CKeyID keyId;
+        if (!GetKeyId(params[1].get_str(), keyId))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+
+        mempool.QuerySenderTxs(keyId, txids);
+    } else {
+        mempool.QueryHash(txids);
+    }
+
     if (fVerbose) {
         LOCK(mempool.cs);
         Object obj;
-        for (const auto& entry : mempool.memPoolTxs) {
-            const uint256& hash      = entry.first;
-            const CTxMemPoolEntry& e = entry.second;
+        for (const auto& hash : txids) {
+            auto it = mempool.memPoolTxs.find(hash);
+            if (it == mempool.memPoolTxs.end())
+                continue;
+
+            const CTxMemPoolEntry& e = it->second;
             Object info;
             info.push_back(Pair("size",         (int)e.GetTxSize()));
             info.push_back(Pair("fees_type",    std::get<0>(e.GetFees())));
@@ -157,9 +175,6 @@ Value getrawmempool(const Array& params, bool fHelp)
         }
         return obj;
     } else {
-        vector<uint256> txids;
-        mempool.QueryHash(txids);
-
         Array arr;
         for (const auto& hash : txids) {
             arr.push_back(hash.ToString());
@@ -169,6 +184,124 @@ Value getrawmempool(const Array& params, bool fHelp)
     }
 }
 
+Value getblockpipelineinfo(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 0) {
+        throw runtime_error(
+            "getblockpipelineinfo\n"
+            "\nGet the queue depths and the timing of the stages processing the blocks received from peers.\n"
+            "\nArguments:\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"started\" : true|false,         (boolean) whether the blocks are checked ahead of connecting\n"
+            "  \"check_queue_depth\" : n,        (numeric) the blocks waiting to be checked\n"
+            "  \"connect_queue_depth\" : n,      (numeric) the blocks waiting to be connected\n"
+            "  \"checked_blocks\" : n,           (numeric) the blocks decoded and checked\n"
+            "  \"checked_signatures\" : n,       (numeric) the signatures verified ahead of connecting\n"
+            "  \"check_time_ms\" : n,            (numeric) the total time of checking\n"
+            "  \"connected_blocks\" : n,         (numeric) the blocks processed by the connect stage\n"
+            "  \"connect_wait_time_ms\" : n,     (numeric) the total time of the checked blocks waiting to be connected\n"
+            "  \"connect_time_ms\" : n           (numeric) the total time of connecting\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getblockpipelineinfo", "") +
+            "\nAs json rpc call\n" +
+            HelpExampleRpc("getblockpipelineinfo", ""));
+    }
+
+    CBlockPipelineStats stats = blockPipeline.GetStats();
+
+    Object obj;
+    obj.push_back(Pair("started",               blockPipeline.IsStarted()));
+    obj.push_back(Pair("check_queue_depth",     (int64_t)stats.checkQueueDepth));
+    obj.push_back(Pair("connect_queue_depth",   (int64_t)stats.connectQueueDepth));
+    obj.push_back(Pair("checked_blocks",        (int64_t)stats.checkedBlocks));
+    obj.push_back(Pair("checked_signatures",    (int64_t)stats.checkedSignatures));
+    obj.push_back(Pair("check_time_ms",         stats.checkTime / 1000));
+    obj.push_back(Pair("connected_blocks",      (int64_t)stats.connectedBlocks));
+    obj.push_back(Pair("connect_wait_time_ms",  stats.connectWaitTime / 1000));
+    obj.push_back(Pair("connect_time_ms",       stats.connectTime / 1000));
+
+    return obj;
+}
+
+Value gettxadmissioninfo(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 0) {
+        throw runtime_error(
+            "gettxadmissioninfo\n"
+            "\nGet the queue depths and the timing of the stages admitting the txs to the memory pool.\n"
+            "\nArguments:\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"started\" : true|false,         (boolean) whether the txs are checked ahead and accepted in batches\n"
+            "  \"check_queue_depth\" : n,        (numeric) the txs waiting to be checked\n"
+            "  \"accept_queue_depth\" : n,       (numeric) the txs waiting to be accepted\n"
+            "  \"dropped_txs\" : n,              (numeric) the txs from peers dropped since the queue is full\n"
+            "  \"checked_txs\" : n,              (numeric) the txs decoded and checked\n"
+            "  \"checked_signatures\" : n,       (numeric) the signatures verified ahead of accepting\n"
+            "  \"check_time_ms\" : n,            (numeric) the total time of checking\n"
+            "  \"accept_batches\" : n,           (numeric) the batches accepted with one cs_main acquisition\n"
+            "  \"accepted_txs\" : n,             (numeric) the txs accepted to the memory pool\n"
+            "  \"rejected_txs\" : n,             (numeric) the txs rejected by the memory pool\n"
+            "  \"accept_time_ms\" : n            (numeric) the total time of holding cs_main to accept\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("gettxadmissioninfo", "") +
+            "\nAs json rpc call\n" +
+            HelpExampleRpc("gettxadmissioninfo", ""));
+    }
+
+    CTxAdmissionStats stats = txAdmission.GetStats();
+
+    Object obj;
+    obj.push_back(Pair("started",               txAdmission.IsStarted()));
+    obj.push_back(Pair("check_queue_depth",     (int64_t)stats.checkQueueDepth));
+    obj.push_back(Pair("accept_queue_depth",    (int64_t)stats.acceptQueueDepth));
+    obj.push_back(Pair("dropped_txs",           (int64_t)stats.droppedTxs));
+    obj.push_back(Pair("checked_txs",           (int64_t)stats.checkedTxs));
+    obj.push_back(Pair("checked_signatures",    (int64_t)stats.checkedSignatures));
+    obj.push_back(Pair("check_time_ms",         stats.checkTime / 1000));
+    obj.push_back(Pair("accept_batches",        (int64_t)stats.acceptBatches));
+    obj.push_back(Pair("accepted_txs",          (int64_t)stats.acceptedTxs));
+    obj.push_back(Pair("rejected_txs",          (int64_t)stats.rejectedTxs));
+    obj.push_back(Pair("accept_time_ms",        stats.acceptTime / 1000));
+
+    return obj;
+}
+
+Value getmempoolinfo(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 0) {
+        throw runtime_error(
+            "getmempoolinfo\n"
+            "\nGet the size of the memory pool and the tx counts of its rescans after the tip changed.\n"
+            "\nArguments:\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"size\" : n,                (numeric) the tx count\n"
+            "  \"bytes\" : n,               (numeric) the total tx size\n"
+            "  \"last_rechecked\" : n,      (numeric) the txs executed again by the last rescan\n"
+            "  \"last_skipped\" : n,        (numeric) the txs not depending on the changed state in the last rescan\n"
+            "  \"total_rechecked\" : n,     (numeric) the txs executed again by all rescans\n"
+            "  \"total_skipped\" : n        (numeric) the txs skipped by all rescans\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getmempoolinfo", "") +
+            "\nAs json rpc call\n" +
+            HelpExampleRpc("getmempoolinfo", ""));
+    }
+
+    LOCK(mempool.cs);
+
+    Object obj;
+    obj.push_back(Pair("size",              (int64_t)mempool.memPoolTxs.size()));
+    obj.push_back(Pair("bytes",             (int64_t)mempool.GetTotalTxSize()));
+    obj.push_back(Pair("last_rechecked",    (int64_t)mempool.GetLastRecheckedCount()));
+    obj.push_back(Pair("last_skipped",      (int64_t)mempool.GetLastSkippedCount()));
+    obj.push_back(Pair("total_rechecked",   (int64_t)mempool.GetTotalRecheckedCount()));
+    obj.push_back(Pair("total_skipped",     (int64_t)mempool.GetTotalSkippedCount()));
+
+    return obj;
+}
+
 Value getblock(const Array& params, bool fHelp) {
     if (fHelp || params.size() < 1 || params.size() > 2) {
         throw runtime_error(
@@ -268,6 +401,46 @@ Value verifychain(const Array& params, bool fHelp) {
     return VerifyDB(nCheckLevel, nCheckDepth);
 }
 
+Value dumpsnapshot(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 1) {
+        throw runtime_error(
+            "dumpsnapshot \"file\"\n"
+            "\nDump the chain state at the tip to the file, a new node loads it by -loadsnapshot=<file>.\n"
+            "\nArguments:\n"
+            "1.\"file\"   (string, required) The snapshot file path\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"height\" : n,               (numeric) the tip height of the state\n"
+            "  \"hash\" : \"hash\",            (string) the tip block hash of the state\n"
+            "  \"state_commitment\" : \"hash\",(string) the hash of the state records, verified when loading\n"
+            "  \"chunks\" : n,               (numeric) the chunks in the file\n"
+            "  \"records\" : n,              (numeric) the db records\n"
+            "  \"headers\" : n,              (numeric) the block headers\n"
+            "  \"blocks\" : n,               (numeric) the full blocks at the tip\n"
+            "  \"file_size\" : n             (numeric) the file size in bytes\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("dumpsnapshot", "\"/tmp/coin.snapshot\"") + "\nAs json rpc\n" +
+            HelpExampleRpc("dumpsnapshot", "\"/tmp/coin.snapshot\""));
+    }
+
+    CSnapshotInfo info;
+    if (!DumpStateSnapshot(params[0].get_str(), info))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to dump the state snapshot, see debug.log for details");
+
+    Object obj;
+    obj.push_back(Pair("height",            info.header.height));
+    obj.push_back(Pair("hash",              info.header.blockHash.GetHex()));
+    obj.push_back(Pair("state_commitment",  info.stateCommitment.GetHex()));
+    obj.push_back(Pair("chunks",            (int64_t)info.chunks));
+    obj.push_back(Pair("records",           (int64_t)info.records));
+    obj.push_back(Pair("headers",           (int64_t)info.headers));
+    obj.push_back(Pair("blocks",            (int64_t)info.blocks));
+    obj.push_back(Pair("file_size",         (int64_t)info.fileSize));
+
+    return obj;
+}
+
 Value getcontractregid(const Array& params, bool fHelp) {
     if (fHelp || params.size() != 1) {
         throw runtime_error(
@@ -453,6 +626,11 @@ void static CommonTxSender() {
         boost::this_thread::interruption_point();
 
         if (generationQueue.get()->Pop(&tx)) {
+            if (txAdmission.IsStarted()) {
+                txAdmission.Submit(tx.GetNewInstance());
+                continue;
+            }
+
             LOCK(cs_main);
             if (!::AcceptToMemoryPool(mempool, state, (CBaseTx*)&tx, true)) {
                 LogPrint(BCLog::ERROR, "CommonTxSender, accept to mempool failed: %s\n", state.GetRejectReason());
@@ -595,6 +773,11 @@ void static ContractTxGenerator() {
         boost::this_thread::interruption_point();
 
         if (generationContractQueue.get()->Pop(&tx)) {
+            if (txAdmission.IsStarted()) {
+                txAdmission.Submit(tx.GetNewInstance());
+                continue;
+            }
+
             LOCK(cs_main);
             if (!::AcceptToMemoryPool(mempool, state, (CBaseTx*)&tx, true)) {
                 LogPrint(BCLog::ERROR, "ContractTxGenerator, accept to mempool failed: %s\n", state.GetRejectReason());
@@ -711,3 +894,61 @@ Value getblockfailures(const Array& params, bool fHelp) {
 
     return obj;
 }
+
+Value getdbcacheinfo(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 0) {
+        throw runtime_error(
+            "getdbcacheinfo\n"
+            "\nGet the read cache usage and the lookup statistics of the db caches and the signature cache.\n"
+            "\nArguments:\n"
+            "\nResult:\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getdbcacheinfo", "") +
+            "\nAs json rpc call\n" +
+            HelpExampleRpc("getdbcacheinfo", ""));
+    }
+
+    LOCK(cs_main);
+
+    Object obj;
+    for (auto pDb : pCdMan->GetDbAccesses()) {
+        Object dbObj;
+        dbObj.push_back(Pair("read_cache_limit",    pDb->GetReadCacheLimit()));
+        dbObj.push_back(Pair("read_cache_usage",    pDb->GetReadCacheUsage()));
+
+        Object prefixesObj;
+        for (int32_t i = dbk::EMPTY + 1; i < dbk::PREFIX_COUNT; i++) {
+            dbk::PrefixType prefixType = (dbk::PrefixType)i;
+            if (dbk::GetDbNameEnumByPrefix(prefixType) != pDb->GetDbNameType())
+                continue;
+
+            const CDBLookupStat &stat = pDb->GetLookupStat(prefixType);
+            const CDBKeyFilter *pKeyFilter = pDb->GetKeyFilter(prefixType);
+            if (stat.IsEmpty() && pKeyFilter == nullptr)
+                continue;
+
+            Object statObj;
+            statObj.push_back(Pair("read_cache_hits",   (int64_t)stat.readCacheHits));
+            statObj.push_back(Pair("negative_hits",     (int64_t)stat.negativeHits));
+            statObj.push_back(Pair("filter_misses",     (int64_t)stat.filterMisses));
+            statObj.push_back(Pair("db_hits",           (int64_t)stat.dbHits));
+            statObj.push_back(Pair("db_misses",         (int64_t)stat.dbMisses));
+            if (pKeyFilter != nullptr) {
+                statObj.push_back(Pair("key_filter_keys",   (int64_t)pKeyFilter->GetKeyCount()));
+                statObj.push_back(Pair("key_filter_memory", (int64_t)pKeyFilter->GetMemorySize()));
+            }
+            prefixesObj.push_back(Pair(dbk::GetKeyPrefix(prefixType), statObj));
+        }
+        dbObj.push_back(Pair("prefixes", prefixesObj));
+
+        obj.push_back(Pair(GetDbName(pDb->GetDbNameType()), dbObj));
+    }
+
+    Object sigCacheObj;
+    sigCacheObj.push_back(Pair("memory",    (int64_t)signatureCache.GetMemorySize()));
+    sigCacheObj.push_back(Pair("hits",      (int64_t)signatureCache.GetHits()));
+    sigCacheObj.push_back(Pair("misses",    (int64_t)signatureCache.GetMisses()));
+    obj.push_back(Pair("signature_cache", sigCacheObj));
+
+    return obj;
+}
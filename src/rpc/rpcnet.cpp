@@ -388,12 +388,15 @@ Value getchaininfo(const Array& params, bool fHelp) {
             "    \"fuel\": n,           (numeric) The fuel consumed in the block\n"
             "    \"fuel_rate\":n,       (numeric) The fuel rate in the block\n"
             "    \"miner\": n,          (string) The miner\n"
+            "    \"assumed_valid\": b,  (bool) Whether the block is an ancestor of the -assumevalid block, whose signatures are not verified\n"
             "  },\n"
             "  ...\n"
             "]\n"
             "\nExamples:\n" +
             HelpExampleCli("getchaininfo", "5") + "\nAs json rpc call\n" + HelpExampleRpc("getchaininfo", "5"));
 
+    LOCK(cs_main);
+
     int32_t count = params[0].get_int();
     int32_t height = chainActive.Height();
     if (params.size() > 1) {
@@ -423,6 +426,7 @@ Value getchaininfo(const Array& params, bool fHelp) {
         if (ReadBlockFromDisk(pBlockIndex, block)) {
             object.push_back(Pair("miner",  block.vptx[0]->txUid.ToString()));
         }
+        object.push_back(Pair("assumed_valid", IsBlockAssumedValid(pBlockIndex->GetBlockHash(), pBlockIndex->height)));
 
         array.push_back(object);
 
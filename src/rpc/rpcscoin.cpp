@@ -325,14 +325,20 @@ Value getscoininfo(const Array& params, bool fHelp){
 
     bool global_collateral_ceiling_reached = globalStakedBcoins >= globalCollateralCeiling * COIN;
 
-    RatioCDPIdCache::Map forceLiquidateCdps;
     uint64_t forceLiquidateRatio = 0;
     if (!pCdMan->pSysParamCache->GetParam(SysParamType::CDP_FORCE_LIQUIDATE_RATIO, forceLiquidateRatio)) {
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Acquire cdp force liquidate ratio error");
     }
 
-    pCdMan->pCdpCache->GetCdpListByCollateralRatio(forceLiquidateRatio, bcoinMedianPrice,
-                                                               forceLiquidateCdps);
+    // count the keys only, the cdps are not read
+    uint64_t forceLiquidateCdpAmount = 0;
+    CCdpRatioCursor cursor(*pCdMan->pCdpCache, forceLiquidateRatio, bcoinMedianPrice);
+    if (cursor.IsFailed())
+        throw JSONRPCError(RPC_DATABASE_ERROR, "load cdp ratio index failed");
+
+    for (; cursor.IsValid(); cursor.Next()) {
+        ++forceLiquidateCdpAmount;
+    }
 
     Object obj;
     Array prices;
@@ -363,7 +369,7 @@ Value getscoininfo(const Array& params, bool fHelp){
     obj.push_back(Pair("global_collateral_ratio_floor_reached", globalCollateralRatioFloorReached));
 
     obj.push_back(Pair("force_liquidate_ratio",                 strprintf("%.2f%%", (double)forceLiquidateRatio / RATIO_BOOST * 100)));
-    obj.push_back(Pair("force_liquidate_cdp_amount",            forceLiquidateCdps.size()));
+    obj.push_back(Pair("force_liquidate_cdp_amount",            forceLiquidateCdpAmount));
 
     return obj;
 }
@@ -963,6 +963,10 @@ Value submittxraw(const Array& params, bool fHelp) {
 
     std::shared_ptr<CBaseTx> tx;
     stream >> tx;
+
+    // verify the signature before taking cs_main, AcceptToMemoryPool() will find it in the signature cache
+    CTxAdmissionQueue::PreVerifySignatures({tx});
+
     std::tuple<bool, string> ret;
     ret = pWalletMain->CommitTx((CBaseTx *) tx.get());
     if (!std::get<0>(ret))
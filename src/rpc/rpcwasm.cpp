@@ -147,6 +147,21 @@ void get_contract( CAccountDBCache*   database_account,
     //JSON_RPC_ASSERT(contract_store.code.size() > 0,                                 RPC_WALLET_ERROR,  "contract lose code")
 }
 
+// the abi serializer of the native or deployed contract, parsed abis are shared from the cache
+std::shared_ptr<const wasm::abi_serializer> get_abi_serializer( CAccountDBCache*  database_account,
+                                                                CContractDBCache* database_contract,
+                                                                const wasm::name& contract_name ){
+
+    std::vector<char> abi;
+    if(get_native_contract_abi(contract_name.value, abi))
+        return wasm::abi_serializer::get_serializer(abi, max_serialization_time);
+
+    CAccount           contract;
+    CUniversalContract contract_store;
+    get_contract(database_account, database_contract, contract_name, contract, contract_store );
+    return wasm::abi_serializer::get_serializer(contract_store.abi, max_serialization_time);
+}
+
 // set code and abi
 Value submitwasmcontractdeploytx( const Array &params, bool fHelp ) {
 
@@ -214,14 +229,8 @@ Value submitwasmcontractcalltx( const Array &params, bool fHelp ) {
         auto wallet            = pWalletMain;
 
         //get abi
-        std::vector<char> abi;
-        wasm::name        contract_name = wasm::name(params[1].get_str());
-        if(!get_native_contract_abi(contract_name.value, abi)){
-            CAccount           contract;
-            CUniversalContract contract_store;
-            get_contract(database_account, database_contract, contract_name, contract, contract_store );
-            abi = std::vector<char>(contract_store.abi.begin(), contract_store.abi.end());
-        }
+        wasm::name contract_name = wasm::name(params[1].get_str());
+        auto       abis          = get_abi_serializer(database_account, database_contract, contract_name);
 
         EnsureWalletIsUnlocked();
         CWasmContractTx tx;
@@ -235,8 +244,7 @@ Value submitwasmcontractcalltx( const Array &params, bool fHelp ) {
             std::vector<char> action_data(params[3].get_str().begin(), params[3].get_str().end());
             JSON_RPC_ASSERT(!action_data.empty() && action_data.size() < MAX_CONTRACT_ARGUMENT_SIZE, RPC_WALLET_ERROR,
                             "arguments is empty or out of size")
-            if( abi.size() > 0 )
-                action_data = wasm::abi_serializer::pack(abi, action.to_string(), params[3].get_str(), max_serialization_time);
+            action_data = abis->pack_action(action.to_string(), params[3].get_str(), max_serialization_time);
 
             ComboMoney fee  = RPC_PARAM::GetFee(params, 4, TxType::WASM_CONTRACT_TX);
 
@@ -282,7 +290,7 @@ Value gettablewasm( const Array &params, bool fHelp ) {
         CAccount contract;
         CUniversalContract contract_store;
         get_contract(database_account, database_contract, contract_name, contract, contract_store );
-        std::vector<char> abi = std::vector<char>(contract_store.abi.begin(), contract_store.abi.end());
+        auto abis = wasm::abi_serializer::get_serializer(contract_store.abi, max_serialization_time);
 
         uint64_t numbers = default_query_rows;
         if (params.size() > 2) numbers = std::atoi(params[2].get_str().data());
@@ -307,8 +315,7 @@ Value gettablewasm( const Array &params, bool fHelp ) {
             const string& value = pContractDataIt->GetValue();
 
             //unpack value in bytes to json
-            std::vector<char> value_bytes(value.begin(), value.end());
-            json_spirit::Value   value_json  = wasm::abi_serializer::unpack(abi, contract_table.value, value_bytes, max_serialization_time);
+            json_spirit::Value   value_json  = abis->unpack_table(contract_table.value, value.data(), value.size(), max_serialization_time);
             json_spirit::Object& object_json = value_json.get_obj();
 
             //append key and value
@@ -337,20 +344,13 @@ Value jsontobinwasm( const Array &params, bool fHelp ) {
         auto contract_name     = wasm::name(params[0].get_str());
         auto contract_action   = wasm::name(params[1].get_str());
 
-        std::vector<char>  abi;
-        CAccount           contract;
-        CUniversalContract contract_store;
-        if(!get_native_contract_abi(contract_name.value, abi)){
-            get_contract(database_account, database_contract, contract_name, contract, contract_store );
-            abi = std::vector<char>(contract_store.abi.begin(), contract_store.abi.end());
-        }
+        auto abis = get_abi_serializer(database_account, database_contract, contract_name);
 
         string arguments = params[2].get_str();
         JSON_RPC_ASSERT(!arguments.empty() && arguments.size() < MAX_CONTRACT_ARGUMENT_SIZE,
                         RPC_INVALID_PARAMETER,
                         "arguments is empty or out of size")
-        std::vector<char> action_data(arguments.begin(), arguments.end() );
-        if( abi.size() > 0 ) action_data = wasm::abi_serializer::pack(abi, contract_action.to_string(), arguments, max_serialization_time);
+        std::vector<char> action_data = abis->pack_action(contract_action.to_string(), arguments, max_serialization_time);
 
         json_spirit::Object object_return;
         object_return.push_back(Pair("data", wasm::ToHex(action_data,"")));
@@ -372,13 +372,7 @@ Value bintojsonwasm( const Array &params, bool fHelp ) {
         auto contract_name     = wasm::name(params[0].get_str());
         auto contract_action   = wasm::name(params[1].get_str());
 
-        std::vector<char>  abi;
-        CAccount           contract;
-        CUniversalContract contract_store;
-        if(!get_native_contract_abi(contract_name.value, abi)){
-            get_contract(database_account, database_contract, contract_name, contract, contract_store );
-            abi = std::vector<char>(contract_store.abi.begin(), contract_store.abi.end());
-        }
+        auto abis = get_abi_serializer(database_account, database_contract, contract_name);
 
         string arguments = FromHex(params[2].get_str());
         JSON_RPC_ASSERT(!arguments.empty() && arguments.size() < MAX_CONTRACT_ARGUMENT_SIZE,
@@ -387,7 +381,7 @@ Value bintojsonwasm( const Array &params, bool fHelp ) {
 
         json_spirit::Object object_return;
         std::vector<char>   action_data(arguments.begin(), arguments.end() );
-        json_spirit::Value  value = wasm::abi_serializer::unpack(abi, contract_action.to_string(), action_data, max_serialization_time);
+        json_spirit::Value  value = abis->unpack_action(contract_action.to_string(), action_data, max_serialization_time);
         object_return.push_back(Pair("data", value));
         return object_return;
 
@@ -477,4 +471,19 @@ Value gettxtrace( const Array &params, bool fHelp ) {
 
     } JSON_RPC_CAPTURE_AND_RETHROW;
 
-}
\ No newline at end of file
+}
+
+Value getwasmcacheinfo( const Array &params, bool fHelp ) {
+
+    RESPONSE_RPC_HELP( fHelp || params.size() != 0 , wasm::rpc::get_wasm_cache_info_rpc_help_message)
+
+    wasm::wasm_cache_stats stats = wasm::wasm_interface::get_cache_stats();
+
+    json_spirit::Object object_return;
+    object_return.push_back(Pair("size",      (int64_t)stats.size));
+    object_return.push_back(Pair("hits",      (int64_t)stats.hits));
+    object_return.push_back(Pair("misses",    (int64_t)stats.misses));
+    object_return.push_back(Pair("evictions", (int64_t)stats.evictions));
+    return object_return;
+
+}
@@ -6,45 +6,229 @@
 
 #include "sigcache.h"
 
-void CSignatureCache::ComputeEntry(uint256& entry, const uint256& sigHash,
+#include "crypto/common.h"
+
+void CSignatureCache::Setup(size_t maxBytes) {
+    size_t bucketCount = 0;
+    if (maxBytes >= SIGCACHE_BUCKET_SLOTS * sizeof(uint64_t)) {
+        bucketCount = 1;
+        while (bucketCount * 2 * SIGCACHE_BUCKET_SLOTS * sizeof(uint64_t) <= maxBytes)
+            bucketCount *= 2;
+    }
+
+    salt       = GetRandHash();
+    bucketMask = bucketCount > 0 ? bucketCount - 1 : 0;
+    slots.reset(bucketCount > 0 ? new std::atomic<uint64_t>[bucketCount * SIGCACHE_BUCKET_SLOTS] : nullptr);
+    for (size_t i = 0; i < bucketCount * SIGCACHE_BUCKET_SLOTS; i++)
+        slots[i].store(0, std::memory_order_relaxed);
+
+    hits   = 0;
+    misses = 0;
+}
+
+void CSignatureCache::ComputeEntry(Entry& entry, const uint256& sigHash,
                                    const std::vector<unsigned char>& vchSig,
                                    const CPubKey& pubKey) {
+    uint256 hash;
     CSHA256()
+        .Write(salt.begin(), 32)
         .Write(sigHash.begin(), 32)
         .Write(&pubKey[0], pubKey.size())
         .Write(&vchSig[0], vchSig.size())
-        .Finalize(entry.begin());
+        .Finalize(hash.begin());
+
+    entry.fingerprint = ReadLE64(hash.begin());
+    if (entry.fingerprint == 0)
+        entry.fingerprint = 1;
+
+    entry.buckets[0] = ReadLE64(hash.begin() + 8) & bucketMask;
+    entry.buckets[1] = ReadLE64(hash.begin() + 16) & bucketMask;
+    if (entry.buckets[1] == entry.buckets[0])
+        entry.buckets[1] = (entry.buckets[0] + 1) & bucketMask;
+
+    entry.evictSlot = ReadLE64(hash.begin() + 24) % (2 * SIGCACHE_BUCKET_SLOTS);
+}
+
+std::atomic<uint64_t>* CSignatureCache::Find(const Entry& entry) {
+    for (uint64_t bucket : entry.buckets) {
+        std::atomic<uint64_t>* pBucket = &slots[bucket * SIGCACHE_BUCKET_SLOTS];
+        for (uint32_t i = 0; i < SIGCACHE_BUCKET_SLOTS; i++) {
+            if (pBucket[i].load(std::memory_order_acquire) == entry.fingerprint)
+                return &pBucket[i];
+        }
+    }
+    return nullptr;
 }
 
 bool CSignatureCache::Get(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
-                          const CPubKey& pubKey) {
-    uint256 entry;
+                          const CPubKey& pubKey, bool fErase) {
+    if (!slots) return false;
+
+    Entry entry;
     ComputeEntry(entry, sigHash, vchSig, pubKey);
-    std::unique_lock<std::mutex> lock(mtx);
-    return setValid.count(entry);
+
+    std::atomic<uint64_t>* pSlot = Find(entry);
+    if (pSlot == nullptr) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    hits.fetch_add(1, std::memory_order_relaxed);
+    if (fErase) {
+        // the slot may have been reused by another entry meanwhile, then leave it alone
+        uint64_t fingerprint = entry.fingerprint;
+        pSlot->compare_exchange_strong(fingerprint, 0, std::memory_order_acq_rel);
+    }
+    return true;
 }
 
 void CSignatureCache::Set(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
                           const CPubKey& pubKey) {
-    static int64_t nMaxCacheSize = SysCfg().GetArg("-maxsigcachesize", 50000);
-    if (nMaxCacheSize <= 0) return;
+    if (!slots) return;
+
+    Entry entry;
+    ComputeEntry(entry, sigHash, vchSig, pubKey);
+
+    // lock the stripes of both buckets in order
+    uint64_t stripe0 = entry.buckets[0] % SIGCACHE_LOCK_STRIPES;
+    uint64_t stripe1 = entry.buckets[1] % SIGCACHE_LOCK_STRIPES;
+    if (stripe0 > stripe1)
+        std::swap(stripe0, stripe1);
+    std::unique_lock<std::mutex> lock0(stripes[stripe0]);
+    std::unique_lock<std::mutex> lock1;
+    if (stripe1 != stripe0)
+        lock1 = std::unique_lock<std::mutex>(stripes[stripe1]);
+
+    if (Find(entry) != nullptr)
+        return;
+
+    for (uint64_t bucket : entry.buckets) {
+        std::atomic<uint64_t>* pBucket = &slots[bucket * SIGCACHE_BUCKET_SLOTS];
+        for (uint32_t i = 0; i < SIGCACHE_BUCKET_SLOTS; i++) {
+            uint64_t empty = 0;
+            if (pBucket[i].compare_exchange_strong(empty, entry.fingerprint, std::memory_order_acq_rel))
+                return;
+        }
+    }
+
+    // Both buckets are full. Evict the slot picked by the salted hash rather than the oldest
+    // one, that helps foil would-be DoS attackers who might try to pre-generate and re-use a
+    // set of valid signatures just-slightly-greater than our cache size.
+    uint64_t bucket = entry.buckets[entry.evictSlot / SIGCACHE_BUCKET_SLOTS];
+    slots[bucket * SIGCACHE_BUCKET_SLOTS + entry.evictSlot % SIGCACHE_BUCKET_SLOTS].store(
+        entry.fingerprint, std::memory_order_release);
+}
 
-    uint256 entry;
+void CSignatureCache::Erase(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
+                            const CPubKey& pubKey) {
+    if (!slots) return;
+
+    Entry entry;
     ComputeEntry(entry, sigHash, vchSig, pubKey);
 
+    std::atomic<uint64_t>* pSlot = Find(entry);
+    if (pSlot != nullptr) {
+        uint64_t fingerprint = entry.fingerprint;
+        pSlot->compare_exchange_strong(fingerprint, 0, std::memory_order_acq_rel);
+    }
+}
+
+void CSignatureCheckPool::Start(int32_t threadCount) {
+    Stop();
+
     std::unique_lock<std::mutex> lock(mtx);
+    fStop = false;
+    for (int32_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(&CSignatureCheckPool::ThreadWork, this, batchSeq);
+    }
+}
 
-    while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize) {
-        // Evict a random entry. Random because that helps
-        // foil would-be DoS attackers who might try to pre-generate
-        // and re-use a set of valid signatures just-slightly-greater
-        // than our cache size.
-        UnorderedHashSet::size_type s       = GetRand(setValid.bucket_count());
-        UnorderedHashSet::local_iterator it = setValid.begin(s);
-        if (it != setValid.end(s)) {
-            setValid.erase(*it);
+void CSignatureCheckPool::Stop() {
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        fStop = true;
+    }
+    cvWork.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+}
+
+uint32_t CSignatureCheckPool::Verify(const std::vector<CSignatureItem>& items, CSignatureCache& cache) {
+    std::unique_lock<std::mutex> lockVerify(mtxVerify);
+
+    pItems    = &items;
+    pCache    = &cache;
+    nextIndex = 0;
+    validCount = 0;
+
+    if (threads.empty() || items.size() < 2) {
+        DoWork();
+    } else {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            nWorking = threads.size();
+            ++batchSeq;
         }
+        cvWork.notify_all();
+
+        DoWork();
+
+        std::unique_lock<std::mutex> lock(mtx);
+        cvDone.wait(lock, [this] { return nWorking == 0; });
+    }
+
+    pItems = nullptr;
+    pCache = nullptr;
+    return validCount;
+}
+
+void CSignatureCheckPool::ThreadWork(uint64_t lastBatchSeq) {
+    RenameThread("coin-sigcheck");
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cvWork.wait(lock, [&] { return fStop || batchSeq != lastBatchSeq; });
+            if (fStop)
+                return;
+            lastBatchSeq = batchSeq;
+        }
+
+        DoWork();
+
+        std::unique_lock<std::mutex> lock(mtx);
+        if (--nWorking == 0)
+            cvDone.notify_one();
     }
+}
 
-    setValid.insert(entry);
+void CSignatureCheckPool::DoWork() {
+    std::vector<CSignatureItem> batch;
+    std::vector<bool> results;
+    batch.reserve(SIGCHECK_BATCH_SIZE);
+    for (size_t begin = nextIndex.fetch_add(SIGCHECK_BATCH_SIZE); begin < pItems->size();
+         begin = nextIndex.fetch_add(SIGCHECK_BATCH_SIZE)) {
+        size_t end = std::min(begin + SIGCHECK_BATCH_SIZE, pItems->size());
+        batch.clear();
+        for (size_t index = begin; index < end; index++) {
+            const CSignatureItem& item = (*pItems)[index];
+            if (pCache->Get(item.sigHash, item.signature, item.pubKey))
+                ++validCount;
+            else
+                batch.push_back(item);
+        }
+        if (batch.empty())
+            continue;
+
+        VerifySignatureBatch(batch, results);
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (results[i]) {
+                pCache->Set(batch[i].sigHash, batch[i].signature, batch[i].pubKey);
+                ++validCount;
+            }
+        }
+    }
 }
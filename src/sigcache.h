@@ -7,7 +7,11 @@
 #ifndef COIN_SIGCACHE_H
 #define COIN_SIGCACHE_H
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 #include "config/chainparams.h"
@@ -17,28 +21,117 @@
 #include "commons/uint256.h"
 #include "commons/util/util.h"
 
+/** Number of the fingerprint slots of a signature cache bucket */
+static const uint32_t SIGCACHE_BUCKET_SLOTS = 4;
+/** Number of the mutexes to serialize the writers of the signature cache buckets */
+static const uint32_t SIGCACHE_LOCK_STRIPES = 64;
+/** -maxsigcachesize default (MB) */
+static const int64_t DEFAULT_MAX_SIG_CACHE_SIZE = 16;
+/** Maximum of -maxsigcachesize (MB), it was a number of entries before, e.g. 50000 */
+static const int64_t MAX_MAX_SIG_CACHE_SIZE = 1024;
+/** -sigcacheeraseonconnect default, the signatures of a connected block are rarely checked again */
+static const bool DEFAULT_SIG_CACHE_ERASE_ON_CONNECT = true;
+
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
  * again when accepted into the block chain)
+ *
+ * The cache is a fixed size table of buckets, every bucket holds SIGCACHE_BUCKET_SLOTS 64-bit
+ * fingerprints of salted SHA256(signature hash || public key || signature), and an entry may
+ * live in one of its two candidate buckets. Readers only do atomic loads, writers of a bucket are
+ * serialized by a striped mutex. When both buckets are full, a slot picked by the salted entry
+ * hash is evicted, so that attackers can not choose which entries get evicted.
  */
 class CSignatureCache {
 private:
-    //! Entries are SHA256(signature hash || public key || signature):
-    UnorderedHashSet setValid;
-    std::mutex mtx;
+    uint256 salt;
+    std::unique_ptr<std::atomic<uint64_t>[]> slots;
+    uint64_t bucketMask = 0;  // bucket count - 1, the bucket count is a power of 2
+    std::mutex stripes[SIGCACHE_LOCK_STRIPES];
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
 
 public:
     CSignatureCache() {}
     ~CSignatureCache() {}
+
+    // Reset the cache to use at most maxBytes memory, the cache is disabled when maxBytes is
+    // less than one bucket. It must not be called concurrently with the other methods.
+    void Setup(size_t maxBytes);
+
+    // Lookup the entry and erase it on hit if fErase is true
     bool Get(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
-             const CPubKey& pubKey);
+             const CPubKey& pubKey, bool fErase = false);
     void Set(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
              const CPubKey& pubKey);
+    void Erase(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
+               const CPubKey& pubKey);
+
+    size_t GetMemorySize() const {
+        return slots ? (bucketMask + 1) * SIGCACHE_BUCKET_SLOTS * sizeof(uint64_t) : 0;
+    }
+    uint64_t GetHits() const { return hits; }
+    uint64_t GetMisses() const { return misses; }
 
 private:
-    void ComputeEntry(uint256& entry, const uint256& sigHash,
+    struct Entry {
+        uint64_t fingerprint;  // never 0, which marks an empty slot
+        uint64_t buckets[2];
+        uint64_t evictSlot;    // the slot to evict when both buckets are full
+    };
+
+    void ComputeEntry(Entry& entry, const uint256& sigHash,
                       const std::vector<unsigned char>& vchSig, const CPubKey& pubKey);
+    // Return the slot holding the entry, or nullptr if not found
+    std::atomic<uint64_t>* Find(const Entry& entry);
+};
+
+/** Maximum number of signature check threads */
+static const int32_t MAX_SIGCHECK_THREADS = 16;
+/** -par default (number of signature check threads, 0 = auto) */
+static const int32_t DEFAULT_SIGCHECK_THREADS = 0;
+
+/** Number of signatures claimed by a worker at a time and verified as one batch */
+static const size_t SIGCHECK_BATCH_SIZE = 16;
+
+/**
+ * Pool of worker threads to verify the signatures of a batch in parallel, the caller thread
+ * works too. The valid signatures are put into the signature cache, so the later sequential
+ * checking will hit the cache instead of doing ECDSA checking again.
+ */
+class CSignatureCheckPool {
+private:
+    std::mutex mtxVerify;  // only one batch is verified at a time
+    std::mutex mtx;
+    std::condition_variable cvWork;
+    std::condition_variable cvDone;
+    std::vector<std::thread> threads;
+    bool fStop = false;
+    uint64_t batchSeq = 0;
+    int32_t nWorking = 0;
+
+    const std::vector<CSignatureItem>* pItems = nullptr;
+    CSignatureCache* pCache = nullptr;
+    std::atomic<size_t> nextIndex{0};
+    std::atomic<uint32_t> validCount{0};
+
+public:
+    CSignatureCheckPool() {}
+    ~CSignatureCheckPool() { Stop(); }
+
+    // start the worker threads, no thread is started when threadCount <= 1
+    void Start(int32_t threadCount);
+    void Stop();
+    int32_t GetThreadCount() const { return threads.size() + 1; }
+
+    // verify all items and return the count of valid items
+    uint32_t Verify(const std::vector<CSignatureItem>& items, CSignatureCache& cache);
+
+private:
+    void ThreadWork(uint64_t lastBatchSeq);
+    void DoWork();
 };
 
 #endif  // COIN_SIGCACHE_H
\ No newline at end of file
@@ -0,0 +1,103 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "persistence/cdpdb.h"
+
+using namespace std;
+
+struct FCdpDBTests {
+    FCdpDBTests() {
+        root_dir = "/tmp/coind_unit_test";
+        if (!boost::filesystem::exists(root_dir))
+            BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(root_dir));
+
+        db_dir = root_dir / "cdpdb_tests";
+        BOOST_CHECK_MESSAGE(!boost::filesystem::exists(db_dir), "must remove dir " + db_dir.string() + " first");
+        BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(db_dir));
+
+        const bool isWipe = true;
+        pDBAccess = make_shared<CDBAccess>(db_dir, DBNameType::CDP, false, isWipe);
+
+        // the collateral ratio bases are 1.0, 1.5, 3.0 and 1.2
+        cdp1 = CUserCDP(CRegID(1, 1), uint256S("1"), 1, SYMB::WICC, SYMB::WUSD, 100, 100);
+        cdp2 = CUserCDP(CRegID(1, 2), uint256S("2"), 1, SYMB::WICC, SYMB::WUSD, 150, 100);
+        cdp3 = CUserCDP(CRegID(1, 3), uint256S("3"), 1, SYMB::WICC, SYMB::WUSD, 300, 100);
+        cdp4 = CUserCDP(CRegID(2, 1), uint256S("4"), 2, SYMB::WICC, SYMB::WUSD, 120, 100);
+    }
+    ~FCdpDBTests() {
+        pDBAccess.reset();
+        BOOST_CHECK_NO_THROW(boost::filesystem::remove_all(db_dir));
+    }
+
+    // the cdpids below the collateral ratio 2.0, in the cursor order
+    static vector<uint256> ListCdpIds(CCdpDBCache &cdpCache) {
+        vector<uint256> cdpids;
+        CCdpRatioCursor cursor(cdpCache, 2 * RATIO_BOOST, PRICE_BOOST);
+        BOOST_CHECK(!cursor.IsFailed());
+        for (; cursor.IsValid(); cursor.Next()) {
+            CUserCDP cdp;
+            BOOST_CHECK(cursor.GetCdp(cdp) && cdp.cdpid == std::get<2>(cursor.GetKey()));
+            cdpids.push_back(std::get<2>(cursor.GetKey()));
+        }
+        return cdpids;
+    }
+
+    boost::filesystem::path root_dir;
+    boost::filesystem::path db_dir;
+    shared_ptr<CDBAccess> pDBAccess;
+    CUserCDP cdp1, cdp2, cdp3, cdp4;
+};
+
+BOOST_FIXTURE_TEST_SUITE(cdpdb_tests, FCdpDBTests)
+
+BOOST_AUTO_TEST_CASE(cdp_ratio_cursor_test)
+{
+    // the index is loaded from db by the first cursor
+    CCdpDBCache bottomCache(pDBAccess.get());
+    BOOST_CHECK(bottomCache.NewCDP(1, cdp1) && bottomCache.NewCDP(1, cdp2) && bottomCache.NewCDP(1, cdp3));
+    bottomCache.Flush();
+    BOOST_CHECK((ListCdpIds(bottomCache) == vector<uint256>{cdp1.cdpid, cdp2.cdpid}));
+
+    // the cdps saved and erased in the upper cache are merged with the index
+    CDBOpLogMap undoLog;
+    CCdpDBCache upperCache(&bottomCache);
+    upperCache.SetDbOpLogMap(&undoLog);
+    BOOST_CHECK(upperCache.NewCDP(2, cdp4));
+    BOOST_CHECK(upperCache.EraseCDP(cdp1, cdp1));
+    upperCache.SetDbOpLogMap(nullptr);
+    BOOST_CHECK((ListCdpIds(upperCache) == vector<uint256>{cdp4.cdpid, cdp2.cdpid}));
+    BOOST_CHECK((ListCdpIds(bottomCache) == vector<uint256>{cdp1.cdpid, cdp2.cdpid}));
+
+    // the flush to the bottom cache keeps the index untouched until the bottom cache writes db
+    upperCache.Flush();
+    BOOST_CHECK((ListCdpIds(bottomCache) == vector<uint256>{cdp4.cdpid, cdp2.cdpid}));
+    bottomCache.Flush();
+    BOOST_CHECK((ListCdpIds(bottomCache) == vector<uint256>{cdp4.cdpid, cdp2.cdpid}));
+
+    // a new index loaded from db is the same as the updated one
+    CCdpDBCache reloadedCache(pDBAccess.get());
+    BOOST_CHECK((ListCdpIds(reloadedCache) == vector<uint256>{cdp4.cdpid, cdp2.cdpid}));
+
+    // the undo is merged in the upper cache and then reaches the index by the flush of the bottom cache
+    CCdpDBCache undoCache(&bottomCache);
+    UndoDataFuncMap undoFuncMap;
+    undoCache.RegisterUndoFunc(undoFuncMap);
+    for (const auto &item : undoLog.GetMap())
+        undoFuncMap[dbk::ParseKeyPrefixType(item.first)](item.second, false);
+    BOOST_CHECK((ListCdpIds(undoCache) == vector<uint256>{cdp1.cdpid, cdp2.cdpid}));
+
+    undoCache.Flush();
+    bottomCache.Flush();
+    BOOST_CHECK((ListCdpIds(bottomCache) == vector<uint256>{cdp1.cdpid, cdp2.cdpid}));
+
+    CCdpDBCache undoneCache(pDBAccess.get());
+    BOOST_CHECK((ListCdpIds(undoneCache) == vector<uint256>{cdp1.cdpid, cdp2.cdpid}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
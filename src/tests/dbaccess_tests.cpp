@@ -124,6 +124,219 @@ BOOST_AUTO_TEST_CASE(dbcache_multi_value_Level3_test)
 }
 
 
+BOOST_AUTO_TEST_CASE(dbcache_read_cache_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+    pDBAccess->SetReadCacheLimit(64);
+
+    auto pDBCache1 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+    auto pDBCache2 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBCache1.get());
+    pDBCache2->SetData("regid-1", "keyid-1");
+    pDBCache2->SetData("regid-2", "keyid-2");
+    pDBCache2->SetData("regid-3", "keyid-3");
+    BOOST_CHECK(pDBCache2->GetCacheSize() == 3 * 16);
+    pDBCache2->Flush();
+    BOOST_CHECK(pDBCache2->GetCacheSize() == 0);
+    BOOST_CHECK(pDBCache1->GetCacheSize() == 3 * 16);
+    pDBCache1->Flush();
+
+    // the flushed data stay in read cache, and the read cache is limited by the budget
+    BOOST_CHECK(pDBCache1->GetCacheSize() == 0);
+    BOOST_CHECK(pDBCache1->GetReadCacheSize() <= 64);
+    BOOST_CHECK(pDBCache1->GetReadCacheSize() == pDBAccess->GetReadCacheUsage());
+
+    // the read from child cache will not make the base cache dirty
+    string value1, value2, value3;
+    BOOST_CHECK(pDBCache2->GetData(string("regid-1"), value1) && value1 == "keyid-1");
+    BOOST_CHECK(pDBCache2->GetData(string("regid-2"), value2) && value2 == "keyid-2");
+    BOOST_CHECK(pDBCache2->GetData(string("regid-3"), value3) && value3 == "keyid-3");
+    BOOST_CHECK(pDBCache1->GetCacheSize() == 0);
+    BOOST_CHECK(pDBCache1->GetReadCacheSize() <= 64);
+
+    // the modified data override the read cache
+    pDBCache1->SetData("regid-1", "keyid-1x");
+    BOOST_CHECK(pDBCache1->GetData(string("regid-1"), value1) && value1 == "keyid-1x");
+    pDBCache1->Clear();
+    BOOST_CHECK(pDBCache1->GetData(string("regid-1"), value1) && value1 == "keyid-1");
+
+    pDBCache1.reset();
+    BOOST_CHECK(pDBAccess->GetReadCacheUsage() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_negative_lookup_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+    pDBAccess->SetReadCacheLimit(1 << 20);
+    const CDBLookupStat &stat = pDBAccess->GetLookupStat(prefix);
+
+    auto pDBCache1 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+    auto pDBCache2 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBCache1.get());
+    pDBCache1->SetData("regid-1", "keyid-1");
+    pDBCache1->Flush();
+    BOOST_CHECK(pDBAccess->EnableKeyFilter(prefix));
+
+    // the miss is cached after the first db read
+    string value;
+    BOOST_CHECK(!pDBCache2->HaveData("regid-2"));
+    BOOST_CHECK(!pDBCache2->GetData("regid-2", value));
+    BOOST_CHECK(stat.filterMisses == 1);
+    BOOST_CHECK(stat.negativeHits == 1);
+    BOOST_CHECK(pDBCache2->GetMapData().empty());
+
+    // the cached miss is invalidated by SetData
+    pDBCache2->SetData("regid-2", "keyid-2");
+    pDBCache2->Flush();
+    BOOST_CHECK(pDBCache1->GetData("regid-2", value) && value == "keyid-2");
+    pDBCache1->Flush();
+    BOOST_CHECK(pDBCache1->GetData("regid-2", value) && value == "keyid-2");
+
+    // the flushed key is added to key filter
+    pDBCache1->Clear();
+    auto pDBCache3 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+    BOOST_CHECK(pDBCache3->GetData("regid-1", value) && value == "keyid-1");
+    BOOST_CHECK(pDBCache3->GetData("regid-2", value) && value == "keyid-2");
+    BOOST_CHECK(stat.dbHits == 2);
+
+    // the erased data become cached miss
+    pDBCache3->EraseData("regid-1");
+    pDBCache3->Flush();
+    uint64_t negativeHits = stat.negativeHits;
+    BOOST_CHECK(!pDBCache3->HaveData("regid-1"));
+    BOOST_CHECK(stat.negativeHits == negativeHits + 1);
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_overlay_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache1 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+    auto pDBCache2 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBCache1.get());
+    auto pDBCache3 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBCache2.get());
+    pDBCache2->SetData("regid-1", "keyid-1");
+    BOOST_CHECK(pDBCache2->GetCacheSize() == 16);
+
+    // the read from overlay goes through the base, no data is copied up
+    string value;
+    BOOST_CHECK(pDBCache3->GetData(string("regid-1"), value) && value == "keyid-1");
+    BOOST_CHECK(pDBCache3->GetCacheSize() == 0);
+
+    // the discarded data of overlay does not reach the base, the overlay can be reused after cleared
+    pDBCache3->SetData("regid-1", "keyid-1x");
+    pDBCache3->SetData("regid-2", "keyid-2");
+    pDBCache3->Clear();
+    BOOST_CHECK(pDBCache3->GetCacheSize() == 0);
+    BOOST_CHECK(pDBCache3->GetData(string("regid-1"), value) && value == "keyid-1");
+    BOOST_CHECK(!pDBCache3->HaveData(string("regid-2")));
+
+    pDBCache3->SetData("regid-2", "keyid-2");
+    pDBCache3->Flush();
+    BOOST_CHECK(pDBCache2->GetData(string("regid-2"), value) && value == "keyid-2");
+    BOOST_CHECK(pDBCache2->GetCacheSize() == 2 * 16);
+
+    // the scalar value read through the base too, and the erase does not change the base
+    auto pScalar1 = make_shared< CSimpleKVCache<dbk::BEST_BLOCKHASH, string> >(pDBAccess.get());
+    auto pScalar2 = make_shared< CSimpleKVCache<dbk::BEST_BLOCKHASH, string> >(pScalar1.get());
+    pScalar1->SetData("hash-1");
+    BOOST_CHECK(pScalar2->GetData(value) && value == "hash-1");
+    BOOST_CHECK(pScalar2->GetCacheSize() == 0);
+    pScalar2->EraseData();
+    BOOST_CHECK(!pScalar2->HaveData());
+    BOOST_CHECK(pScalar1->GetData(value) && value == "hash-1");
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_access_tracking_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache1 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+    auto pDBCache2 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBCache1.get());
+    pDBCache1->SetData("regid-1", "keyid-1");
+    pDBCache1->SetData("regid-2", "keyid-2");
+
+    // the read, written and erased keys are logged, the redo logs keep the last values
+    CDBOpLogMap accessLog;
+    accessLog.SetAccessTracking(true);
+    pDBCache2->SetDbOpLogMap(&accessLog);
+    string value;
+    BOOST_CHECK(pDBCache2->GetData(string("regid-1"), value));
+    pDBCache2->SetData("regid-3", "keyid-3x");
+    pDBCache2->SetData("regid-3", "keyid-3");
+    pDBCache2->EraseData("regid-2");
+    pDBCache2->SetDbOpLogMap(nullptr);
+
+    const set<string> &keys = accessLog.GetAccessKeys().at(dbk::GetKeyPrefix(prefix));
+    BOOST_CHECK(keys.size() == 3);
+    BOOST_CHECK(keys.count(dbk::GenDbKey(prefix, string("regid-1"))));
+    BOOST_CHECK(accessLog.GetAccessPrefixes().empty());
+    BOOST_CHECK(accessLog.GetRedoLogs().at(prefix).size() == 2);
+
+    // the redo logs replay the writes on another overlay
+    auto pDBCache3 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBCache1.get());
+    CDbOpLogs redoLogs;
+    for (const auto &item : accessLog.GetRedoLogs().at(prefix))
+        redoLogs.push_back(item.second);
+    UndoDataFuncMap redoFuncMap;
+    pDBCache3->RegisterUndoFunc(redoFuncMap);
+    redoFuncMap[prefix](redoLogs, false);
+    BOOST_CHECK(pDBCache3->GetData(string("regid-3"), value) && value == "keyid-3");
+    BOOST_CHECK(!pDBCache3->HaveData(string("regid-2")));
+    BOOST_CHECK(pDBCache3->GetData(string("regid-1"), value) && value == "keyid-1");
+
+    // the flushed keys are logged too
+    CDBOpLogMap flushLog;
+    flushLog.SetAccessTracking(true);
+    pDBCache3->SetDbOpLogMap(&flushLog);
+    pDBCache3->Flush();
+    BOOST_CHECK(flushLog.GetAccessKeys().at(dbk::GetKeyPrefix(prefix)).size() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_undo_keep_data_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache1 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+    pDBCache1->SetData("regid-1", "keyid-1");
+    pDBCache1->SetData("regid-2", "keyid-2");
+    pDBCache1->Flush();
+
+    // a block changes the keys, the first old value of a key is its value before the block
+    auto pBlockCache = make_shared< CCompositeKVCache<prefix, string, string> >(pDBCache1.get());
+    CDBOpLogMap undoLog;
+    pBlockCache->SetDbOpLogMap(&undoLog);
+    pBlockCache->SetData("regid-1", "keyid-1a");
+    pBlockCache->SetData("regid-1", "keyid-1b");
+    pBlockCache->SetData("regid-2", "keyid-2a");
+    pBlockCache->SetDbOpLogMap(nullptr);
+
+    // the fork overlay has changed regid-1 before the block is connected to its base
+    auto pForkCache = make_shared< CCompositeKVCache<prefix, string, string> >(pDBCache1.get());
+    pForkCache->SetData("regid-1", "keyid-1f");
+    pBlockCache->Flush();
+
+    UndoDataFuncMap undoFuncMap;
+    pForkCache->RegisterUndoFunc(undoFuncMap);
+    undoFuncMap[prefix](*undoLog.GetDbOpLogsPtr(prefix), true);
+    string value;
+    BOOST_CHECK(pForkCache->GetData(string("regid-1"), value) && value == "keyid-1f");
+    BOOST_CHECK(pForkCache->GetData(string("regid-2"), value) && value == "keyid-2");
+    BOOST_CHECK(pDBCache1->GetData(string("regid-2"), value) && value == "keyid-2a");
+}
+
 BOOST_AUTO_TEST_CASE(dbcache_scalar_value_Level3_test)
 {
     const bool isWipe = true;
@@ -0,0 +1,57 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+// make count headers from the height 1, each one linked to the previous one
+static vector<CBlock> MakeHeaders(size_t count) {
+    vector<CBlock> vHeaders(count);
+    for (size_t i = 0; i < count; i++) {
+        vHeaders[i].SetHeight(i + 1);
+        vHeaders[i].SetTime(i + 1);
+        if (i > 0)
+            vHeaders[i].SetPrevBlockHash(vHeaders[i - 1].GetHash());
+    }
+    return vHeaders;
+}
+
+BOOST_AUTO_TEST_SUITE(headers_tests)
+
+BOOST_AUTO_TEST_CASE(continuous_headers_test)
+{
+    BOOST_CHECK(IsContinuousHeaders(vector<CBlock>()));
+    BOOST_CHECK(IsContinuousHeaders(MakeHeaders(1)));
+    BOOST_CHECK(IsContinuousHeaders(MakeHeaders(10)));
+
+    // the first header is checked against the active chain or the sync headers by the caller
+    vector<CBlock> vHeaders = MakeHeaders(10);
+    vHeaders[0].SetPrevBlockHash(uint256S("1"));
+    vHeaders[1].SetPrevBlockHash(vHeaders[0].GetHash());
+    BOOST_CHECK(IsContinuousHeaders(vHeaders));
+}
+
+BOOST_AUTO_TEST_CASE(gapped_headers_test)
+{
+    // a header dropped from the batch
+    vector<CBlock> vHeaders = MakeHeaders(10);
+    vHeaders.erase(vHeaders.begin() + 5);
+    BOOST_CHECK(!IsContinuousHeaders(vHeaders));
+
+    // a header linked to its previous one with a skipped height
+    vHeaders = MakeHeaders(10);
+    vHeaders[9].SetHeight(11);
+    BOOST_CHECK(!IsContinuousHeaders(vHeaders));
+
+    // a header at the next height not linked to its previous one
+    vHeaders = MakeHeaders(10);
+    vHeaders[5].SetPrevBlockHash(uint256S("1"));
+    BOOST_CHECK(!IsContinuousHeaders(vHeaders));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
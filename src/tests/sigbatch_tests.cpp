@@ -0,0 +1,171 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "entities/key.h"
+#include "sigcache.h"
+
+using namespace std;
+
+struct FSigBatchTests {
+    FSigBatchTests() { ECC_Start(); }
+    ~FSigBatchTests() { ECC_Stop(); }
+};
+
+// make count signature items signed by keyCount keys in turn
+static void MakeSignatureItems(size_t count, size_t keyCount, vector<CSignatureItem> &items) {
+    vector<CKey> keys(keyCount);
+    for (auto &key : keys)
+        key.MakeNewKey();
+
+    items.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        CSignatureItem &item = items[i];
+        const CKey &key      = keys[i % keyCount];
+        item.sigHash         = Hash(&i, &i + 1);
+        item.pubKey          = key.GetPubKey();
+        BOOST_CHECK(key.Sign(item.sigHash, item.signature));
+    }
+}
+
+BOOST_FIXTURE_TEST_SUITE(sigbatch_tests, FSigBatchTests)
+
+BOOST_AUTO_TEST_CASE(sigbatch_verify_test) {
+    vector<CSignatureItem> items;
+    MakeSignatureItems(20, 3, items);
+
+    vector<bool> results;
+    BOOST_CHECK(VerifySignatureBatch(items, results));
+    BOOST_CHECK(results.size() == items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        BOOST_CHECK(results[i]);
+        BOOST_CHECK(items[i].pubKey.Verify(items[i].sigHash, items[i].signature));
+    }
+
+    // a bad signature, a wrong hash and an invalid pubkey must only fail their own items
+    items[3].signature.back() ^= 0x01;
+    items[7].sigHash = Hash(&items[7], &items[7] + 1);
+    items[11].pubKey = CPubKey();
+    BOOST_CHECK(!VerifySignatureBatch(items, results));
+    for (size_t i = 0; i < items.size(); i++) {
+        bool expected = (i != 3 && i != 7 && i != 11);
+        BOOST_CHECK_MESSAGE(results[i] == expected, "item " + std::to_string(i));
+        BOOST_CHECK(items[i].pubKey.Verify(items[i].sigHash, items[i].signature) == expected);
+    }
+
+    vector<CSignatureItem> emptyItems;
+    BOOST_CHECK(VerifySignatureBatch(emptyItems, results));
+    BOOST_CHECK(results.empty());
+}
+
+BOOST_AUTO_TEST_CASE(sigcache_test) {
+    vector<CSignatureItem> items;
+    MakeSignatureItems(200, 4, items);
+
+    CSignatureCache cache;
+    BOOST_CHECK(cache.GetMemorySize() == 0);
+    cache.Set(items[0].sigHash, items[0].signature, items[0].pubKey);
+    BOOST_CHECK(!cache.Get(items[0].sigHash, items[0].signature, items[0].pubKey));
+
+    cache.Setup(1 << 20);
+    BOOST_CHECK(cache.GetMemorySize() == (1 << 20));
+    for (const auto &item : items)
+        cache.Set(item.sigHash, item.signature, item.pubKey);
+    for (const auto &item : items)
+        BOOST_CHECK(cache.Get(item.sigHash, item.signature, item.pubKey));
+    BOOST_CHECK(cache.GetHits() == items.size());
+
+    // the entry is keyed by the signature hash, the pubkey and the signature
+    CSignatureItem other = items[0];
+    other.sigHash = items[1].sigHash;
+    BOOST_CHECK(!cache.Get(other.sigHash, other.signature, other.pubKey));
+    BOOST_CHECK(cache.GetMisses() == 1);
+
+    cache.Erase(items[2].sigHash, items[2].signature, items[2].pubKey);
+    BOOST_CHECK(!cache.Get(items[2].sigHash, items[2].signature, items[2].pubKey));
+    BOOST_CHECK(cache.Get(items[3].sigHash, items[3].signature, items[3].pubKey, true));
+    BOOST_CHECK(!cache.Get(items[3].sigHash, items[3].signature, items[3].pubKey));
+
+    // a cache of two buckets keeps at most 2 * SIGCACHE_BUCKET_SLOTS entries
+    cache.Setup(2 * SIGCACHE_BUCKET_SLOTS * sizeof(uint64_t));
+    for (const auto &item : items)
+        cache.Set(item.sigHash, item.signature, item.pubKey);
+    uint32_t hitCount = 0;
+    for (const auto &item : items)
+        hitCount += cache.Get(item.sigHash, item.signature, item.pubKey);
+    BOOST_CHECK(hitCount > 0 && hitCount <= 2 * SIGCACHE_BUCKET_SLOTS);
+}
+
+// the results don't depend on how the items are split into batches
+BOOST_AUTO_TEST_CASE(sigbatch_split_test) {
+    static const size_t TOTAL_COUNT = 40;
+    vector<CSignatureItem> items;
+    MakeSignatureItems(TOTAL_COUNT, 8, items);
+    items[5].signature.back() ^= 0x01;
+    items[33].pubKey = CPubKey();
+
+    for (size_t batchSize : {1, 7, 16, 40}) {
+        for (size_t begin = 0; begin < TOTAL_COUNT; begin += batchSize) {
+            size_t end = std::min(begin + batchSize, TOTAL_COUNT);
+            vector<CSignatureItem> batch(items.begin() + begin, items.begin() + end);
+            vector<bool> results;
+            bool allValid = VerifySignatureBatch(batch, results);
+            BOOST_CHECK(results.size() == batch.size());
+            bool expectedAll = true;
+            for (size_t i = begin; i < end; i++) {
+                bool expected = (i != 5 && i != 33);
+                BOOST_CHECK_MESSAGE(results[i - begin] == expected, "item " + std::to_string(i));
+                expectedAll = expectedAll && expected;
+            }
+            BOOST_CHECK(allValid == expectedAll);
+        }
+    }
+}
+
+// The benchmark is skipped unless -benchmark is passed to the test binary after "--", e.g.
+// unit_test --run_test=sigbatch_tests/sigbatch_bench_test --log_level=message -- -benchmark
+static bool IsBenchmarkEnabled() {
+    const auto &suite = boost::unit_test::framework::master_test_suite();
+    for (int i = 1; i < suite.argc; i++) {
+        if (string(suite.argv[i]) == "-benchmark")
+            return true;
+    }
+    return false;
+}
+
+// microbenchmark of the per signature cost in batches, compared to CPubKey::Verify()
+BOOST_AUTO_TEST_CASE(sigbatch_bench_test) {
+    if (!IsBenchmarkEnabled()) {
+        BOOST_TEST_MESSAGE("sigbatch_bench_test skipped, pass -benchmark to run it");
+        return;
+    }
+
+    static const size_t TOTAL_COUNT = 4096;
+    vector<CSignatureItem> items;
+    MakeSignatureItems(TOTAL_COUNT, 64, items);
+
+    int64_t beginTime = GetTimeMicros();
+    for (const auto &item : items)
+        BOOST_CHECK(item.pubKey.Verify(item.sigHash, item.signature));
+    int64_t singleTime = GetTimeMicros() - beginTime;
+    BOOST_TEST_MESSAGE(strprintf("CPubKey::Verify: %.2fus/sig", singleTime * 1.0 / TOTAL_COUNT));
+
+    for (size_t batchSize : {1, 16, 256, 4096}) {
+        vector<bool> results;
+        beginTime = GetTimeMicros();
+        for (size_t begin = 0; begin < TOTAL_COUNT; begin += batchSize) {
+            vector<CSignatureItem> batch(items.begin() + begin, items.begin() + begin + batchSize);
+            BOOST_CHECK(VerifySignatureBatch(batch, results));
+        }
+        int64_t batchTime = GetTimeMicros() - beginTime;
+        BOOST_TEST_MESSAGE(strprintf("VerifySignatureBatch(batch=%u): %.2fus/sig", batchSize,
+                                     batchTime * 1.0 / TOTAL_COUNT));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,164 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <boost/test/unit_test.hpp>
+#include "persistence/dbaccess.h"
+#include "persistence/snapshot.h"
+
+using namespace std;
+
+struct FSnapshotTests {
+    FSnapshotTests() {
+        root_dir = "/tmp/coind_unit_test";
+        if (!boost::filesystem::exists(root_dir))
+            BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(root_dir));
+
+        test_dir = root_dir / "snapshot_tests";
+        BOOST_CHECK_MESSAGE(!boost::filesystem::exists(test_dir), "must remove dir " + test_dir.string() + " first");
+        BOOST_CHECK_NO_THROW(boost::filesystem::create_directories(test_dir / "src"));
+        BOOST_CHECK_NO_THROW(boost::filesystem::create_directories(test_dir / "dst"));
+
+        const bool isWipe = true;
+        pSrcAccountDb = make_shared<CDBAccess>(test_dir / "src", DBNameType::ACCOUNT, false, isWipe);
+        pSrcCdpDb     = make_shared<CDBAccess>(test_dir / "src", DBNameType::CDP, false, isWipe);
+        pDstAccountDb = make_shared<CDBAccess>(test_dir / "dst", DBNameType::ACCOUNT, false, isWipe);
+        pDstCdpDb     = make_shared<CDBAccess>(test_dir / "dst", DBNameType::CDP, false, isWipe);
+
+        map<string, string> accountData;
+        accountData["regid-1"] = "keyid-1";
+        accountData["regid-2"] = "keyid-2";
+        accountData["regid-3"] = "keyid-3";
+        pSrcAccountDb->BatchWrite<string, string>(dbk::REGID_KEYID, accountData);
+        map<string, string> cdpData;
+        cdpData["regid-1"] = "cdpid-1";
+        cdpData["regid-2"] = "cdpid-2";
+        pSrcCdpDb->BatchWrite<string, string>(dbk::REGID_CDP, cdpData);
+
+        path = (test_dir / "snapshot.dat").string();
+    }
+    ~FSnapshotTests() {
+        pSrcAccountDb.reset();
+        pSrcCdpDb.reset();
+        pDstAccountDb.reset();
+        pDstCdpDb.reset();
+        BOOST_CHECK_NO_THROW(boost::filesystem::remove_all(test_dir));
+    }
+
+    bool Dump(CSnapshotInfo &info) {
+        info.header.height    = 1;
+        info.header.blockHash = uint256S("1");
+        return WriteSnapshotFile(path, {{pSrcAccountDb.get(), nullptr}, {pSrcCdpDb.get(), nullptr}}, nullptr, info);
+    }
+
+    bool Load(const string &file, CSnapshotInfo &info) {
+        return ReadSnapshotFile(file, {pDstAccountDb.get(), pDstCdpDb.get()}, nullptr, nullptr, info);
+    }
+
+    boost::filesystem::path root_dir;
+    boost::filesystem::path test_dir;
+    string path;
+    shared_ptr<CDBAccess> pSrcAccountDb;
+    shared_ptr<CDBAccess> pSrcCdpDb;
+    shared_ptr<CDBAccess> pDstAccountDb;
+    shared_ptr<CDBAccess> pDstCdpDb;
+};
+
+static void ReadChunks(const string &path, CSnapshotHeader &header, vector<CSnapshotChunk> &chunks) {
+    CAutoFile filein(fopen(path.c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    filein >> header;
+    do {
+        chunks.emplace_back();
+        filein >> chunks.back();
+    } while (chunks.back().type != SNAPSHOT_CHUNK_END);
+}
+
+static void WriteChunks(const string &path, const CSnapshotHeader &header, const vector<CSnapshotChunk> &chunks) {
+    CAutoFile fileout(fopen(path.c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    fileout << header;
+    for (const auto &chunk : chunks)
+        fileout << chunk;
+}
+
+BOOST_FIXTURE_TEST_SUITE(snapshot_tests, FSnapshotTests)
+
+BOOST_AUTO_TEST_CASE(snapshot_round_trip_test)
+{
+    CSnapshotInfo dumpInfo;
+    BOOST_CHECK(Dump(dumpInfo));
+    BOOST_CHECK(dumpInfo.records == 5);
+    BOOST_CHECK(dumpInfo.chunks == 2);
+
+    CSnapshotInfo loadInfo;
+    BOOST_CHECK(Load(path, loadInfo));
+    BOOST_CHECK(loadInfo.header.height == 1 && loadInfo.header.blockHash == uint256S("1"));
+    BOOST_CHECK(loadInfo.records == dumpInfo.records);
+    BOOST_CHECK(loadInfo.stateCommitment == dumpInfo.stateCommitment);
+
+    string value;
+    BOOST_CHECK(pDstAccountDb->GetData(dbk::REGID_KEYID, string("regid-3"), value) && value == "keyid-3");
+    BOOST_CHECK(pDstCdpDb->GetData(dbk::REGID_CDP, string("regid-1"), value) && value == "cdpid-1");
+
+    // the same state always gives the same commitment
+    uint256 commitment;
+    BOOST_CHECK(ComputeStateCommitment({pSrcAccountDb.get(), pSrcCdpDb.get()}, commitment));
+    BOOST_CHECK(commitment == dumpInfo.stateCommitment);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_tamper_test)
+{
+    CSnapshotInfo dumpInfo;
+    BOOST_CHECK(Dump(dumpInfo));
+
+    CSnapshotHeader header;
+    vector<CSnapshotChunk> chunks;
+    ReadChunks(path, header, chunks);
+    BOOST_CHECK(chunks.size() == 3 && chunks[0].type == SNAPSHOT_CHUNK_DB_RECORDS);
+
+    // the changed data without its hash is rejected as a corrupted chunk
+    const string corruptedPath = path + ".corrupted";
+    vector<CSnapshotChunk> corruptedChunks = chunks;
+    corruptedChunks[0].data.back() ^= 1;
+    WriteChunks(corruptedPath, header, corruptedChunks);
+    CSnapshotInfo loadInfo;
+    BOOST_CHECK(!Load(corruptedPath, loadInfo));
+
+    // the changed data with its hash rewritten is rejected by the state commitment
+    const string tamperedPath = path + ".tampered";
+    vector<CSnapshotChunk> tamperedChunks = chunks;
+    tamperedChunks[0].data.back() ^= 1;
+    tamperedChunks[0].hash = tamperedChunks[0].ComputeHash();
+    WriteChunks(tamperedPath, header, tamperedChunks);
+    loadInfo = CSnapshotInfo();
+    BOOST_CHECK(!Load(tamperedPath, loadInfo));
+    BOOST_CHECK(loadInfo.stateCommitment != dumpInfo.stateCommitment);
+
+    // the dropped chunk is rejected by the chunk count
+    const string truncatedPath = path + ".truncated";
+    vector<CSnapshotChunk> truncatedChunks = {chunks[0], chunks[2]};
+    WriteChunks(truncatedPath, header, truncatedChunks);
+    loadInfo = CSnapshotInfo();
+    BOOST_CHECK(!Load(truncatedPath, loadInfo));
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_stale_records_test)
+{
+    CSnapshotInfo dumpInfo;
+    BOOST_CHECK(Dump(dumpInfo));
+
+    // the records left in the target dbs don't match the state commitment
+    map<string, string> staleData;
+    staleData["regid-9"] = "keyid-9";
+    pDstAccountDb->BatchWrite<string, string>(dbk::REGID_KEYID, staleData);
+
+    CSnapshotInfo loadInfo;
+    BOOST_CHECK(!Load(path, loadInfo));
+    BOOST_CHECK(loadInfo.stateCommitment != dumpInfo.stateCommitment);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -75,7 +75,7 @@ bool CBlockPriceMedianTx::ExecuteTx(CTxExecuteContext &context) {
             break;
         }
 
-        // 2. get all CDPs to be force settled
+        // 2. get CDPs to be force settled
         RatioCDPIdCache::Map cdpMap;
         uint64_t forceLiquidateRatio = 0;
         if (!cw.sysParamCache.GetParam(SysParamType::CDP_FORCE_LIQUIDATE_RATIO, forceLiquidateRatio)) {
@@ -83,7 +83,30 @@ bool CBlockPriceMedianTx::ExecuteTx(CTxExecuteContext &context) {
                             READ_SYS_PARAM_FAIL, "read-force-liquidate-ratio-error");
         }
 
-        cw.cdpCache.GetCdpListByCollateralRatio(forceLiquidateRatio, bcoinMedianPrice, cdpMap);
+        NET_TYPE netType = SysCfg().NetworkID();
+        bool compatMode  = (netType == TEST_NET && context.height < 1800000);
+        if (compatMode) {
+            if (!cw.cdpCache.GetCdpListByCollateralRatio(forceLiquidateRatio, bcoinMedianPrice, cdpMap)) {
+                return state.DoS(100, ERRORMSG("CBlockPriceMedianTx::ExecuteTx, get cdp list by collateral ratio failed"),
+                                 REJECT_INVALID, "load-cdp-ratio-index-error");
+            }
+        } else {
+            // only the CDPs which can be settled in this block are read, the cursor is done before the CDPs
+            // are changed below
+            CUserCDP cdp;
+            CCdpRatioCursor cursor(cw.cdpCache, forceLiquidateRatio, bcoinMedianPrice);
+            if (cursor.IsFailed()) {
+                return state.DoS(100, ERRORMSG("CBlockPriceMedianTx::ExecuteTx, load cdp ratio index failed"),
+                                 REJECT_INVALID, "load-cdp-ratio-index-error");
+            }
+            for (; cursor.IsValid() && cdpMap.size() < FORCE_SETTLE_CDP_MAX_COUNT_PER_BLOCK; cursor.Next()) {
+                if (!cursor.GetCdp(cdp)) {
+                    return state.DoS(100, ERRORMSG("CBlockPriceMedianTx::ExecuteTx, cdp (%s) not exist",
+                                    std::get<2>(cursor.GetKey()).ToString()), REJECT_INVALID, "cdp-not-exist");
+                }
+                cdpMap.emplace(cursor.GetKey(), cdp);
+            }
+        }
 
         LogPrint(BCLog::CDP, "CBlockPriceMedianTx::ExecuteTx, tx_cord=%d-%d, globalCollateralRatioFloor: %llu, bcoinMedianPrice: %llu, "
                 "forceLiquidateRatio: %llu, cdpMap: %llu\n", context.height, context.index,
@@ -101,8 +124,7 @@ bool CBlockPriceMedianTx::ExecuteTx(CTxExecuteContext &context) {
             }
         }
 
-        NET_TYPE netType = SysCfg().NetworkID();
-        if (netType == TEST_NET && context.height < 1800000) { // soft fork to compat old data of testnet
+        if (compatMode) { // soft fork to compat old data of testnet
             // TODO: remove me if reset testnet.
             return ForceLiquidateCDPCompat(context, bcoinMedianPrice, fcoinMedianPrice, cdpMap);
         }
@@ -144,7 +144,8 @@ bool CDEXOrderBaseTx::CheckOrderOperator(CTxExecuteContext &context, const strin
                 operator_signature.size()), REJECT_INVALID, "bad-operator-sig-size");
         }
         uint256 sighash = GetHash();
-        if (!VerifySignature(sighash, operator_signature, operatorAccount.owner_pubkey)) {
+        if (!context.skip_signature_check &&
+            !VerifySignature(sighash, operator_signature, operatorAccount.owner_pubkey)) {
             return context.pState->DoS(100, ERRORMSG("%s, check operator signature error",
                 title), REJECT_INVALID, "bad-operator-signature");
         }
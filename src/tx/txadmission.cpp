@@ -0,0 +1,323 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txadmission.h"
+
+#include "main.h"
+#include "net.h"
+#include "sigcache.h"
+#include "tx/einvalidtxtype.h"
+
+void CTxAdmissionQueue::Start(int32_t checkThreadCount) {
+    Stop();
+    if (checkThreadCount <= 0)
+        return;
+
+    std::unique_lock<std::mutex> lock(mtx);
+    fStop    = false;
+    fStarted = true;
+    threads.emplace_back(&CTxAdmissionQueue::ThreadAccept, this);
+    for (int32_t i = 0; i < checkThreadCount; ++i) {
+        threads.emplace_back(&CTxAdmissionQueue::ThreadCheck, this);
+    }
+}
+
+void CTxAdmissionQueue::Stop() {
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        fStop    = true;
+        fStarted = false;
+    }
+    cvCheck.notify_all();
+    cvAccept.notify_all();
+    cvSpace.notify_all();
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+
+    // the txs left are dropped, the peers will announce them again
+    std::deque<std::shared_ptr<CItem>> itemsLeft;
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        itemsLeft.swap(items);
+        checkQueue.clear();
+    }
+    for (const auto &spItem : itemsLeft) {
+        if (spItem->pFrom != nullptr)
+            ReleaseNode(spItem->pFrom);
+    }
+}
+
+bool CTxAdmissionQueue::IsStarted() const {
+    std::unique_lock<std::mutex> lock(mtx);
+    return fStarted;
+}
+
+bool CTxAdmissionQueue::Submit(CNode *pFrom, const std::string &command,
+                               const std::shared_ptr<CDataStream> &spTxData) {
+    auto spItem      = std::make_shared<CItem>();
+    spItem->pFrom    = pFrom;
+    spItem->command  = command;
+    spItem->spTxData = spTxData;
+    {
+        LOCK(cs_vNodes);
+        pFrom->AddRef();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (!fStop && items.size() < MAX_ADMISSION_TXS) {
+            items.push_back(spItem);
+            checkQueue.push_back(spItem);
+            spItem = nullptr;
+        } else {
+            stats.droppedTxs++;
+        }
+    }
+
+    if (spItem != nullptr) {
+        ReleaseNode(pFrom);
+        return false;
+    }
+    cvCheck.notify_one();
+    return true;
+}
+
+void CTxAdmissionQueue::Submit(const std::shared_ptr<CBaseTx> &spTx) {
+    auto spItem  = std::make_shared<CItem>();
+    spItem->spTx = spTx;
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cvSpace.wait(lock, [this] { return fStop || items.size() < MAX_ADMISSION_TXS; });
+        if (fStop)
+            return;
+
+        items.push_back(spItem);
+        checkQueue.push_back(spItem);
+    }
+    cvCheck.notify_one();
+}
+
+uint32_t CTxAdmissionQueue::PreVerifySignatures(const vector<std::shared_ptr<CBaseTx>> &txs) {
+    vector<CSignatureItem> sigItems;
+    sigItems.reserve(txs.size());
+    for (const auto &spTx : txs) {
+        if (spTx == nullptr || spTx->IsBlockRewardTx() || spTx->IsPriceMedianTx() || spTx->signature.empty())
+            continue;
+
+        CSignatureItem sigItem;
+        if (spTx->txUid.is<CPubKey>()) {
+            sigItem.pubKey = spTx->txUid.get<CPubKey>();
+        } else if (!blockPipeline.GetOwnerPubKey(spTx->txUid, sigItem.pubKey)) {
+            continue;
+        }
+
+        sigItem.sigHash   = spTx->GetHash();
+        sigItem.signature = spTx->signature;
+        if (!signatureCache.Get(sigItem.sigHash, sigItem.signature, sigItem.pubKey))
+            sigItems.push_back(std::move(sigItem));
+    }
+
+    vector<bool> results;
+    VerifySignatureBatch(sigItems, results);
+    for (size_t i = 0; i < sigItems.size(); ++i) {
+        if (results[i])
+            signatureCache.Set(sigItems[i].sigHash, sigItems[i].signature, sigItems[i].pubKey);
+    }
+
+    return sigItems.size();
+}
+
+CTxAdmissionStats CTxAdmissionQueue::GetStats() const {
+    std::unique_lock<std::mutex> lock(mtx);
+    CTxAdmissionStats ret = stats;
+    ret.checkQueueDepth   = checkQueue.size();
+    ret.acceptQueueDepth  = items.size() - checkQueue.size();
+    return ret;
+}
+
+void CTxAdmissionQueue::ThreadCheck() {
+    RenameThread("coin-txcheck");
+
+    while (true) {
+        vector<std::shared_ptr<CItem>> batch;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cvCheck.wait(lock, [this] { return fStop || !checkQueue.empty(); });
+            if (fStop)
+                return;
+
+            while (!checkQueue.empty() && batch.size() < MAX_ADMISSION_CHECK_BATCH) {
+                batch.push_back(checkQueue.front());
+                checkQueue.pop_front();
+            }
+        }
+
+        int64_t nStart = GetTimeMicros();
+        vector<std::shared_ptr<CBaseTx>> txs;
+        txs.reserve(batch.size());
+        for (const auto &spItem : batch) {
+            if (spItem->spTxData != nullptr)
+                DecodeTx(*spItem);
+
+            // no need to verify the signature of the tx in the mempool again
+            if (spItem->spTx != nullptr && !mempool.Exists(spItem->spTx->GetHash()))
+                txs.push_back(spItem->spTx);
+        }
+        uint32_t sigCount = PreVerifySignatures(txs);
+
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            for (const auto &spItem : batch) {
+                spItem->fChecked = true;
+            }
+            stats.checkedTxs += batch.size();
+            stats.checkedSignatures += sigCount;
+            stats.checkTime += GetTimeMicros() - nStart;
+        }
+        cvAccept.notify_one();
+    }
+}
+
+void CTxAdmissionQueue::ThreadAccept() {
+    RenameThread("coin-txaccept");
+
+    while (true) {
+        vector<std::shared_ptr<CItem>> batch;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cvAccept.wait(lock, [this] { return fStop || (!items.empty() && items.front()->fChecked); });
+            if (fStop)
+                return;
+
+            while (!items.empty() && items.front()->fChecked && batch.size() < MAX_ADMISSION_ACCEPT_BATCH) {
+                batch.push_back(items.front());
+                items.pop_front();
+            }
+        }
+        cvSpace.notify_all();
+
+        try {
+            AcceptTxs(batch);
+        } catch (std::exception &e) {
+            PrintExceptionContinue(&e, "CTxAdmissionQueue::ThreadAccept()");
+        } catch (...) {
+            PrintExceptionContinue(nullptr, "CTxAdmissionQueue::ThreadAccept()");
+        }
+
+        for (const auto &spItem : batch) {
+            if (spItem->pFrom != nullptr)
+                ReleaseNode(spItem->pFrom);
+        }
+    }
+}
+
+void CTxAdmissionQueue::DecodeTx(CItem &item) {
+    std::shared_ptr<CBaseTx> spTx;
+    try {
+        *item.spTxData >> spTx;
+    } catch (EInvalidTxType &e) {
+        Misbehaving(item.pFrom->GetId(), 10);
+        ERRORMSG("Unknown transaction type from peer %s, ignore! %s", item.pFrom->addr.ToString(), e.what());
+        return;
+    } catch (std::exception &e) {
+        LogPrint(BCLog::INFO, "CTxAdmissionQueue::DecodeTx() : decode the tx from peer %s failed: %s\n",
+                 item.pFrom->addr.ToString(), e.what());
+        item.pFrom->PushMessage(NetMsgType::REJECT, item.command, REJECT_MALFORMED, string("error parsing message"));
+        return;
+    }
+    item.spTxData = nullptr;
+
+    if (spTx->IsBlockRewardTx() || spTx->IsCoinRewardTx() || spTx->IsPriceMedianTx()) {
+        ERRORMSG("Forbidden transaction from network from peer %s, txid: %s", item.pFrom->addr.ToString(),
+                 spTx->GetHash().GetHex());
+        return;
+    }
+
+    item.pFrom->AddInventoryKnown(CInv(MSG_TX, spTx->GetHash()));
+    item.spTx = spTx;
+}
+
+void CTxAdmissionQueue::AcceptTxs(const vector<std::shared_ptr<CItem>> &batch) {
+    vector<CValidationState> states(batch.size());
+    vector<bool> accepted(batch.size(), false);
+    vector<std::shared_ptr<CBaseTx>> relayTxs;
+    int64_t nStart = 0;
+    size_t poolSize = 0;
+    {
+        LOCK(cs_main);
+        nStart = GetTimeMicros();
+        for (size_t i = 0; i < batch.size(); ++i) {
+            const auto &spTx = batch[i]->spTx;
+            if (spTx == nullptr)
+                continue;
+
+            if (!AcceptToMemoryPool(mempool, states[i], spTx.get(), true))
+                continue;
+
+            accepted[i] = true;
+            relayTxs.push_back(spTx);
+            if (batch[i]->pFrom != nullptr)
+                mapAlreadyAskedFor.erase(CInv(MSG_TX, spTx->GetHash()));
+
+            // keep the owner pubkey so the signatures of the next txs of the account are checked ahead
+            CAccount account;
+            if (!spTx->txUid.is<CPubKey>() && mempool.cw->accountCache.GetAccount(spTx->txUid, account) &&
+                account.owner_pubkey.IsFullyValid())
+                blockPipeline.AddOwnerPubKey(spTx->txUid, account.owner_pubkey);
+        }
+        poolSize = mempool.memPoolTxs.size();
+    }
+    int64_t acceptTime = GetTimeMicros() - nStart;
+
+    // the accepted txs are announced to every peer in one pass, they are sent in the next inv message
+    RelayTransactions(relayTxs);
+
+    uint32_t rejectedCount = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const CItem &item = *batch[i];
+        if (item.spTx == nullptr)
+            continue;
+
+        const uint256 &txid = item.spTx->GetHash();
+        if (item.pFrom == nullptr) {
+            if (!accepted[i]) {
+                rejectedCount++;
+                LogPrint(BCLog::INFO, "CTxAdmissionQueue, accept the local tx %s to mempool failed: %s\n",
+                         txid.ToString(), states[i].GetRejectReason());
+            }
+            continue;
+        }
+
+        if (accepted[i]) {
+            LogPrint(BCLog::INFO, "AcceptToMemoryPool: %s %s : accepted %s (poolsz %u)\n",
+                     item.pFrom->addr.ToString(), item.pFrom->cleanSubVer, txid.ToString(), poolSize);
+            continue;
+        }
+
+        rejectedCount++;
+        int32_t nDoS = 0;
+        if (states[i].IsInvalid(nDoS)) {
+            LogPrint(BCLog::INFO, "%s [%d] from %s %s was not accepted into the memory pool: %s\n", txid.ToString(),
+                     item.spTx->valid_height, item.pFrom->addr.ToString(), item.pFrom->cleanSubVer,
+                     states[i].GetRejectReason());
+
+            item.pFrom->PushMessage(NetMsgType::REJECT, item.command, states[i].GetRejectCode(),
+                                    states[i].GetRejectReason(), txid);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mtx);
+    stats.acceptBatches++;
+    stats.acceptedTxs += relayTxs.size();
+    stats.rejectedTxs += rejectedCount;
+    stats.acceptTime += acceptTime;
+}
+
+void CTxAdmissionQueue::ReleaseNode(CNode *pNode) {
+    LOCK(cs_vNodes);
+    pNode->Release();
+}
@@ -0,0 +1,104 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TX_ADMISSION_H
+#define TX_ADMISSION_H
+
+#include "commons/serialize.h"
+#include "tx.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CNode;
+
+/** Maximum number of the tx check threads */
+static const int32_t MAX_TX_CHECK_THREADS = 8;
+/** -txcheckthreads default (number of the threads to decode and check the received txs, 0 = disabled) */
+static const int32_t DEFAULT_TX_CHECK_THREADS = 2;
+/** Maximum number of the txs in the queue, the txs received from peers are dropped when it is full */
+static const uint32_t MAX_ADMISSION_TXS = 20000;
+/** Maximum number of the txs taken by a check thread at a time to verify their signatures in a batch */
+static const uint32_t MAX_ADMISSION_CHECK_BATCH = 64;
+/** Maximum number of the txs accepted to the mempool with one cs_main acquisition */
+static const uint32_t MAX_ADMISSION_ACCEPT_BATCH = 256;
+
+struct CTxAdmissionStats {
+    uint32_t checkQueueDepth   = 0;  // the txs waiting to be checked
+    uint32_t acceptQueueDepth  = 0;  // the txs checked or being checked, waiting to be accepted
+    uint64_t droppedTxs        = 0;  // the txs from peers dropped since the queue is full
+    uint64_t checkedTxs        = 0;
+    uint64_t checkedSignatures = 0;
+    int64_t checkTime          = 0;  // in micros, decoding and checking
+    uint64_t acceptBatches     = 0;
+    uint64_t acceptedTxs       = 0;
+    uint64_t rejectedTxs       = 0;
+    int64_t acceptTime         = 0;  // in micros, holding cs_main to accept the batches
+};
+
+/**
+ * The admission of the txs to the mempool. The check stage decodes the txs and verifies their
+ * signatures into the signature cache on worker threads without cs_main. The accept stage takes the
+ * checked txs in the receiving order and accepts up to MAX_ADMISSION_ACCEPT_BATCH of them with one
+ * cs_main acquisition, then relays the accepted ones together, so the block processing is not starved
+ * by the per-tx locking under a tx flood.
+ *
+ * Like the block pipeline, the check stage never rejects a tx, AcceptToMemoryPool() does the full
+ * validation as before and only finds the signatures in the cache.
+ */
+class CTxAdmissionQueue {
+public:
+    CTxAdmissionQueue() {}
+    ~CTxAdmissionQueue() { Stop(); }
+
+    // start the accept thread and the check threads, nothing is started when checkThreadCount <= 0
+    void Start(int32_t checkThreadCount);
+    void Stop();
+    bool IsStarted() const;
+
+    // queue the tx message received from the peer, the tx is dropped if the queue is full
+    bool Submit(CNode *pFrom, const std::string &command, const std::shared_ptr<CDataStream> &spTxData);
+    // queue the tx created locally, waits if the queue is full
+    void Submit(const std::shared_ptr<CBaseTx> &spTx);
+
+    // verify the signatures of the txs signed by the owner of txUid whose pubkey is known without
+    // cs_main, the valid ones are kept in the signature cache. Return the count of the verified ones.
+    static uint32_t PreVerifySignatures(const std::vector<std::shared_ptr<CBaseTx>> &txs);
+
+    CTxAdmissionStats GetStats() const;
+
+private:
+    struct CItem {
+        CNode *pFrom = nullptr;  // nullptr if created locally
+        std::string command;
+        std::shared_ptr<CDataStream> spTxData;
+        std::shared_ptr<CBaseTx> spTx;  // nullptr if failed to decode or forbidden
+        bool fChecked = false;
+    };
+
+    void ThreadCheck();
+    void ThreadAccept();
+    void DecodeTx(CItem &item);
+    void AcceptTxs(const std::vector<std::shared_ptr<CItem>> &batch);
+    void ReleaseNode(CNode *pNode);
+
+    mutable std::mutex mtx;
+    std::condition_variable cvCheck;   // a tx is submitted
+    std::condition_variable cvAccept;  // a tx is checked
+    std::condition_variable cvSpace;   // a batch is taken by the accept stage
+    std::vector<std::thread> threads;
+    bool fStarted = false;
+    bool fStop    = false;
+
+    std::deque<std::shared_ptr<CItem>> checkQueue;  // the txs to be checked
+    std::deque<std::shared_ptr<CItem>> items;       // all txs in the queue in receiving order
+    CTxAdmissionStats stats;
+};
+
+#endif  // TX_ADMISSION_H
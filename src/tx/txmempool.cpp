@@ -12,12 +12,27 @@
 
 using namespace std;
 
+bool TxPriority::operator<(const TxPriority &other) const {
+    int64_t priorityClass      = GetPriorityClass(this->priority);
+    int64_t otherPriorityClass = GetPriorityClass(other.priority);
+    if (priorityClass != otherPriorityClass)
+        return priorityClass < otherPriorityClass;
+
+    if (this->feePerKb != other.feePerKb)
+        return this->feePerKb < other.feePerKb;
+
+    return this->baseTx->GetHash() < other.baseTx->GetHash();
+}
+
 CTxMemPoolEntry::CTxMemPoolEntry() {
     nTxSize   = 0;
     dPriority = 0.0;
+    dFeePerKb = 0.0;
 
     nTime   = 0;
     height = 0;
+
+    accessHeight = 0;
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(CBaseTx *pBaseTx, int64_t time, uint32_t height) : nTime(time), height(height) {
@@ -25,6 +40,9 @@ CTxMemPoolEntry::CTxMemPoolEntry(CBaseTx *pBaseTx, int64_t time, uint32_t height
     nFees     = pTx->GetFees();
     nTxSize   = ::GetSerializeSize(*pTx, SER_NETWORK, PROTOCOL_VERSION);
     dPriority = pTx->GetPriority();
+    dFeePerKb = 0.0;
+
+    accessHeight = 0;
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry &other) {
@@ -32,9 +50,19 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry &other) {
     this->nFees     = other.nFees;
     this->nTxSize   = other.nTxSize;
     this->dPriority = other.dPriority;
+    this->dFeePerKb = other.dFeePerKb;
 
-    this->nTime  = other.nTime;
-    this->height = other.height;
+    this->nTime       = other.nTime;
+    this->height      = other.height;
+    this->senderKeyId = other.senderKeyId;
+
+    this->spAccessLog  = other.spAccessLog;
+    this->accessHeight = other.accessHeight;
+}
+
+void CTxMemPoolEntry::SetFeePerKb(int32_t height, uint32_t fuelRate) {
+    double fuel = pTx->GetFuel(height, fuelRate);
+    dFeePerKb   = (std::get<1>(nFees) - fuel) / nTxSize * 1000.0;
 }
 
 CTxMemPool::CTxMemPool() {
@@ -42,29 +70,168 @@ CTxMemPool::CTxMemPool() {
     // accepting transactions becomes O(N^2) where N is the number
     // of transactions in the pool
     fSanityCheck         = false;
+    totalTxSize          = 0;
+    maxTxSize            = DEFAULT_MAX_MEMPOOL_SIZE << 20;
+    expiry               = DEFAULT_MEMPOOL_EXPIRY * 60 * 60;
+    nLastRechecked       = 0;
+    nLastSkipped         = 0;
+    nTotalRechecked      = 0;
+    nTotalSkipped        = 0;
+}
+
+// The txs whose execution reads nothing but the state keys recorded in their access logs and the
+// feature fork version. The others also read the block height, time or fuel rate, the price points,
+// the tx cache or the dbs bypassing the cache wrapper (e.g. the dex order iterator of the dex txs and
+// the global account cache of the dex operator txs), they are always executed again after the tip
+// changed.
+static bool IsTipIndependentTx(const CBaseTx *pBaseTx) {
+    switch (pBaseTx->nTxType) {
+        case BCOIN_TRANSFER_TX:
+        case UCOIN_TRANSFER_TX:
+        case UCOIN_STAKE_TX:
+            // the regid generated for an unregistered sender is made of the block height
+            return !pBaseTx->txUid.is<CPubKey>();
+        default:
+            return false;
+    }
+}
+
+// The price feed tx writes the price point cache, which keeps no redo logs, so it is always executed again
+// and the removal of it makes the txs reading the tip executed again.
+static bool HasUntrackedWrites(const CBaseTx *pBaseTx) {
+    return pBaseTx->nTxType == PRICE_FEED_TX;
+}
+
+void CTxMemPool::SetLimits(uint64_t maxTxSizeIn, int64_t expiryIn) {
+    LOCK(cs);
+    maxTxSize = maxTxSizeIn;
+    expiry    = expiryIn;
+}
+
+map<uint256, CTxMemPoolEntry>::iterator CTxMemPool::RemoveEntry(map<uint256, CTxMemPoolEntry>::iterator it) {
+    const CTxMemPoolEntry &entry = it->second;
+    const uint256 &txid          = it->first;
+
+    txPriorities.erase(TxPriority(entry.GetPriority(), entry.GetFeePerKb(), entry.GetTransaction()));
+    txTimes.erase(make_pair(entry.GetTime(), txid));
+
+    auto senderIt = senderTxs.find(entry.GetSenderKeyId());
+    if (senderIt != senderTxs.end()) {
+        senderIt->second.erase(txid);
+        if (senderIt->second.empty())
+            senderTxs.erase(senderIt);
+    }
+
+    totalTxSize -= entry.GetTxSize();
+
+    // the txs reading the values written by the removed tx must be executed again
+    if (entry.GetAccessLog())
+        MergeWrittenKeys(*entry.GetAccessLog());
+    if (HasUntrackedWrites(entry.GetTransaction().get()))
+        rescanTipHash.SetNull();
+
+    return memPoolTxs.erase(it);
+}
+
+bool CTxMemPool::Trim(int64_t now) {
+    uint64_t oldSize = memPoolTxs.size();
+    while (!txTimes.empty() && txTimes.begin()->first + expiry < now) {
+        uint256 txid = txTimes.begin()->second;
+        RemoveEntry(memPoolTxs.find(txid));
+        EraseTransaction(txid);
+        LogPrint(BCLog::DEBUG, "Trim() : txid: %s expired\n", txid.GetHex());
+    }
+
+    while (totalTxSize > maxTxSize && !txPriorities.empty()) {
+        uint256 txid = txPriorities.begin()->baseTx->GetHash();
+        RemoveEntry(memPoolTxs.find(txid));
+        EraseTransaction(txid);
+        LogPrint(BCLog::DEBUG, "Trim() : txid: %s evicted by size limit\n", txid.GetHex());
+    }
+    return memPoolTxs.size() != oldSize;
+}
+
+bool CTxMemPool::HasRoomFor(const CTxMemPoolEntry &entry) const {
+    uint64_t freeSize = maxTxSize > totalTxSize ? maxTxSize - totalTxSize : 0;
+    TxPriority priority(entry.GetPriority(), entry.GetFeePerKb(), entry.GetTransaction());
+    for (auto it = txPriorities.begin(); freeSize < entry.GetTxSize(); ++it) {
+        if (it == txPriorities.end() || !(*it < priority))
+            return false;
+
+        freeSize += memPoolTxs.find(it->baseTx->GetHash())->second.GetTxSize();
+    }
+    return true;
 }
 
 void CTxMemPool::Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &removed, bool fRecursive) {
     // Remove transaction from memory pool
     LOCK(cs);
     uint256 txid = pBaseTx->GetHash();
-    if (memPoolTxs.count(txid)) {
-        removed.push_front(std::shared_ptr<CBaseTx>(memPoolTxs[txid].GetTransaction()));
-        memPoolTxs.erase(txid);
+    auto it = memPoolTxs.find(txid);
+    if (it != memPoolTxs.end()) {
+        removed.push_front(std::shared_ptr<CBaseTx>(it->second.GetTransaction()));
+        RemoveEntry(it);
         EraseTransaction(txid);
     }
 }
 
-bool CTxMemPool::AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state) {
+void CTxMemPool::RemoveConfirmed(const uint256 &txid) {
+    LOCK(cs);
+    auto it = memPoolTxs.find(txid);
+    if (it != memPoolTxs.end())
+        RemoveEntry(it);
+}
+
+bool CTxMemPool::AddUnchecked(const uint256 &txid, CTxMemPoolEntry &entry, CValidationState &state) {
     // Add to memory pool without checking anything.
     // Used by main.cpp AcceptToMemoryPool(), which DOES
     // all the appropriate checks.
     LOCK(cs);
     {
+        // the expired txs make room first
+        if (Trim(GetTime()))
+            ReScanMemPoolTx();
+
+        // On a full mempool the tx must outrank the txs evicted for it. The fee rate without fuel is
+        // checked before the execution, the fuel can only lower it, and the fee rate with fuel after the
+        // execution, so a tx which would be evicted at once never writes the mempool cache.
+        int32_t height    = chainActive.Height() + 1;
+        uint32_t fuelRate = GetElementForBurn(chainActive.Tip());
+        entry.SetFeePerKb(height, 0);
+        if (!HasRoomFor(entry))
+            return state.Invalid(ERRORMSG("AddUnchecked() : txid: %s fee rate too low, mempool is full",
+                                 txid.GetHex()), REJECT_INSUFFICIENTFEE, "mempool-full");
+
         if (!CheckTxInMemPool(txid, entry, state))
             return false;
 
-        memPoolTxs.insert(make_pair(txid, entry));
+        entry.SetFeePerKb(height, fuelRate);
+        if (!HasRoomFor(entry)) {
+            spTxCw->Clear();
+            return state.Invalid(ERRORMSG("AddUnchecked() : txid: %s fee rate with fuel too low, mempool is full",
+                                 txid.GetHex()), REJECT_INSUFFICIENTFEE, "mempool-full");
+        }
+        spTxCw->Flush();
+
+        auto ret = memPoolTxs.insert(make_pair(txid, entry));
+        if (!ret.second)
+            return true;
+
+        CTxMemPoolEntry &newEntry = ret.first->second;
+        CKeyID senderKeyId;
+        if (cw->accountCache.GetKeyId(newEntry.GetTransaction()->txUid, senderKeyId)) {
+            newEntry.SetSenderKeyId(senderKeyId);
+            senderTxs[senderKeyId].insert(txid);
+        }
+
+        txPriorities.emplace(newEntry.GetPriority(), newEntry.GetFeePerKb(), newEntry.GetTransaction());
+        txTimes.emplace(newEntry.GetTime(), txid);
+        totalTxSize += newEntry.GetTxSize();
+
+        // the lower txs evicted for the new one have been executed into the mempool cache, which is
+        // rebuilt without them. Only the txs reading their writes are executed again, the tip is unchanged.
+        if (Trim(GetTime()))
+            ReScanMemPoolTx();
     }
     return true;
 }
@@ -79,7 +246,7 @@ void CTxMemPool::QueryHash(vector<uint256> &txids) {
     }
 }
 
-bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &memPoolEntry, CValidationState &state,
+bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, CTxMemPoolEntry &memPoolEntry, CValidationState &state,
                                   bool bExecute) {
     // is it within valid height
     static int validHeight = SysCfg().GetTxCacheHeight();
@@ -92,51 +259,167 @@ bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &me
         return state.Invalid(ERRORMSG("CheckTxInMemPool() : txid: %s has been confirmed", txid.GetHex()), REJECT_INVALID,
                              "tx-duplicate-confirmed");
 
-    auto spCW = std::make_shared<CCacheWrapper>(cw.get());
+    // discard the dirty data left by the last failed tx
+    spTxCw->Clear();
 
     if (bExecute) {
         CBlockIndex *pTip =  chainActive.Tip();
         uint32_t fuelRate  = GetElementForBurn(pTip);
         uint32_t blockTime = pTip->GetBlockTime();
         uint32_t prevBlockTime = pTip->pprev != nullptr ? pTip->pprev->GetBlockTime() : pTip->GetBlockTime();
-        CTxExecuteContext context(chainActive.Height(), 0, fuelRate, blockTime, prevBlockTime, spCW.get(), &state, wasm::transaction_status_type::validating);
-        if (!memPoolEntry.GetTransaction()->ExecuteTx(context)) {
+        CTxExecuteContext context(chainActive.Height(), 0, fuelRate, blockTime, prevBlockTime, spTxCw.get(), &state, wasm::transaction_status_type::validating);
+
+        // track the state keys of the tx, the undo logs are not needed
+        auto spAccessLog = std::make_shared<CDBOpLogMap>();
+        spAccessLog->SetAccessTracking(true);
+        spTxCw->SetDbOpLogMap(spAccessLog.get());
+        bool executed = memPoolEntry.GetTransaction()->ExecuteTx(context);
+        spTxCw->SetDbOpLogMap(nullptr);
+        spAccessLog->Clear();
+
+        if (!executed) {
             pCdMan->pLogCache->SetExecuteFail(chainActive.Height(), memPoolEntry.GetTransaction()->GetHash(),
                                               state.GetRejectCode(), state.GetRejectReason());
             return false;
         }
+        memPoolEntry.SetAccessLog(spAccessLog, chainActive.Height());
     }
 
-    spCW->Flush();
-
     return true;
 }
 
 void CTxMemPool::SetMemPoolCache() {
     cw.reset(new CCacheWrapper(pCdMan));
+    spTxCw = std::make_shared<CCacheWrapper>(cw.get());
 }
 
-void CTxMemPool::ReScanMemPoolTx() {
-    cw.reset(new CCacheWrapper(pCdMan));
+void CTxMemPool::AddChangedKeys(const CDBOpLogMap &flushLog) {
+    LOCK(cs);
+    MergeChangedKeys(flushLog.GetAccessKeys());
+    rescanTipHash.SetNull();
+}
 
+void CTxMemPool::MergeChangedKeys(const map<string, set<string>> &keys) {
+    for (const auto &item : keys)
+        changedKeys[item.first].insert(item.second.begin(), item.second.end());
+}
+
+void CTxMemPool::MergeWrittenKeys(const CDBOpLogMap &accessLog) {
+    for (const auto &item : accessLog.GetRedoLogs()) {
+        set<string> &keys = changedKeys[dbk::GetKeyPrefix(item.first)];
+        for (const auto &redoItem : item.second)
+            keys.insert(redoItem.first);
+    }
+}
+
+bool CTxMemPool::IsDependentOnChangedKeys(const CTxMemPoolEntry &entry) const {
+    auto spAccessLog = entry.GetAccessLog();
+    for (const auto &item : spAccessLog->GetAccessKeys()) {
+        auto changedIt = changedKeys.find(item.first);
+        if (changedIt == changedKeys.end())
+            continue;
+
+        // iterate the smaller set
+        const set<string> &smaller = item.second.size() < changedIt->second.size() ? item.second : changedIt->second;
+        const set<string> &larger  = item.second.size() < changedIt->second.size() ? changedIt->second : item.second;
+        for (const auto &key : smaller) {
+            if (larger.count(key))
+                return true;
+        }
+    }
+
+    for (const auto &prefix : spAccessLog->GetAccessPrefixes()) {
+        if (changedKeys.count(prefix))
+            return true;
+    }
+
+    return false;
+}
+
+void CTxMemPool::ReScanMemPoolTx() {
+    int64_t nStart = GetTimeMicros();
     LOCK(cs);
+    SetMemPoolCache();
+    Trim(GetTime());
+
+    // The txs are replayed in the order they entered the mempool. A tx is executed again if it
+    // reads the tip changed since the last rescan, has untracked writes, crosses a feature fork or
+    // accessed any changed key, then the keys it writes before and after are changed too, which makes
+    // the later txs depending on it executed again. The writes of the other txs are applied from their
+    // redo logs, so a rescan after an eviction at the same tip only executes the txs reading the
+    // evicted writes.
+    const uint256 tipHash = chainActive.Tip()->GetBlockHash();
+    UndoDataFuncMap redoFuncMap = cw->GetUndoDataFuncMap();
+    uint64_t recheckedCount = 0;
+    uint64_t skippedCount   = 0;
     CValidationState state;
-    for (map<uint256, CTxMemPoolEntry>::iterator iterTx = memPoolTxs.begin(); iterTx != memPoolTxs.end();) {
-        if (!CheckTxInMemPool(iterTx->first, iterTx->second, state, true)) {
-            uint256 txid = iterTx->first;
-            iterTx       = memPoolTxs.erase(iterTx++);
+    vector<uint256> txids;
+    txids.reserve(txTimes.size());
+    for (const auto &item : txTimes)
+        txids.push_back(item.second);
+
+    for (const auto &txid : txids) {
+        auto iterTx = memPoolTxs.find(txid);
+        CTxMemPoolEntry &entry = iterTx->second;
+        auto spOldAccessLog = entry.GetAccessLog();
+        const CBaseTx *pBaseTx = entry.GetTransaction().get();
+        // a removed tx with untracked writes clears rescanTipHash, the later txs reading the tip are affected
+        bool fTipChanged = rescanTipHash != tipHash;
+        bool fRecheck    = spOldAccessLog == nullptr || (fTipChanged && !IsTipIndependentTx(pBaseTx)) ||
+                           HasUntrackedWrites(pBaseTx) ||
+                           GetFeatureForkVersion(entry.GetAccessHeight()) != GetFeatureForkVersion(chainActive.Height()) ||
+                           IsDependentOnChangedKeys(entry);
+
+        if (!CheckTxInMemPool(txid, entry, state, fRecheck)) {
+            RemoveEntry(iterTx);
             EraseTransaction(txid);
             continue;
         }
-        ++iterTx;
+        spTxCw->Flush();
+
+        if (fRecheck) {
+            ++recheckedCount;
+            if (spOldAccessLog != nullptr)
+                MergeWrittenKeys(*spOldAccessLog);
+            MergeWrittenKeys(*entry.GetAccessLog());
+        } else {
+            ++skippedCount;
+            for (const auto &item : spOldAccessLog->GetRedoLogs()) {
+                CDbOpLogs redoLogs;
+                redoLogs.reserve(item.second.size());
+                for (const auto &redoItem : item.second)
+                    redoLogs.push_back(redoItem.second);
+
+                auto funcIt = redoFuncMap.find(item.first);
+                assert(funcIt != redoFuncMap.end());
+                funcIt->second(redoLogs, false);
+            }
+        }
     }
+
+    changedKeys.clear();
+    rescanTipHash = tipHash;
+
+    nLastRechecked = recheckedCount;
+    nLastSkipped   = skippedCount;
+    nTotalRechecked += recheckedCount;
+    nTotalSkipped += skippedCount;
+    if (SysCfg().IsBenchmark())
+        LogPrint(BCLog::INFO, "- Rescan mempool: %u rechecked, %u skipped: %.2fms\n", recheckedCount, skippedCount,
+                 0.001 * (GetTimeMicros() - nStart));
 }
 
 void CTxMemPool::Clear() {
     LOCK(cs);
 
     memPoolTxs.clear();
-    cw.reset(new CCacheWrapper(pCdMan));
+    txPriorities.clear();
+    txTimes.clear();
+    senderTxs.clear();
+    totalTxSize = 0;
+    changedKeys.clear();
+    rescanTipHash.SetNull();
+    SetMemPoolCache();
 }
 
 uint64_t CTxMemPool::Size() {
@@ -144,6 +427,11 @@ uint64_t CTxMemPool::Size() {
     return memPoolTxs.size();
 }
 
+uint64_t CTxMemPool::GetTotalTxSize() {
+    LOCK(cs);
+    return totalTxSize;
+}
+
 bool CTxMemPool::Exists(const uint256 txid) {
     LOCK(cs);
     return ((memPoolTxs.count(txid) != 0));
@@ -155,4 +443,13 @@ std::shared_ptr<CBaseTx> CTxMemPool::Lookup(const uint256 txid) const {
     if (i == memPoolTxs.end())
         return std::shared_ptr<CBaseTx>();
     return i->second.GetTransaction();
-}
\ No newline at end of file
+}
+
+void CTxMemPool::QuerySenderTxs(const CKeyID &keyId, vector<uint256> &txids) {
+    LOCK(cs);
+
+    txids.clear();
+    auto it = senderTxs.find(keyId);
+    if (it != senderTxs.end())
+        txids.assign(it->second.begin(), it->second.end());
+}
@@ -7,6 +7,7 @@
 #ifndef COIN_TXMEMPOOL_H
 #define COIN_TXMEMPOOL_H
 
+#include "config/scoin.h"
 #include "entities/account.h"
 #include "persistence/cachewrapper.h"
 #include "sync.h"
@@ -14,6 +15,7 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <set>
 
 using namespace std;
 
@@ -21,6 +23,11 @@ class CValidationState;
 class CBaseTx;
 class uint256;
 
+/** -maxmempool default, the total size (MB) of the serialized txs in mempool */
+static const int64_t DEFAULT_MAX_MEMPOOL_SIZE = 300;
+/** -mempoolexpiry default, the hours a tx may stay in mempool */
+static const int64_t DEFAULT_MEMPOOL_EXPIRY = 24;
+
 /*
  * CTxMemPool stores these:
  */
@@ -30,9 +37,15 @@ private:
     std::pair<TokenSymbol, uint64_t> nFees;  // Cached to avoid expensive parent-transaction lookups
     uint32_t nTxSize;                     // Cached to avoid recomputing tx size
     double dPriority;                     // Cached to avoid recomputing priority
+    double dFeePerKb;                     // Fees minus fuel per KB, set when entering the mempool
 
     int64_t nTime;     // Local time when entering the mempool
     uint32_t height;  // Chain height when entering the mempool
+    CKeyID senderKeyId;  // The keyid of the sender account, resolved when entering the mempool
+
+    // The state keys accessed and the values written by the last execution in mempool, and its height
+    std::shared_ptr<CDBOpLogMap> spAccessLog;
+    int32_t accessHeight;
 
 public:
     CTxMemPoolEntry(CBaseTx *ptx, int64_t time, uint32_t height);
@@ -44,9 +57,41 @@ public:
     inline std::pair<TokenSymbol, uint64_t> GetFees() const { return nFees; }
     inline uint32_t GetTxSize() const { return nTxSize; }
     inline double GetPriority() const { return dPriority; }
+    inline double GetFeePerKb() const { return dFeePerKb; }
+    void SetFeePerKb(int32_t height, uint32_t fuelRate);
 
     inline int64_t GetTime() const { return nTime; }
     inline uint32_t GetHeight() const { return height; }
+    inline const CKeyID &GetSenderKeyId() const { return senderKeyId; }
+    void SetSenderKeyId(const CKeyID &keyId) { senderKeyId = keyId; }
+
+    std::shared_ptr<CDBOpLogMap> GetAccessLog() const { return spAccessLog; }
+    inline int32_t GetAccessHeight() const { return accessHeight; }
+    void SetAccessLog(const std::shared_ptr<CDBOpLogMap> &spAccessLogIn, int32_t accessHeightIn) {
+        spAccessLog  = spAccessLogIn;
+        accessHeight = accessHeightIn;
+    }
+};
+
+/*
+ * The block packing order of a tx. The txs are compared by the class of their priority first,
+ * the txs within TRANSACTION_PRIORITY_CEILING of priority are in the same class, e.g. all the
+ * normal txs are in one class and the price feed txs are in a higher class. The txs of the same
+ * class are ordered by fee per KB.
+ */
+struct TxPriority {
+    double priority;
+    double feePerKb;
+    std::shared_ptr<CBaseTx> baseTx;
+
+    TxPriority(const double priorityIn, const double feePerKbIn, const std::shared_ptr<CBaseTx> &baseTxIn)
+        : priority(priorityIn), feePerKb(feePerKbIn), baseTx(baseTxIn) {}
+
+    static int64_t GetPriorityClass(double priority) {
+        return int64_t(priority / TRANSACTION_PRIORITY_CEILING);
+    }
+
+    bool operator<(const TxPriority &other) const;
 };
 
 /*
@@ -63,6 +108,11 @@ class CTxMemPool {
 public:
     mutable CCriticalSection cs;
     map<uint256, CTxMemPoolEntry > memPoolTxs;
+    // The indexes of memPoolTxs, they are maintained together with memPoolTxs by the methods below.
+    // The block packing walks txPriorities from the top down.
+    set<TxPriority> txPriorities;
+    set<std::pair<int64_t, uint256>> txTimes;   // (entering time, txid)
+    map<CKeyID, set<uint256>> senderTxs;        // sender keyid -> txids
     std::shared_ptr<CCacheWrapper> cw;
 
 public:
@@ -70,21 +120,62 @@ public:
 
 public:
     void SetSanityCheck(bool fSanityCheckIn) { fSanityCheck = fSanityCheckIn; }
-    bool AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state);
+    // Limit the total tx size to maxTxSizeIn bytes and the stay time of a tx to expiryIn seconds
+    void SetLimits(uint64_t maxTxSizeIn, int64_t expiryIn);
+    bool AddUnchecked(const uint256 &txid, CTxMemPoolEntry &entry, CValidationState &state);
     void Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &removed, bool fRecursive = false);
+    // Remove the tx confirmed by a block, the wallet is not notified
+    void RemoveConfirmed(const uint256 &txid);
     void QueryHash(vector<uint256> &txids);
-    bool CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state,
+    // Check the tx and execute it on spTxCw, the caller flushes its writes to cw
+    bool CheckTxInMemPool(const uint256 &txid, CTxMemPoolEntry &entry, CValidationState &state,
                           bool bExecute = true);
     void SetMemPoolCache();
+    // Record the state keys changed by the flush of a block connection or disconnection
+    void AddChangedKeys(const CDBOpLogMap &flushLog);
+    // Rebuild cw, executing again the txs depending on the changed keys or the changed tip, and applying
+    // the writes of the others
     void ReScanMemPoolTx();
     void Clear();
 
     uint64_t Size();
+    uint64_t GetTotalTxSize();
     bool Exists(const uint256 txid);
     std::shared_ptr<CBaseTx> Lookup(const uint256 txid) const;
+    void QuerySenderTxs(const CKeyID &keyId, vector<uint256> &txids);
+
+    // the tx counts of the last rescan and all rescans
+    uint64_t GetLastRecheckedCount() const { return nLastRechecked; }
+    uint64_t GetLastSkippedCount() const { return nLastSkipped; }
+    uint64_t GetTotalRecheckedCount() const { return nTotalRechecked; }
+    uint64_t GetTotalSkippedCount() const { return nTotalSkipped; }
+
+private:
+    map<uint256, CTxMemPoolEntry>::iterator RemoveEntry(map<uint256, CTxMemPoolEntry>::iterator it);
+    // Evict the expired txs and then the lowest priority txs beyond the size limit, true if any is evicted
+    bool Trim(int64_t now);
+    // Whether the tx fits in the size limit after evicting the txs of lower priority
+    bool HasRoomFor(const CTxMemPoolEntry &entry) const;
+    bool IsDependentOnChangedKeys(const CTxMemPoolEntry &entry) const;
+    void MergeChangedKeys(const map<string, set<string>> &keys);
+    void MergeWrittenKeys(const CDBOpLogMap &accessLog);
 
 private:
     bool fSanityCheck; // Normally false, true if -checkmempool or -regtest
+    uint64_t totalTxSize;
+    uint64_t maxTxSize;
+    int64_t expiry;
+
+    // prefix -> db keys changed since the last rescan
+    map<string, set<string>> changedKeys;
+    // the tip cw was rebuilt on by the last rescan, null after a block flush or a tx with untracked writes
+    // removed, the tip dependent txs are executed again then
+    uint256 rescanTipHash;
+    uint64_t nLastRechecked;
+    uint64_t nLastSkipped;
+    uint64_t nTotalRechecked;
+    uint64_t nTotalSkipped;
+    std::shared_ptr<CCacheWrapper> spTxCw; // the overlay of cw to execute tx, reused by all txs
 };
 
 
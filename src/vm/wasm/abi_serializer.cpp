@@ -8,10 +8,15 @@
 #include <wasm/types/asset.hpp>
 #include <wasm/types/varint.hpp>
 #include <wasm/wasm_log.hpp>
+#include <wasm/wasm_config.hpp>
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
 #include "commons/json/json_spirit_writer.h"
 
 using namespace boost;
@@ -74,6 +79,7 @@ namespace wasm {
     void abi_serializer::add_specialized_unpack_pack( const string &name,
                                                       std::pair <abi_serializer::unpack_function, abi_serializer::pack_function> unpack_pack ) {
         built_in_types[name] = std::move(unpack_pack);
+        resolve_types();
     }
 
     void abi_serializer::configure_built_in_types() {
@@ -125,6 +131,7 @@ namespace wasm {
 
         WASM_ASSERT(boost::starts_with(abi.version, "wasm::abi/1."), unsupport_abi_version_exception, "%s",
                     "ABI has an unsupported version");
+        resolved_types.clear();
         typedefs.clear();
         structs.clear();
         actions.clear();
@@ -164,6 +171,60 @@ namespace wasm {
                     "Duplicate table definition detected");
 
         validate(ctx);
+        resolve_types();
+    }
+
+    void abi_serializer::resolve_types() {
+        resolved_types.clear();
+
+        vector <type_name> pending;
+        for (const auto &t : typedefs) pending.push_back(t.first);
+        for (const auto &s : structs)  pending.push_back(s.first);
+        for (const auto &a : actions)  pending.push_back(a.second);
+        for (const auto &t : tables)   pending.push_back(t.second);
+
+        // add every type reachable from the abi, then link them, the nodes of the map do not move
+        while (!pending.empty()) {
+            type_name type = std::move(pending.back());
+            pending.pop_back();
+            if (resolved_types.count(type))
+                continue;
+
+            resolved_type &rt = resolved_types[type];
+            rt.rtype          = resolve_type(type);
+            auto ftype        = fundamental_type(rt.rtype);
+            auto btype        = built_in_types.find(ftype);
+            auto s_itr        = structs.end();
+            if (btype != built_in_types.end()) {
+                rt.built_in = &btype->second;
+                rt.array    = is_array(rt.rtype);
+                rt.optional = is_optional(rt.rtype);
+            } else if (is_array(rt.rtype) || is_optional(rt.rtype)) {
+                rt.array        = is_array(rt.rtype);
+                rt.optional     = !rt.array;
+                rt.element_type = ftype;
+                pending.push_back(ftype);
+            } else if ((s_itr = structs.find(rt.rtype)) != structs.end()) {
+                rt.st = &s_itr->second;
+                if (rt.st->base != type_name())
+                    pending.push_back(resolve_type(rt.st->base));
+                for (const auto &field : rt.st->fields)
+                    pending.push_back(_remove_bin_extension(field.type));
+            }
+        }
+
+        for (auto &item : resolved_types) {
+            resolved_type &rt = item.second;
+            if (rt.array || rt.optional) {
+                if (rt.built_in == nullptr)
+                    rt.element = &resolved_types[rt.element_type];
+            } else if (rt.st != nullptr) {
+                if (rt.st->base != type_name())
+                    rt.base = &resolved_types[resolve_type(rt.st->base)];
+                for (const auto &field : rt.st->fields)
+                    rt.fields.emplace_back(field.name, &resolved_types[_remove_bin_extension(field.type)]);
+            }
+        }
     }
 
     bool abi_serializer::is_builtin_type( const type_name &type ) const {
@@ -229,11 +290,6 @@ namespace wasm {
         ctx.check_deadline();
         auto type = fundamental_type(rtype);
 
-        auto it = structs.find(type);
-        if (it != structs.end())
-            fprintf(stdin, "my it not exist\n");
-        else
-            fprintf(stdin, "ok! it name=%s", it->first.c_str());
         if (built_in_types.find(type) != built_in_types.end()) return true;
         if (typedefs.find(type) != typedefs.end()) return _is_type(typedefs.find(type)->second, ctx);
         if (structs.find(type) != structs.end()) return true;
@@ -265,6 +321,10 @@ namespace wasm {
 
     json_spirit::Value abi_serializer::_binary_to_variant( const type_name &type, wasm::datastream<const char *> &ds,
                                                            wasm::abi_traverse_context &ctx ) const {
+        auto r_itr = resolved_types.find(type);
+        if (r_itr != resolved_types.end())
+            return _binary_to_variant(r_itr->second, ds, ctx);
+
         ctx.check_deadline();
         ctx.recursion_depth++;
 
@@ -333,13 +393,179 @@ namespace wasm {
     }
 
 
+    json_spirit::Value abi_serializer::_binary_to_variant( const resolved_type &rt, wasm::datastream<const char *> &ds,
+                                                           wasm::abi_traverse_context &ctx ) const {
+        ctx.check_deadline();
+        ctx.recursion_depth++;
+
+        if (rt.built_in != nullptr) {
+            try {
+                return rt.built_in->first(ds, rt.array, rt.optional);
+            }WASM_RETHROW_EXCEPTIONS(unpack_exception, "Unable to unpack type '%s' ", rt.rtype)
+        }
+
+        if (rt.array) {
+            wasm::unsigned_int size;
+            try {
+                ds >> size;
+            }WASM_RETHROW_EXCEPTIONS(unpack_exception, "Unable to unpack size of array '%s' ", rt.rtype)
+
+            WASM_ASSERT( size < max_abi_array_size,
+                         array_size_exceeds_exception,
+                         "Array size %u must be smaller than max %d", size.value,
+                         max_abi_array_size);
+
+            json_spirit::Array vars;
+            vars.reserve(size.value);
+            for (decltype(size.value) i = 0; i < size; ++i) {
+                auto v = _binary_to_variant(*rt.element, ds, ctx);
+                WASM_ASSERT( !v.is_null(), unpack_exception, "Invalid packed array '%s'", rt.rtype);
+                vars.emplace_back(std::move(v));
+            }
+            return json_spirit::Value(std::move(vars));
+        } else if (rt.optional) {
+            char flag;
+            try {
+                ds >> flag;
+            }WASM_RETHROW_EXCEPTIONS(unpack_exception,
+                                    "Unable to unpack presence flag of optional '%s' ", rt.rtype)
+            return flag ? _binary_to_variant(*rt.element, ds, ctx) : json_spirit::Value();
+
+        } else if (rt.st != nullptr) {
+            json_spirit::Object obj;
+            if (rt.base != nullptr) {
+                json_spirit::Value base = _binary_to_variant(*rt.base, ds, ctx);
+                if (base.type() == json_spirit::obj_type) {
+                    obj = std::move(base.get_obj());
+                } else {
+                    //fixme:base in array or single value
+                    json_spirit::Config::add(obj, rt.st->base, base);
+                }
+            }
+
+            obj.reserve(obj.size() + rt.fields.size());
+            for (const auto &field : rt.fields) {
+                auto v = _binary_to_variant(*field.second, ds, ctx);
+                if (!v.is_null()) {
+                    json_spirit::Config::add(obj, field.first, v);
+                }
+            }
+            return json_spirit::Value(std::move(obj));
+        }
+
+        WASM_THROW(unpack_exception, "Unable to unpack '%s' from stream", rt.rtype);
+        json_spirit::Value var;
+        return var;
+    }
+
     json_spirit::Value abi_serializer::binary_to_variant( const type_name &type, const bytes &binary,
                                                           microseconds max_serialization_time ) const {
-        wasm::datastream<const char *> ds(binary.data(), binary.size());
+        return binary_to_variant(type, binary.data(), binary.size(), max_serialization_time);
+    }
+
+    json_spirit::Value abi_serializer::binary_to_variant( const type_name &type, const char *data, size_t size,
+                                                          microseconds max_serialization_time ) const {
+        wasm::datastream<const char *> ds(data, size);
         wasm::abi_traverse_context ctx(max_serialization_time);
         return _binary_to_variant(type, ds, ctx);
     }
 
+    bytes abi_serializer::pack_action( const string &action, const string &params,
+                                       microseconds max_serialization_time ) const {
+        bytes data;
+        try {
+            json_spirit::Value data_v;
+            json_spirit::read_string(params, data_v);
+
+            string action_type = get_action_type(action);
+            if (action_type == string()) {
+                action_type = action;
+            }
+            data = variant_to_binary(action_type, data_v, max_serialization_time);
+        }
+        WASM_CAPTURE_AND_RETHROW("abi_serializer pack error in params %s", params)
+
+        return data;
+    }
+
+    json_spirit::Value abi_serializer::unpack_action( const string &action, const bytes &data,
+                                                      microseconds max_serialization_time ) const {
+        json_spirit::Value data_v;
+        try {
+            string action_type = get_action_type(action);
+            if (action_type == string()) {
+                action_type = action;
+            }
+            data_v = binary_to_variant(action_type, data, max_serialization_time);
+        }
+        WASM_CAPTURE_AND_RETHROW("abi_serializer unpack error in params %s", action)
+
+        return data_v;
+    }
+
+    json_spirit::Value abi_serializer::unpack_table( const uint64_t &table, const char *data, size_t size,
+                                                     microseconds max_serialization_time ) const {
+        json_spirit::Value data_v;
+        type_name name;
+        try {
+            string t = wasm::name(table).to_string();
+            name     = get_table_type(t);
+
+            WASM_ASSERT(name.size() > 0, abi_parse_exception, "can not get table %s's type from abi", t.data());
+
+            data_v = binary_to_variant(name, data, size, max_serialization_time);
+        }
+        WASM_CAPTURE_AND_RETHROW("abi_serializer unpack error in table %s", name)
+
+        return data_v;
+    }
+
+    // the serializers of the recently used abis, the least recently used one is evicted when full
+    class abi_serializer_cache {
+    public:
+        std::shared_ptr<const abi_serializer> get( const char *abi, size_t size, microseconds max_serialization_time ) {
+            string key(abi, size);
+            {
+                std::lock_guard<std::mutex> lock(cache_mutex);
+                auto it = entries.find(key);
+                if (it != entries.end()) {
+                    lru.splice(lru.begin(), lru, it->second.second);
+                    return it->second.first;
+                }
+            }
+
+            // parse and validate the abi outside the lock, the same abi may be parsed twice at most
+            wasm::abi_def def = wasm::unpack<wasm::abi_def>(abi, size);
+            auto abis = std::make_shared<const abi_serializer>(def, max_serialization_time);
+
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            auto ret = entries.emplace(std::move(key), std::make_pair(abis, lru.end()));
+            if (!ret.second)
+                return ret.first->second.first;
+
+            lru.push_front(&ret.first->first);
+            ret.first->second.second = lru.begin();
+            while (entries.size() > max_abi_serializer_cache_size) {
+                entries.erase(*lru.back());
+                lru.pop_back();
+            }
+            return abis;
+        }
+
+    private:
+        using lru_list = std::list<const string *>;  // the keys, the most recently used at the front
+
+        std::mutex cache_mutex;
+        std::unordered_map<string, pair<std::shared_ptr<const abi_serializer>, lru_list::iterator>> entries;
+        lru_list lru;
+    };
+
+    std::shared_ptr<const abi_serializer>
+    abi_serializer::get_serializer( const char *abi, size_t size, microseconds max_serialization_time ) {
+        static abi_serializer_cache cache;
+        return cache.get(abi, size, max_serialization_time);
+    }
+
    json_spirit::Value abi_serializer::get_field_variant( const type_name &s, const json_spirit::Value &v, field_name field, bool is_optional ) const {
         if (v.type() == json_spirit::obj_type) {
             auto o = v.get_obj();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <string>
 #include <functional>
 #include <utility>
@@ -38,6 +39,8 @@ namespace wasm {
     struct abi_serializer {
         abi_serializer() { configure_built_in_types(); }
         abi_serializer( const abi_def &abi, const microseconds &max_serialization_time );
+        abi_serializer( const abi_serializer & ) = delete;
+        abi_serializer &operator=( const abi_serializer & ) = delete;
         void set_abi( const abi_def &abi, const microseconds &max_serialization_time );
         type_name resolve_type( const type_name &t ) const;
         bool is_array( const type_name &type ) const;
@@ -56,6 +59,8 @@ namespace wasm {
 
         json_spirit::Value
         binary_to_variant( const type_name &type, const bytes &binary, microseconds max_serialization_time ) const;
+        json_spirit::Value
+        binary_to_variant( const type_name &type, const char *data, size_t size, microseconds max_serialization_time ) const;
         bytes variant_to_binary( const type_name &type, const json_spirit::Value &var,
                                  microseconds max_serialization_time ) const;
         void variant_to_binary( const type_name &type, const json_spirit::Value &var, wasm::datastream<char *> &ds,
@@ -69,86 +74,72 @@ namespace wasm {
         json_spirit::Value get_field_variant( const type_name &s, const json_spirit::Value &v, field_name field, bool is_optional ) const;
         json_spirit::Value get_field_variant( const type_name &s, const json_spirit::Value &v, uint32_t index ) const;
 
-        static std::vector<char>
-        pack( const std::vector<char> &abi, const string &action, const string &params, microseconds max_serialization_time ) {
-
-            vector<char> data;
-            try {
+        bytes pack_action( const string &action, const string &params, microseconds max_serialization_time ) const;
+        json_spirit::Value unpack_action( const string &action, const bytes &data, microseconds max_serialization_time ) const;
+        json_spirit::Value unpack_table( const uint64_t &table, const char *data, size_t size,
+                                         microseconds max_serialization_time ) const;
 
-                wasm::abi_def def = wasm::unpack<wasm::abi_def>(abi);
-                wasm::abi_serializer abis(def, max_serialization_time);
-
-                json_spirit::Value data_v;
-                json_spirit::read_string(params, data_v);
-
-                string action_type = abis.get_action_type(action);
-                if(action_type == string()){
-                    action_type = action;
-                }
-                //data = abis.variant_to_binary(action, data_v, max_serialization_time);
-                data = abis.variant_to_binary(action_type, data_v, max_serialization_time);
+        // the serializer of the packed abi, shared from the cache keyed by the abi bytes, so an abi is
+        // only parsed and validated again after it is changed. The serializer is used by many threads
+        // at a time, only its const methods are called
+        static std::shared_ptr<const abi_serializer>
+        get_serializer( const char *abi, size_t size, microseconds max_serialization_time );
 
-            }
-            WASM_CAPTURE_AND_RETHROW("abi_serializer pack error in params %s", params)
+        static std::shared_ptr<const abi_serializer>
+        get_serializer( const std::vector<char> &abi, microseconds max_serialization_time ) {
+            return get_serializer(abi.data(), abi.size(), max_serialization_time);
+        }
 
-            return data;
+        static std::shared_ptr<const abi_serializer>
+        get_serializer( const string &abi, microseconds max_serialization_time ) {
+            return get_serializer(abi.data(), abi.size(), max_serialization_time);
+        }
 
+        static std::vector<char>
+        pack( const std::vector<char> &abi, const string &action, const string &params, microseconds max_serialization_time ) {
+            return get_serializer(abi, max_serialization_time)->pack_action(action, params, max_serialization_time);
         }
 
         static json_spirit::Value
         unpack( const std::vector<char>  &abi, const string &action, const bytes &data, microseconds max_serialization_time ) {
-
-            json_spirit::Value data_v;
-            try {
-                wasm::abi_def def = wasm::unpack<wasm::abi_def>(abi);
-                wasm::abi_serializer abis(def, max_serialization_time);
-
-                string action_type = abis.get_action_type(action);
-                if(action_type == string()){
-                    action_type = action;
-                }
-                //data_v = abis.binary_to_variant(action, data, max_serialization_time);
-                data_v = abis.binary_to_variant(action_type, data, max_serialization_time);
-
-            }
-            WASM_CAPTURE_AND_RETHROW("abi_serializer unpack error in params %s", action)
-
-            return data_v;
+            return get_serializer(abi, max_serialization_time)->unpack_action(action, data, max_serialization_time);
         }
 
         static json_spirit::Value
         unpack( const std::vector<char> &abi, const uint64_t &table, const bytes &data, microseconds max_serialization_time ) {
-
-            json_spirit::Value data_v;
-            type_name name;
-            try {
-
-                wasm::abi_def def = wasm::unpack<wasm::abi_def>(abi);
-                wasm::abi_serializer abis(def, max_serialization_time);
-
-                string t = wasm::name(table).to_string();
-                name = abis.get_table_type(t);
-
-                WASM_ASSERT(name.size() > 0, abi_parse_exception, "can not get table %s's type from abi", t.data());
-
-                data_v = abis.binary_to_variant(name, data, max_serialization_time);
-            }
-            WASM_CAPTURE_AND_RETHROW("abi_serializer unpack error in table %s", name)
-
-            return data_v;
+            return get_serializer(abi, max_serialization_time)->unpack_table(table, data.data(), data.size(),
+                                                                              max_serialization_time);
         }
 
     private:
+        // the type in the abi with its typedefs resolved and the struct layout looked up in advance,
+        // so unpacking a value does not search the type tables again
+        struct resolved_type {
+            type_name                              rtype;
+            const pair<unpack_function, pack_function> *built_in = nullptr;
+            const struct_def                      *st       = nullptr;
+            bool                                   array    = false;
+            bool                                   optional = false;
+            type_name                              element_type;  // of the array or optional
+            const resolved_type                   *element  = nullptr;
+            const resolved_type                   *base     = nullptr;
+            vector <pair<field_name, const resolved_type *>> fields;
+        };
+
         map <type_name, type_name> typedefs;
         map <type_name, struct_def> structs;
         map <type_name, type_name> actions;
         map <type_name, type_name> tables;
         map <uint64_t, string> error_messages;
         map <type_name, pair<unpack_function, pack_function>> built_in_types;
+        map <type_name, resolved_type> resolved_types;
 
         void configure_built_in_types();
+        void resolve_types();
         json_spirit::Value _binary_to_variant( const type_name &type, wasm::datastream<const char *> &ds,
                                                wasm::abi_traverse_context &ctx ) const;
+        json_spirit::Value _binary_to_variant( const resolved_type &rt, wasm::datastream<const char *> &ds,
+                                               wasm::abi_traverse_context &ctx ) const;
 
         bytes _variant_to_binary( const type_name &type, const json_spirit::Value &var,
                             wasm::abi_traverse_context &ctx ) const;
@@ -3,6 +3,7 @@
 #include <eosio/vm/constants.hpp>
 #include <eosio/vm/exceptions.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
@@ -374,6 +375,18 @@ namespace eosio { namespace vm {
     private:
       char*   raw       = nullptr;
       int32_t page      = 0;
+      int32_t rw_pages  = 0; // the pages [0, rw_pages) are readable and writable
+      int32_t dirty     = 0; // the pages [0, dirty) may have been written, the others are all zero
+
+      // the dirty pages are given back to the kernel, they read as zero when touched again
+      bool release_dirty_pages() {
+         if (dirty > 0) {
+            if (madvise(raw, page_size * dirty, MADV_DONTNEED) != 0)
+               return false;
+            dirty = 0;
+         }
+         return true;
+      }
 
     public:
       template <typename T>
@@ -381,11 +394,16 @@ namespace eosio { namespace vm {
          if (size == 0) return;
          EOS_VM_ASSERT(page != -1, wasm_bad_alloc, "require memory to allocate");
          EOS_VM_ASSERT(size <= max_pages - page, wasm_bad_alloc, "exceeded max number of pages");
-         int err = mprotect(raw + (page_size * page), (page_size * size), PROT_READ | PROT_WRITE);
-         EOS_VM_ASSERT(err == 0, wasm_bad_alloc, "mprotect failed");
+         if (page + size > rw_pages) {
+            int err = mprotect(raw + (page_size * rw_pages), (page_size * (page + size - rw_pages)), PROT_READ | PROT_WRITE);
+            EOS_VM_ASSERT(err == 0, wasm_bad_alloc, "mprotect failed");
+            rw_pages = page + size;
+         }
          T* ptr    = (T*)(raw + (page_size * page));
-         memset(ptr, 0, page_size * size);
+         if (page < dirty)
+            memset(ptr, 0, page_size * std::min<size_t>(size, dirty - page));
          page += size;
+         dirty = std::max(dirty, page);
       }
       template <typename T>
       void free(std::size_t size) {
@@ -393,8 +411,9 @@ namespace eosio { namespace vm {
          EOS_VM_ASSERT(page != -1, wasm_bad_alloc, "require memory to deallocate");
          EOS_VM_ASSERT(size <= page, wasm_bad_alloc, "freed too many pages");
          page -= size;
-         int err = mprotect(raw + (page_size * page), (page_size * size), PROT_NONE);
+         int err = mprotect(raw + (page_size * page), (page_size * (rw_pages - page)), PROT_NONE);
          EOS_VM_ASSERT(err == 0, wasm_bad_alloc, "mprotect failed");
+         rw_pages = page;
       }
       void free() {
          std::size_t syspagesize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
@@ -411,16 +430,17 @@ namespace eosio { namespace vm {
       }
       void reset(uint32_t new_pages) {
          if (page != -1) {
-            memset(raw, '\0', page_size * page); // zero the memory
+            EOS_VM_ASSERT(release_dirty_pages(), wasm_bad_alloc, "madvise failed"); // zero the memory
          } else {
             std::size_t syspagesize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
             int err = mprotect(raw - syspagesize, syspagesize, PROT_READ);
             EOS_VM_ASSERT(err == 0, wasm_bad_alloc, "mprotect failed");
          }
-         // no need to mprotect if the size hasn't changed
-         if (new_pages != page && page > 0) {
-            int err = mprotect(raw, page_size * page, PROT_NONE); // protect the entire region of memory
+         // no need to mprotect if the size hasn't changed, the pages are allocated again right after
+         if (new_pages != rw_pages && rw_pages > 0) {
+            int err = mprotect(raw, page_size * rw_pages, PROT_NONE); // protect the entire region of memory
             EOS_VM_ASSERT(err == 0, wasm_bad_alloc, "mprotect failed");
+            rw_pages = 0;
          }
          page = 0;
       }
@@ -428,12 +448,18 @@ namespace eosio { namespace vm {
       void reset() {
          if (page != -1) {
             std::size_t syspagesize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
-            memset(raw, '\0', page_size * page); // zero the memory
-            int err = mprotect(raw - syspagesize, page_size * page + syspagesize, PROT_NONE);
+            EOS_VM_ASSERT(release_dirty_pages(), wasm_bad_alloc, "madvise failed"); // zero the memory
+            int err = mprotect(raw - syspagesize, page_size * rw_pages + syspagesize, PROT_NONE);
             EOS_VM_ASSERT(err == 0, wasm_bad_alloc, "mprotect failed");
+            rw_pages = 0;
          }
          page = -1;
       }
+      // zero the memory for reusing the allocator, the reservation and the protection of the pages are
+      // kept. Return false if failed, the allocator should not be reused then
+      bool clear() {
+         return release_dirty_pages();
+      }
       template <typename T>
       inline T* get_base_ptr() const {
          return reinterpret_cast<T*>(raw);
@@ -1563,6 +1563,36 @@ BOOST_AUTO_TEST_CASE( abi_token ) {
 
 }
 
+BOOST_AUTO_TEST_CASE( abi_serializer_cache ) {
+
+    string abi;
+
+    char byte;
+    ifstream f("token.abi", ios::binary);
+    while (f.get(byte)) abi.push_back(byte);
+
+    wasm::variant var_abi;
+    json_spirit::read_string(abi, var_abi);
+    wasm::abi_def def;
+    wasm::from_variant(var_abi, def);
+    auto abiJson = wasm::pack<wasm::abi_def>(def);
+
+    auto abis = wasm::abi_serializer::get_serializer(abiJson, max_serialization_time);
+    WASM_TEST(abis == wasm::abi_serializer::get_serializer(string(abiJson.begin(), abiJson.end()), max_serialization_time),
+              "abi_serializer_cache.same_abi")
+
+    def.version = "wasm::abi/1.0";
+    auto abiJson2 = wasm::pack<wasm::abi_def>(def);
+    WASM_TEST(abis != wasm::abi_serializer::get_serializer(abiJson2, max_serialization_time),
+              "abi_serializer_cache.changed_abi")
+
+    string param = string(R"({"from":"xiaoyu","to":"walker","quantity":"100.00000000 BTC","memo":"transfer BTC"})");
+    wasm::variant var = abis->unpack_action("transfer", abis->pack_action("transfer", param, max_serialization_time),
+                                            max_serialization_time);
+    WASM_TEST(param == json_spirit::write(var), "abi_serializer_cache.transfer")
+
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
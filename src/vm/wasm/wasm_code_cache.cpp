@@ -0,0 +1,178 @@
+#include "wasm/wasm_code_cache.hpp"
+#include "wasm/wasm_config.hpp"
+#include "wasm/wasm_interface.hpp"
+#include "wasm/wasm_context.hpp"
+
+#include "main.h"
+#include "commons/random.h"
+#include "commons/util/util.h"
+#include "config/configuration.h"
+#include "config/version.h"
+#include "crypto/hash.h"
+#include "persistence/accountdb.h"
+#include "persistence/cachewrapper.h"
+#include "persistence/contractdb.h"
+
+#include <atomic>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+namespace wasm {
+
+    // the loader has completed, the instantiation cache holds the saved modules that are still valid
+    static std::atomic<bool> code_cache_loaded(false);
+
+    wasm_code_cache_file::wasm_code_cache_file() { path = GetDataDir() / "wasmcache.dat"; }
+
+    bool wasm_code_cache_file::write(const std::vector<module_item> &items) {
+        string tmpfn = strprintf("wasmcache.dat.%04x", GetRand(0x10000));
+
+        // the header is the network magic number, the cache version and the vm type, then the modules
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << FLATDATA(SysCfg().MessageStart());
+        ss << wasm_code_cache_version << (uint8_t)vm_type::eos_vm_jit << CLIENT_VERSION;
+        ss << items;
+        uint256 hash = Hash(ss.begin(), ss.end());
+        ss << hash;
+
+        boost::filesystem::path pathTmp = GetDataDir() / tmpfn;
+        FILE *file                      = fopen(pathTmp.string().c_str(), "wb");
+        CAutoFile fileout               = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+        if (!fileout)
+            return ERRORMSG("%s : Failed to open file %s", __func__, pathTmp.string());
+
+        try {
+            fileout << ss;
+        } catch (std::exception &e) {
+            return ERRORMSG("%s : Serialize or I/O error - %s", __func__, e.what());
+        }
+        FileCommit(fileout);
+        fileout.fclose();
+
+        if (!RenameOver(pathTmp, path))
+            return ERRORMSG("%s : Rename-into-place failed", __func__);
+
+        return true;
+    }
+
+    bool wasm_code_cache_file::read(std::vector<module_item> &items) {
+        if (!boost::filesystem::exists(path))
+            return false;
+
+        FILE *file       = fopen(path.string().c_str(), "rb");
+        CAutoFile filein = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+        if (!filein)
+            return ERRORMSG("%s : Failed to open file %s", __func__, path.string());
+
+        int32_t dataSize = boost::filesystem::file_size(path) - sizeof(uint256);
+        if (dataSize < 0)
+            dataSize = 0;
+        vector<uint8_t> vchData(dataSize);
+        uint256 hashIn;
+        try {
+            filein.read((char *)vchData.data(), dataSize);
+            filein >> hashIn;
+        } catch (std::exception &e) {
+            return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+        filein.fclose();
+
+        CDataStream ss(vchData, SER_DISK, CLIENT_VERSION);
+        if (hashIn != Hash(ss.begin(), ss.end()))
+            return ERRORMSG("%s : Checksum mismatch, data corrupted", __func__);
+
+        uint8_t pchMsgTmp[4];
+        uint32_t version = 0;
+        uint8_t vm       = 0;
+        int32_t clientVersion = 0;
+        try {
+            ss >> FLATDATA(pchMsgTmp);
+            if (memcmp(pchMsgTmp, SysCfg().MessageStart(), sizeof(pchMsgTmp)))
+                return ERRORMSG("%s : Invalid network magic number", __func__);
+
+            ss >> version >> vm >> clientVersion;
+            if (version != wasm_code_cache_version || vm != (uint8_t)vm_type::eos_vm_jit ||
+                clientVersion != CLIENT_VERSION) {
+                LogPrint(BCLog::INFO, "%s : the cache was written by another runtime (version=%u, vm=%u, client=%d)\n",
+                         __func__, version, vm, clientVersion);
+                return false;
+            }
+
+            ss >> items;
+        } catch (std::exception &e) {
+            return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+
+        return true;
+    }
+
+    void save_code_cache() {
+        // the modules not loaded yet would be dropped from the file
+        if (!code_cache_loaded) {
+            LogPrint(BCLog::INFO, "Skip saving wasmcache.dat, the wasm modules are not loaded yet\n");
+            return;
+        }
+
+        int64_t nStart = GetTimeMillis();
+        auto items     = wasm_interface::get_cached_modules();
+        if (items.empty())
+            return;
+
+        if (wasm_code_cache_file().write(items))
+            LogPrint(BCLog::INFO, "Saved %u wasm modules to wasmcache.dat (%dms)\n", items.size(),
+                     GetTimeMillis() - nStart);
+    }
+
+    void load_code_cache() {
+        int64_t nStart = GetTimeMillis();
+        std::vector<wasm_code_cache_file::module_item> items;
+        if (!wasm_code_cache_file().read(items)) {
+            code_cache_loaded = true;
+            return;
+        }
+
+        wasm_context::initialize();
+
+        // the most recently used ones were saved first, they are instantiated first and evicted last
+        // if the cache is smaller now
+        items.resize(std::min<size_t>(items.size(), max_wasm_instantiation_cache_size));
+        uint32_t loaded = 0;
+        for (auto it = items.rbegin(); it != items.rend(); ++it) {
+            boost::this_thread::interruption_point();
+
+            string code;
+            {
+                LOCK(cs_main);
+                if (pCdMan == nullptr)
+                    return;
+
+                CAccount account;
+                uint256 code_hash;
+                CUniversalContract contract;
+                if (!pCdMan->pAccountCache->GetAccount(CNickID(it->first), account) ||
+                    !pCdMan->pContractCache->GetContractCodeHash(account.regid, code_hash) ||
+                    code_hash != it->second ||
+                    !pCdMan->pContractCache->GetContract(account.regid, contract))
+                    continue;
+
+                code.swap(contract.code);
+            }
+
+            try {
+                if (wasm_interface::precompile(it->first, it->second, [&](string &code_out) {
+                        code_out.swap(code);
+                        return true;
+                    }))
+                    loaded++;
+            } catch (...) {
+                LogPrint(BCLog::INFO, "%s : instantiate the module of contract %s failed\n", __func__,
+                         wasm::name(it->first).to_string());
+            }
+        }
+
+        code_cache_loaded = true;
+        LogPrint(BCLog::INFO, "Loaded %u of %u wasm modules from wasmcache.dat (%dms)\n", loaded, items.size(),
+                 GetTimeMillis() - nStart);
+    }
+
+}  // wasm
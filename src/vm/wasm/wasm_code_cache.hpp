@@ -0,0 +1,38 @@
+#pragma once
+
+#include "commons/uint256.h"
+
+#include <boost/filesystem/path.hpp>
+
+#include <utility>
+#include <vector>
+
+namespace wasm {
+
+    /** -wasmprecompile default (instantiate the cached modules before the node starts) */
+    static const bool default_wasm_precompile = false;
+
+    // The modules in the instantiation cache, persisted in wasmcache.dat at shutdown so they are
+    // instantiated again at startup before the contracts are executed. The JIT code of eos-vm
+    // embeds the absolute addresses of the runtime, so the contracts and the code hashes of the
+    // modules are kept instead of the machine code, they are checked against the contract db and
+    // the file is ignored if written by another runtime version.
+    class wasm_code_cache_file {
+    public:
+        using module_item = std::pair<uint64_t, uint256>;  // the contract and the code hash
+
+        wasm_code_cache_file();
+
+        bool write(const std::vector<module_item> &items);
+        bool read(std::vector<module_item> &items);
+
+    private:
+        boost::filesystem::path path;
+    };
+
+    // save the modules of the instantiation cache, skipped if load_code_cache() hasn't completed or the cache is empty
+    void save_code_cache();
+    // instantiate the modules saved, the ones whose contract code was changed are skipped
+    void load_code_cache();
+
+}  // wasm
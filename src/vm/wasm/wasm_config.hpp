@@ -21,6 +21,10 @@ namespace wasm {
     const static uint16_t max_wasm_api_data_bytes      = 4096;
     const static uint16_t max_inline_transactions_size = 1024;
     const static uint16_t max_signatures_size          = 16;
+    const static uint32_t max_wasm_instantiation_cache_size = 64;  // instantiated modules kept in memory
+    const static uint16_t max_pooled_wasm_allocators       = max_inline_transaction_depth + 1;  // per thread
+    const static uint32_t wasm_code_cache_version          = 1;  // bumped when the runtime changes the modules
+    const static uint32_t max_abi_serializer_cache_size    = 128;  // parsed abis kept in memory
 
     const static uint64_t wasmio       = N(wasmio);
     const static uint64_t wasmio_bank  = N(wasmio.bank);
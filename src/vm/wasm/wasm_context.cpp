@@ -6,6 +6,8 @@
 #include "wasm/wasm_log.hpp"
 #include "entities/account.h"
 
+#include <mutex>
+
 using namespace std;
 using namespace wasm;
 // using std::chrono::microseconds;
@@ -32,6 +34,40 @@ namespace wasm {
         return nullptr;
     }
 
+    struct wasm_allocator_pool_items {
+        vector<vm::wasm_allocator*> idle;
+
+        ~wasm_allocator_pool_items() {
+            for (auto walloc : idle) {
+                walloc->free();
+                delete walloc;
+            }
+        }
+    };
+
+    static thread_local wasm_allocator_pool_items allocator_pool_items;
+
+    vm::wasm_allocator* wasm_allocator_pool::acquire() {
+        auto &idle = allocator_pool_items.idle;
+        if (idle.empty())
+            return new vm::wasm_allocator();
+
+        auto walloc = idle.back();
+        idle.pop_back();
+        return walloc;
+    }
+
+    void wasm_allocator_pool::release(vm::wasm_allocator* walloc) {
+        auto &idle = allocator_pool_items.idle;
+        if (idle.size() < max_pooled_wasm_allocators && walloc->clear()) {
+            idle.push_back(walloc);
+            return;
+        }
+
+        walloc->free();
+        delete walloc;
+    }
+
     static inline void print_debug(uint64_t receiver, const inline_transaction_trace &trace) {
         if (!trace.console.empty()) {
 
@@ -99,16 +135,24 @@ namespace wasm {
         inline_transactions.push_back(t);
     }
 
-    std::vector <uint8_t> wasm_context::get_code(uint64_t account) {
+    bool wasm_context::get_code_hash(uint64_t account, CRegID &contract_regid, uint256 &code_hash) {
+
+        CAccount contract_account;
+        if (!database.accountCache.GetAccount(CNickID(account), contract_account))
+            return false;
+
+        contract_regid = contract_account.regid;
+        return database.contractCache.GetContractCodeHash(contract_regid, code_hash);
+    }
+
+    bool wasm_context::get_code(const CRegID &contract_regid, string &code) {
 
-        vector <uint8_t> code;
         CUniversalContract contract;
-        CAccount contract_account ;
-        if(database.accountCache.GetAccount(CNickID(account), contract_account)
-            && database.contractCache.GetContract(contract_account.regid, contract)) {
-            code = vector <uint8_t>(contract.code.begin(), contract.code.end());
-        }
-        return code;
+        if (!database.contractCache.GetContract(contract_regid, contract))
+            return false;
+
+        code.swap(contract.code);
+        return true;
     }
 
     // std::string wasm_context::get_abi(uint64_t account) {
@@ -121,13 +165,12 @@ namespace wasm {
 
     void wasm_context::initialize() {
 
-        static bool wasm_interface_inited = false;
-        if (!wasm_interface_inited) {
-            wasm_interface_inited = true;
-            wasmif.initialize(wasm::vm_type::eos_vm_jit);
+        static std::once_flag wasm_interface_inited;
+        std::call_once(wasm_interface_inited, []() {
+            wasm_interface().initialize(wasm::vm_type::eos_vm_jit);
             register_native_handler(wasmio,      N(setcode),  wasmio_native_setcode      );
             register_native_handler(wasmio_bank, N(transfer), wasmio_bank_native_transfer);
-        }
+        });
     }
 
     void wasm_context::execute(inline_transaction_trace &trace) {
@@ -172,9 +215,12 @@ namespace wasm {
                 (*native)(*this);
             } else {
 
-                vector <uint8_t> code = get_code(_receiver);
-                if (code.size() > 0) {
-                    wasmif.execute(code, this);
+                // the code is only loaded when its module is not in the cache
+                CRegID  contract_regid;
+                uint256 code_hash;
+                if (get_code_hash(_receiver, contract_regid, code_hash)) {
+                    wasmif.execute(_receiver, code_hash,
+                                   [&](string &code) { return get_code(contract_regid, code); }, this);
                 }
             }
         } catch (wasm::exception &e) {
@@ -23,25 +23,36 @@ namespace wasm {
     typedef CNickID nick_name;
     class wasm_context;
 
+    // the linear memory allocators reused by the wasm contexts of the thread, the context of a nested
+    // inline transaction takes its own one. The memory reservation is kept, only the pages touched by
+    // the previous run are zeroed when an allocator is released
+    class wasm_allocator_pool {
+    public:
+        static vm::wasm_allocator* acquire();
+        static void                release(vm::wasm_allocator* walloc);
+    };
+
     class wasm_context : public wasm_context_interface {
 
     public:
         wasm_context(CWasmContractTx &ctrl, inline_transaction &t, CCacheWrapper &cw,
                      vector <CReceipt> &receipts_in, bool mining, uint32_t depth = 0)
-                : trx(t), control_trx(ctrl), database(cw), receipts(receipts_in), recurse_depth(depth) {
+                : trx(t), control_trx(ctrl), database(cw), receipts(receipts_in), recurse_depth(depth),
+                  wasm_alloc(wasm_allocator_pool::acquire()) {
             reset_console();
         };
 
         ~wasm_context() {
-            wasm_alloc.free();
+            wasm_allocator_pool::release(wasm_alloc);
         };
 
     public:
-        void                  initialize();
+        static void           initialize();
         void                  execute(inline_transaction_trace &trace);
         void                  execute_one(inline_transaction_trace &trace);
         bool                  has_permission_from_inline_transaction(const permission &p);
-        std::vector <uint8_t> get_code(uint64_t account);
+        bool                  get_code_hash(uint64_t account, CRegID &contract_regid, uint256 &code_hash);
+        bool                  get_code(const CRegID &contract_regid, string &code);
 // Console methods:
     public:
         void                      reset_console();
@@ -109,8 +120,8 @@ namespace wasm {
             _pending_console_output << val;
         }
 
-        vm::wasm_allocator*       get_wasm_allocator() { return &wasm_alloc; }
-        bool                      is_memory_in_wasm_allocator( const char* p ) { return wasm_alloc.is_in_range(p); }
+        vm::wasm_allocator*       get_wasm_allocator() { return wasm_alloc; }
+        bool                      is_memory_in_wasm_allocator( const char* p ) { return wasm_alloc->is_in_range(p); }
 
         std::chrono::milliseconds get_max_transaction_duration() { return control_trx.get_max_transaction_duration(); }
         void                      update_storage_usage(uint64_t account, int64_t size_in_bytes);
@@ -127,7 +138,7 @@ namespace wasm {
         vector<inline_transaction> inline_transactions;
 
         wasm::wasm_interface       wasmif;
-        vm::wasm_allocator         wasm_alloc;
+        vm::wasm_allocator*        wasm_alloc;  // taken from wasm_allocator_pool
         uint64_t                   _receiver;
 
     private:
@@ -15,6 +15,9 @@
 
 #include "crypto/hash.h"
 
+#include <list>
+#include <mutex>
+
 using namespace eosio;
 using namespace eosio::vm;
 
@@ -22,9 +25,85 @@ namespace wasm {
     using code_version       = uint256;
     using backend_validate_t = backend<wasm::wasm_context_interface, vm::interpreter>;
     using rhf_t              = eosio::vm::registered_host_functions<wasm_context_interface>;
-    std::map <code_version, std::shared_ptr<wasm_instantiated_module_interface>> wasm_instantiation_cache;
     std::shared_ptr <wasm_runtime_interface>                                     runtime_interface;
 
+    // the instantiated modules keyed by the code hash, the least recently used one is evicted when
+    // the cache is full. The backend of a module keeps the execution state, so a module is applied
+    // by one thread at a time
+    class wasm_instantiation_cache {
+    public:
+        struct entry {
+            std::shared_ptr <wasm_instantiated_module_interface> module;
+            uint64_t                                             contract = 0;  // the first contract running it
+            std::mutex                                           apply_mutex;
+            std::list<code_version>::iterator                    lru_it;
+        };
+
+        std::shared_ptr <entry> get(uint64_t contract, const code_version &code_id,
+                                    const wasm_interface::code_loader &load_code) {
+            {
+                std::lock_guard<std::mutex> lock(cache_mutex);
+                auto it = entries.find(code_id);
+                if (it != entries.end()) {
+                    stats.hits++;
+                    lru.splice(lru.begin(), lru, it->second->lru_it);
+                    return it->second;
+                }
+            }
+
+            // the code is loaded and compiled out of the lock, the module instantiated by another
+            // thread in the meantime is taken instead
+            string code;
+            if (!load_code(code) || code.empty())
+                return nullptr;
+
+            auto new_entry      = std::make_shared<entry>();
+            new_entry->module   = runtime_interface->instantiate_module(code.data(), code.size());
+            new_entry->contract = contract;
+
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            stats.misses++;
+            auto it = entries.find(code_id);
+            if (it != entries.end())
+                return it->second;
+
+            lru.push_front(code_id);
+            new_entry->lru_it = lru.begin();
+            entries.emplace(code_id, new_entry);
+            while (entries.size() > max_wasm_instantiation_cache_size) {
+                entries.erase(lru.back());
+                lru.pop_back();
+                stats.evictions++;
+            }
+            return new_entry;
+        }
+
+        vector<std::pair<uint64_t, code_version>> get_modules() {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            vector<std::pair<uint64_t, code_version>> ret;
+            ret.reserve(lru.size());
+            for (const auto &code_id : lru) {
+                ret.emplace_back(entries[code_id]->contract, code_id);
+            }
+            return ret;
+        }
+
+        wasm_cache_stats get_stats() {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            wasm_cache_stats ret = stats;
+            ret.size             = entries.size();
+            return ret;
+        }
+
+    private:
+        std::mutex                                          cache_mutex;
+        std::map <code_version, std::shared_ptr <entry>>    entries;
+        std::list<code_version>                             lru;  // the most recently used at the front
+        wasm_cache_stats                                    stats;
+    };
+
+    wasm_instantiation_cache instantiation_cache;
+
     wasm_interface::wasm_interface() {}
     wasm_interface::~wasm_interface() {}
 
@@ -32,33 +111,37 @@ namespace wasm {
         runtime_interface->immediately_exit_currently_running_module();
     }
 
-    std::shared_ptr <wasm_instantiated_module_interface> get_instantiated_backend(const vector <uint8_t> &code) {
-
-        try {
-            auto code_id = Hash(code.begin(), code.end());
-            auto it = wasm_instantiation_cache.find(code_id);
-            if (it == wasm_instantiation_cache.end()) {
-                wasm_instantiation_cache[code_id] = runtime_interface->instantiate_module((const char*)code.data(), code.size());
-                return wasm_instantiation_cache[code_id];
-            }
-            return it->second;
-        } catch (...) {
-            throw;
-        }
+    void wasm_interface::execute(uint64_t contract, const uint256 &code_hash, const code_loader &load_code,
+                                 wasm_context_interface *pWasmContext) {
+        pWasmContext->pause_billing_timer();
+        auto pEntry = instantiation_cache.get(contract, code_hash, load_code);
+        pWasmContext->resume_billing_timer();
+        if (pEntry == nullptr)
+            return;
 
+        std::lock_guard<std::mutex> lock(pEntry->apply_mutex);
+        pEntry->module->apply(pWasmContext);
     }
 
     void wasm_interface::execute(const vector <uint8_t> &code, wasm_context_interface *pWasmContext) {
-        pWasmContext->pause_billing_timer();
-        std::shared_ptr <wasm_instantiated_module_interface> pInstantiated_module = get_instantiated_backend(code);
-        pWasmContext->resume_billing_timer();
+        execute(pWasmContext->receiver(), Hash(code.begin(), code.end()),
+                [&](string &code_out) {
+                    code_out.assign(code.begin(), code.end());
+                    return true;
+                },
+                pWasmContext);
+    }
 
-        //system_clock::time_point start = system_clock::now();
-        pInstantiated_module->apply(pWasmContext);
-        // system_clock::time_point end = system_clock::now();
-        // std::cout << std::string("wasm duration:")
-        //           << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << std::endl;
+    wasm_cache_stats wasm_interface::get_cache_stats() {
+        return instantiation_cache.get_stats();
+    }
+
+    vector<std::pair<uint64_t, uint256>> wasm_interface::get_cached_modules() {
+        return instantiation_cache.get_modules();
+    }
 
+    bool wasm_interface::precompile(uint64_t contract, const uint256 &code_hash, const code_loader &load_code) {
+        return instantiation_cache.get(contract, code_hash, load_code) != nullptr;
     }
 
     void wasm_interface::validate(const vector <uint8_t> &code) {
@@ -2,6 +2,8 @@
 
 #include <vector>
 #include <map>
+#include <functional>
+#include "commons/uint256.h"
 #include "wasm/wasm_context_interface.hpp"
 #include "wasm/wasm_runtime.hpp"
 
@@ -12,18 +14,35 @@ namespace wasm {
         eos_vm_jit
     };
 
+    struct wasm_cache_stats {
+        uint32_t size      = 0;  // the modules in the cache
+        uint64_t hits      = 0;
+        uint64_t misses    = 0;  // the modules instantiated
+        uint64_t evictions = 0;
+    };
+
     class wasm_interface {
 
     public:
+        // load the contract code, it is only called when the module of the code is not in the cache
+        using code_loader = std::function<bool(string &code)>;
 
         wasm_interface();
         ~wasm_interface();
 
     public:
         void initialize(vm_type vm);
+        void execute(uint64_t contract, const uint256 &code_hash, const code_loader &load_code,
+                     wasm_context_interface *pWasmContext);
         void execute(const vector <uint8_t>& code, wasm_context_interface *pWasmContext);
         void validate(const vector <uint8_t>& code);
         void exit();
 
+        static wasm_cache_stats get_cache_stats();
+        // the contracts and the code hashes of the modules in the cache, the most recently used first
+        static vector<std::pair<uint64_t, uint256>> get_cached_modules();
+        // instantiate the module of the code into the cache ahead of executing it
+        static bool precompile(uint64_t contract, const uint256 &code_hash, const code_loader &load_code);
+
     };
 }
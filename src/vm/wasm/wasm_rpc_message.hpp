@@ -109,5 +109,19 @@ namespace wasm { namespace rpc{
         > curl --user myusername -d '{"jsonrpc": "1.0", "id":"curltest", "method":"gettxtrace", "params":"wTtCsc5X9S5XAy1oDuFiEAfEwf8bZHur1W"}' -H 'Content-Type: application/json;' http://127.0.0.1:8332
     )=====";
 
+    const char *get_wasm_cache_info_rpc_help_message = R"=====(
+        getwasmcacheinfo
+        Get the size and the hit/miss/eviction counts of the cache of the instantiated wasm modules
+        Result:
+        "size":      (numeric) the modules in the cache
+        "hits":      (numeric) the executions finding their module in the cache
+        "misses":    (numeric) the modules loaded and instantiated
+        "evictions": (numeric) the least recently used modules evicted from the full cache
+        Examples:
+        > ./coind getwasmcacheinfo
+        As json rpc call
+        > curl --user myusername -d '{"jsonrpc": "1.0", "id":"curltest", "method":"getwasmcacheinfo", "params":[]}' -H 'Content-Type: application/json;' http://127.0.0.1:8332
+    )=====";
+
 } // rpc
 } // wasm
@@ -17,19 +17,21 @@ namespace wasm {
 template<typename Api>
 struct resolver_factory {
 static auto make(Api& api) {
-    return [api](const uint64_t &account) -> std::vector<char> {
+    return [api](const uint64_t &account) -> std::shared_ptr<const wasm::abi_serializer> {
 
         std::vector<char> abi;
-        if (!get_native_contract_abi(account, abi)) {
-            CUniversalContract contract_store;
-            CAccount contract_account;
-            if (api->accountCache.GetAccount(CNickID(wasm::name(account).to_string()), contract_account)
-                && api->contractCache.GetContract(contract_account.regid, contract_store)){
+        if (get_native_contract_abi(account, abi))
+            return wasm::abi_serializer::get_serializer(abi, max_serialization_time);
 
-                abi.insert(abi.end(), contract_store.abi.begin(), contract_store.abi.end());
-            }
+        CUniversalContract contract_store;
+        CAccount contract_account;
+        if (api->accountCache.GetAccount(CNickID(wasm::name(account).to_string()), contract_account)
+            && api->contractCache.GetContract(contract_account.regid, contract_store)
+            && !contract_store.abi.empty()){
+
+            return wasm::abi_serializer::get_serializer(contract_store.abi, max_serialization_time);
         }
-        return abi;
+        return nullptr;
     };
   } 
 };
@@ -113,13 +115,18 @@ static inline void to_variant(const wasm::inline_transaction &t, json_spirit::Va
     json_spirit::Config::add(obj, "authorization", json_spirit::Value(arr));
 
 
-    std::vector<char> abi = resolver(t.contract);
+    std::shared_ptr<const wasm::abi_serializer> abis;
+    if (t.action != wasm::N(setcode)) {
+        try {
+            abis = resolver(t.contract);
+        } catch (...) {
+        }
+    }
 
-    if (abi.size() > 0 && t.action != wasm::N(setcode)) {
+    if (abis != nullptr) {
         if (t.data.size() > 0) {
             try {
-                val = wasm::abi_serializer::unpack(abi, wasm::name(t.action).to_string(), t.data,
-                                                   max_serialization_time);
+                val = abis->unpack_action(wasm::name(t.action).to_string(), t.data, max_serialization_time);
             } catch (...) {
                 to_variant(ToHex(t.data, ""), val);
             }